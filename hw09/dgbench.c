@@ -0,0 +1,364 @@
+/*===============================================================
+[Program Name] : dgbench.c
+[Description]  :
+    - 데이터그램 서버(udps, ucls)의 처리량(requests/s)을 재는 부하 생성기.
+    - 요청을 window개 보내 둔 뒤, 응답이 오는 만큼 새 요청을 보내 항상
+      window개가 처리 중이도록 한다. 요청과 응답은 recvmmsg()/sendmmsg()로
+      여러 개씩 주고받으므로 측정하는 쪽이 병목이 되지 않는다.
+    - -S를 주면 서버를 직접 띄워 "-q -b n"으로 일괄 처리 크기마다 재고
+      비교 표를 출력한다. (-b 0은 요청마다 recvfrom()/sendto()인 기존 루프)
+[Input]        :
+    - -u         : UNIX 도메인 비연결형 서버(UNIX_DG_PATH)를 잰다 (기본: UDP)
+    - -d seconds : 측정 시간 (기본 3)
+    - -w window  : 처리 중으로 유지할 요청 수 (기본 256)
+    - -S server  : 잴 서버 프로그램 (예: ./udps). 없으면 이미 떠 있는 서버를 잰다
+    - -B list    : -S로 띄울 때 서버의 일괄 처리 크기 목록 (기본 "0,64")
+[Output]       :
+    - 측정마다 "label,requests,seconds,requests_per_sec,timeouts,server_us_per_req" CSV 한 줄,
+      -S이면 기존 루프(-b 0) 대비 배율
+    - server_us_per_req는 -S로 띄운 서버가 쓴 CPU 시간(user+sys)을 처리한 요청
+      수로 나눈 값이다. 코어가 하나뿐이라 측정하는 쪽과 서버가 CPU를 나눠 쓰면
+      requests/s는 측정하는 쪽에 묶이므로, 서버 비용은 이 값으로 비교한다.
+[Calls]        :
+    - socket(), bind(), sendmmsg(), recvmmsg(), fork(), execl(), kill(), wait4()
+[특기사항]     :
+    - "select.h"의 MsgType, SERV_UDP_PORT, UNIX_DG_PATH 정의를 사용
+    - 서버와 같은 코어에서 경쟁하지 않도록 taskset 등으로 서버와 나누어
+      띄우는 것이 좋다. (예: taskset -c 1 ./dgbench -S "taskset -c 0 ./udps")
+    - 응답이 DG_TIMEOUT_MS 동안 없으면 잃어버린 것으로 보고 window를 다시 채운다.
+===============================================================*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "select.h"
+#include "dgram.h"
+
+#define	SERV_HOST_ADDR	"127.0.0.1"
+#define	MAX_WINDOW		DG_BATCH_MAX
+#define	MAX_RUN			16
+#define	DG_TIMEOUT_MS	100
+
+int		Unix;			// 1이면 UNIX 도메인 (-u)
+char	CliPath[64];	// UNIX 도메인 클라이언트 소켓 경로
+
+/*===============================================================
+[Function Name] : NowSec
+[Description]   :
+    - CLOCK_MONOTONIC 현재 시각 (초)
+[Input]         :
+    - 없음
+[Output]        :
+    - 없음
+[Call By]       :
+    - Measure()
+[Calls]         :
+    - clock_gettime()
+[Given]         :
+    - 없음
+[Returns]       :
+    - double : 현재 시각
+===============================================================*/
+double
+NowSec()
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*===============================================================
+[Function Name] : MakeSocket
+[Description]   :
+    - 서버에 연결한(connect) 데이터그램 소켓을 만든다. 연결해 두면 주소 없이
+      보내고, 다른 곳에서 온 데이터그램은 받지 않는다.
+    - UNIX 도메인은 응답을 받을 수 있게 클라이언트 경로에 bind한다.
+[Input]         :
+    - 없음
+[Output]        :
+    - 없음
+[Call By]       :
+    - Measure()
+[Calls]         :
+    - socket(), bind(), connect(), setsockopt(), perror(), exit()
+[Given]         :
+    - 글로벌 변수 Unix, CliPath
+[Returns]       :
+    - int : 소켓
+===============================================================*/
+int
+MakeSocket()
+{
+	struct sockaddr_in	inAddr;
+	struct sockaddr_un	unAddr;
+	struct timeval		tv;
+	int					sockfd;
+
+	if (Unix)  {
+		if ((sockfd = socket(PF_UNIX, SOCK_DGRAM, 0)) < 0)  {
+			perror("socket");
+			exit(1);
+		}
+		bzero((char *)&unAddr, sizeof(unAddr));
+		unAddr.sun_family = PF_UNIX;
+		snprintf(CliPath, sizeof(CliPath), "./.dgbench-%d", getpid());
+		strcpy(unAddr.sun_path, CliPath);
+		remove(CliPath);
+		if (bind(sockfd, (struct sockaddr *)&unAddr, sizeof(unAddr)) < 0)  {
+			perror("bind");
+			exit(1);
+		}
+		strcpy(unAddr.sun_path, UNIX_DG_PATH);
+		if (connect(sockfd, (struct sockaddr *)&unAddr, sizeof(unAddr)) < 0)  {
+			perror("connect");
+			exit(1);
+		}
+	}
+	else  {
+		if ((sockfd = socket(PF_INET, SOCK_DGRAM, 0)) < 0)  {
+			perror("socket");
+			exit(1);
+		}
+		bzero((char *)&inAddr, sizeof(inAddr));
+		inAddr.sin_family = PF_INET;
+		inAddr.sin_addr.s_addr = inet_addr(SERV_HOST_ADDR);
+		inAddr.sin_port = htons(SERV_UDP_PORT);
+		if (connect(sockfd, (struct sockaddr *)&inAddr, sizeof(inAddr)) < 0)  {
+			perror("connect");
+			exit(1);
+		}
+	}
+
+	// 응답을 잃어버렸을 때 멈추지 않도록
+	tv.tv_sec = 0;
+	tv.tv_usec = DG_TIMEOUT_MS * 1000;
+	setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	return sockfd;
+}
+
+/*===============================================================
+[Function Name] : SendRequests
+[Description]   :
+    - 같은 요청 메시지를 n개 보낸다. (sendmmsg()가 일부만 보내면 이어서)
+[Input]         :
+    - int sockfd          : 연결한 소켓
+    - struct mmsghdr *out : 요청 n개를 가리키는 mmsghdr 배열
+    - int n               : 보낼 요청 수
+[Output]        :
+    - 없음
+[Call By]       :
+    - Measure()
+[Calls]         :
+    - sendmmsg()
+[Given]         :
+    - 없음
+[Returns]       :
+    - int : 보낸 요청 수
+===============================================================*/
+int
+SendRequests(int sockfd, struct mmsghdr *out, int n)
+{
+	int		sent = 0, k;
+
+	while (sent < n)  {
+		if ((k = sendmmsg(sockfd, out + sent, n - sent, 0)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			break;		// 서버 소켓 버퍼가 참 등: 나머지는 다음에
+		}
+		sent += k;
+	}
+	return sent;
+}
+
+/*===============================================================
+[Function Name] : Measure
+[Description]   :
+    - seconds 동안 window개를 처리 중으로 유지하며 응답 수를 센다.
+[Input]         :
+    - int window        : 처리 중으로 유지할 요청 수
+    - double seconds    : 측정 시간
+    - long *requests    : 받은 응답 수
+    - long *timeouts    : 응답이 끊겨 window를 다시 채운 횟수
+[Output]        :
+    - 없음
+[Call By]       :
+    - main()
+[Calls]         :
+    - MakeSocket(), SendRequests(), recvmmsg(), NowSec(), close(), remove()
+[Given]         :
+    - 없음
+[Returns]       :
+    - double : 실제 측정 시간 (초)
+===============================================================*/
+double
+Measure(int window, double seconds, long *requests, long *timeouts)
+{
+	static MsgType			req, reply[MAX_WINDOW];
+	static struct iovec		reqIov, replyIov[MAX_WINDOW];
+	static struct mmsghdr	out[MAX_WINDOW], in[MAX_WINDOW];
+	double					start, end;
+	long					done = 0, lost = 0;
+	int						sockfd, i, n, inFlight;
+
+	sockfd = MakeSocket();
+	req.type = MSG_REQUEST;
+	sprintf(req.data, "This is a request from %d.", getpid());
+	reqIov.iov_base = &req;
+	reqIov.iov_len = sizeof(req);
+	for (i = 0 ; i < window ; i++)  {
+		out[i].msg_hdr.msg_iov = &reqIov;	// 모든 요청이 같은 버퍼를 보냄
+		out[i].msg_hdr.msg_iovlen = 1;
+		replyIov[i].iov_base = &reply[i];
+		replyIov[i].iov_len = sizeof(MsgType);
+		in[i].msg_hdr.msg_iov = &replyIov[i];
+		in[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	start = NowSec();
+	end = start + seconds;
+	inFlight = SendRequests(sockfd, out, window);
+	while (NowSec() < end)  {
+		if ((n = recvmmsg(sockfd, in, window, MSG_WAITFORONE, NULL)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)  {
+				perror("recvmmsg");
+				break;
+			}
+			// 응답이 끊김: 잃어버린 요청 대신 window를 다시 채움
+			lost++;
+			inFlight = SendRequests(sockfd, out, window);
+			continue;
+		}
+		done += n;
+		inFlight -= n;
+		if (inFlight < 0)		// 다시 채운 뒤에 늦게 온 응답
+			inFlight = 0;
+		inFlight += SendRequests(sockfd, out, window - inFlight);
+	}
+	seconds = NowSec() - start;
+	close(sockfd);
+	if (Unix)
+		remove(CliPath);
+
+	*requests = done;
+	*timeouts = lost;
+	return seconds;
+}
+
+/*===============================================================
+[Function Name] : StartServer
+[Description]   :
+    - 서버 프로그램을 "-q -b batch"로 띄운다. server에 공백이 있으면
+      (예: "taskset -c 0 ./udps") 셸로 실행한다.
+[Input]         :
+    - const char *server : 서버 프로그램
+    - int batch          : 서버의 일괄 처리 크기
+[Output]        :
+    - 없음
+[Call By]       :
+    - main()
+[Calls]         :
+    - fork(), execl(), usleep()
+[Given]         :
+    - 없음
+[Returns]       :
+    - pid_t : 서버 프로세스
+===============================================================*/
+pid_t
+StartServer(const char *server, int batch)
+{
+	char	cmd[512];
+	pid_t	pid;
+
+	snprintf(cmd, sizeof(cmd), "exec %s -q -b %d > /dev/null", server, batch);
+	if ((pid = fork()) < 0)  {
+		perror("fork");
+		exit(1);
+	}
+	if (pid == 0)  {
+		execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+		perror("execl");
+		_exit(1);
+	}
+	usleep(300000);		// 서버가 bind할 때까지
+	return pid;
+}
+
+int main(int argc, char *argv[])
+{
+	char			defList[] = "0,64";		// strtok()이 고쳐 쓰므로 배열로 둠
+	char			*server = NULL, *list = defList, *p;
+	double			seconds = 3, elapsed, cpu, pps[MAX_RUN], us[MAX_RUN];
+	int				batch[MAX_RUN], nRun = 0, window = 256, opt, i;
+	long			n, lost;
+	pid_t			pid;
+	struct rusage	ru;
+
+	while ((opt = getopt(argc, argv, "ud:w:S:B:")) != -1)  {
+		if (opt == 'u')
+			Unix = 1;
+		else if (opt == 'd')
+			seconds = atof(optarg);
+		else if (opt == 'w')
+			window = atoi(optarg);
+		else if (opt == 'S')
+			server = optarg;
+		else if (opt == 'B')
+			list = optarg;
+		else
+			break;
+	}
+	if (opt != -1 || seconds <= 0 || window < 1 || window > MAX_WINDOW)  {
+		fprintf(stderr, "Usage: %s [-u] [-d seconds] [-w window (1..%d)] [-S server [-B batch,...]]\n",
+				argv[0], MAX_WINDOW);
+		exit(1);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("label,requests,seconds,requests_per_sec,timeouts,server_us_per_req\n");
+	if (server == NULL)  {
+		elapsed = Measure(window, seconds, &n, &lost);
+		printf("%s,%ld,%.2f,%.0f,%ld,\n", Unix ? "unix-dg" : "udp", n, elapsed, n / elapsed, lost);
+		exit(0);
+	}
+
+	// 일괄 처리 크기마다 서버를 새로 띄워서 잰다
+	for (p = strtok(list, ",") ; p && nRun < MAX_RUN ; p = strtok(NULL, ","))  {
+		batch[nRun] = atoi(p);
+		pid = StartServer(server, batch[nRun]);
+		elapsed = Measure(window, seconds, &n, &lost);
+		kill(pid, SIGINT);
+		wait4(pid, NULL, 0, &ru);
+		if (Unix)
+			remove(UNIX_DG_PATH);
+
+		cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+		pps[nRun] = n / elapsed;
+		us[nRun] = n > 0 ? cpu * 1e6 / n : 0;
+		printf("%s-b%d,%ld,%.2f,%.0f,%ld,%.2f\n", Unix ? "unix-dg" : "udp", batch[nRun],
+			   n, elapsed, pps[nRun], lost, us[nRun]);
+		fflush(stdout);
+		nRun++;
+	}
+
+	// 첫 번째가 기존 루프(-b 0)이면 배율을 출력
+	for (i = 1 ; i < nRun && batch[0] == 0 && pps[0] > 0 && us[i] > 0 ; i++)
+		printf("batch %d: %.1fx requests/s, %.1fx less server CPU per request than the recvfrom()/sendto() loop\n",
+			   batch[i], pps[i] / pps[0], us[0] / us[i]);
+	return 0;
+}
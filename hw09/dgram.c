@@ -0,0 +1,169 @@
+/*===============================================================
+[Program Name] : dgram.c
+[Description]  :
+    - recvmmsg()/sendmmsg()로 데이터그램 요청을 일괄 처리하는 함수 구현.
+[Input]        :
+    - int sockfd : UDP 또는 UNIX 도메인 비연결형 서버 소켓
+[Output]       :
+    - 요청마다 응답 데이터그램 전송
+[Calls]        :
+    - recvmmsg(), sendmmsg(), calloc(), free()
+[특기사항]     :
+    - 응답은 요청 버퍼를 그대로 써서 만들므로 일괄 처리 한 번에 복사가 없다.
+    - 응답 하나를 보내지 못해도(클라이언트가 사라짐 등) 나머지는 보낸다.
+===============================================================*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "dgram.h"
+
+/*===============================================================
+[Function Name] : dgInit
+[Description]   :
+    - 요청 n개를 한 번에 받을 버퍼와 mmsghdr 배열을 만든다.
+[Input]         :
+    - DgBatch *b : 초기화할 일괄 처리 상태
+    - int n      : 일괄 처리 크기 (1..DG_BATCH_MAX)
+[Output]        :
+    - 없음
+[Call By]       :
+    - 데이터그램 서버의 main()
+[Calls]         :
+    - calloc(), perror()
+[Given]         :
+    - 없음
+[Returns]       :
+    - int : 성공 0, 실패 -1
+===============================================================*/
+int
+dgInit(DgBatch *b, int n)
+{
+	int		i;
+
+	memset(b, 0, sizeof(DgBatch));
+	if (n < 1 || n > DG_BATCH_MAX)  {
+		fprintf(stderr, "batch size must be 1..%d\n", DG_BATCH_MAX);
+		return -1;
+	}
+	b->n = n;
+	b->buf  = calloc(n, DG_MSG_MAX);
+	b->addr = calloc(n, sizeof(struct sockaddr_storage));
+	b->iov  = calloc(n, sizeof(struct iovec));
+	b->in   = calloc(n, sizeof(struct mmsghdr));
+	b->out  = calloc(n, sizeof(struct mmsghdr));
+	if (! b->buf || ! b->addr || ! b->iov || ! b->in || ! b->out)  {
+		perror("calloc");
+		dgDestroy(b);
+		return -1;
+	}
+
+	for (i = 0 ; i < n ; i++)  {
+		b->iov[i].iov_base = b->buf[i];
+		b->in[i].msg_hdr.msg_iov = &b->iov[i];
+		b->in[i].msg_hdr.msg_iovlen = 1;
+		b->in[i].msg_hdr.msg_name = &b->addr[i];
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : dgServe
+[Description]   :
+    - recvmmsg() 한 번으로 요청을 최대 b->n개 받고, 요청마다 reply를
+      불러 응답을 만든 뒤 sendmmsg()로 한꺼번에 보낸다.
+    - sendmmsg()가 일부만 보내면 나머지를 이어서 보낸다. 응답 하나가
+      실패하면 그것만 건너뛰고, 소켓 버퍼가 차면(EAGAIN) 남은 응답은 버린다.
+[Input]         :
+    - int sockfd        : 서버 소켓
+    - DgBatch *b        : 일괄 처리 상태 (dgInit()으로 초기화)
+    - int flags         : recvmmsg() 플래그
+                          (블록하는 서버는 MSG_WAITFORONE, 이벤트 루프는 MSG_DONTWAIT)
+    - DgReplyFunc reply : 응답을 만드는 함수
+    - void *arg         : reply에 넘길 인자
+[Output]        :
+    - 요청마다 응답 데이터그램 전송
+[Call By]       :
+    - 데이터그램 서버의 요청 처리 루프
+[Calls]         :
+    - recvmmsg(), sendmmsg(), reply
+[Given]         :
+    - 없음
+[Returns]       :
+    - int : 받은 요청 수, 받을 요청이 없으면(MSG_DONTWAIT) 0, 실패 -1
+===============================================================*/
+int
+dgServe(int sockfd, DgBatch *b, int flags, DgReplyFunc reply, void *arg)
+{
+	struct mmsghdr	*h;
+	int				i, n, len, nOut = 0, sent = 0;
+
+	for (i = 0 ; i < b->n ; i++)  {
+		b->iov[i].iov_len = DG_MSG_MAX;
+		b->in[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+	}
+	while ((n = recvmmsg(sockfd, b->in, b->n, flags, NULL)) < 0 && errno == EINTR)
+		;
+	if (n < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+	b->nBatch++;
+	b->nRecv += n;
+
+	// 요청 버퍼에 응답을 만들고, 응답할 것만 out에 모음
+	for (i = 0 ; i < n ; i++)  {
+		if ((len = reply(b->buf[i], b->in[i].msg_len, arg)) <= 0)
+			continue;
+		b->iov[i].iov_len = len;
+		h = &b->out[nOut++];
+		h->msg_hdr = b->in[i].msg_hdr;		// 받은 주소와 길이로 응답
+		h->msg_len = 0;
+	}
+
+	while (sent < nOut)  {
+		if ((i = sendmmsg(sockfd, b->out + sent, nOut - sent, 0)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)  {
+				b->nDrop += nOut - sent;
+				break;
+			}
+			perror("sendmmsg");
+			b->nDrop++;
+			sent++;		// 이 응답만 건너뜀
+			continue;
+		}
+		sent += i;
+	}
+
+	return n;
+}
+
+/*===============================================================
+[Function Name] : dgDestroy
+[Description]   :
+    - dgInit()에서 만든 버퍼를 반납한다.
+[Input]         :
+    - DgBatch *b : 일괄 처리 상태
+[Output]        :
+    - 없음
+[Call By]       :
+    - dgInit()
+[Calls]         :
+    - free()
+[Given]         :
+    - 없음
+[Returns]       :
+    - 없음
+===============================================================*/
+void
+dgDestroy(DgBatch *b)
+{
+	free(b->buf);
+	free(b->addr);
+	free(b->iov);
+	free(b->in);
+	free(b->out);
+	memset(b, 0, sizeof(DgBatch));
+}
@@ -0,0 +1,49 @@
+/*===============================================================
+[Program Name] : dgram.h
+[Description]  :
+    - 데이터그램 서버(udps, ucls, select)가 함께 쓰는 일괄(batch) 요청 처리 선언.
+    - dgServe()는 recvmmsg() 한 번으로 요청을 최대 n개 받고, 요청마다
+      응답 함수를 불러 같은 버퍼에 응답을 만든 뒤, sendmmsg() 한 번으로
+      모든 응답을 돌려보낸다. 요청 하나마다 시스템 호출 두 번을 하던
+      recvfrom()/sendto() 루프보다 시스템 호출 수가 1/n로 줄어든다.
+    - 보낸 쪽 주소는 sockaddr_storage에 받으므로 UDP와 UNIX 도메인
+      비연결형 소켓에 모두 쓸 수 있다.
+[특기사항]     :
+    - 함수 정의는 dgram.c에 있음.
+    - 메시지 형식(MsgType)은 서버마다 헤더에 따로 있으므로, 여기서는
+      DG_MSG_MAX 바이트 버퍼로만 다루고 해석은 응답 함수가 한다.
+===============================================================*/
+
+#ifndef _DGRAM_H_
+#define _DGRAM_H_
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define	DG_BATCH		64			// 기본 일괄 처리 크기
+#define	DG_BATCH_MAX	1024		// 일괄 처리 최대 크기 (UIO_MAXIOV)
+#define	DG_MSG_MAX		256			// 요청/응답 데이터그램 최대 크기
+
+// 요청 buf(len 바이트)를 읽고 같은 버퍼에 응답을 만들어 응답 길이를 리턴
+// (0 이하이면 그 요청에는 응답하지 않음)
+typedef int	(*DgReplyFunc)(char *buf, int len, void *arg);
+
+typedef struct  {
+	int						n;			// 일괄 처리 크기
+	char					(*buf)[DG_MSG_MAX];
+	struct sockaddr_storage	*addr;		// 요청을 보낸 주소 (응답할 주소)
+	struct iovec			*iov;
+	struct mmsghdr			*in;		// recvmmsg()용
+	struct mmsghdr			*out;		// sendmmsg()용 (응답할 것만 모음)
+	long					nBatch;		// recvmmsg() 횟수
+	long					nRecv;		// 받은 요청 수
+	long					nDrop;		// 보내지 못한 응답 수
+}
+	DgBatch;
+
+int		dgInit(DgBatch *b, int n);
+int		dgServe(int sockfd, DgBatch *b, int flags, DgReplyFunc reply, void *arg);
+void	dgDestroy(DgBatch *b);
+
+#endif
@@ -3,8 +3,11 @@
 [Description]  : 
     - 여러 종류의 소켓(TCP, UDP, UNIX 도메인 연결 지향형, 
       UNIX 도메인 비연결형)을 생성하고 관리하여 클라이언트의 요청을 처리한다.
-    - select 시스템 호출을 사용하여 다중 소켓을 모니터링하고 
+    - epoll로 서버 소켓과 accept한 연결을 모두 모니터링하고
       이벤트가 발생한 소켓에 대해 적절한 요청 처리 함수를 호출한다.
+    - 모든 소켓은 non-blocking이며, accept한 TCP/UNIX 연결 지향형 연결은
+      연결마다 상태(요청 읽는 중 -> 응답 쓰는 중)를 두고 준비될 때마다
+      조금씩 진행한다. 느린 클라이언트 하나가 다른 요청을 막지 않는다.
     - SIGINT 시그널을 처리하여 서버 종료 시 모든 소켓을 닫고 소켓 파일을 삭제한다.
 [Input]        : 
     - 클라이언트의 요청 메시지
@@ -13,11 +16,15 @@
     - 클라이언트로 응답 메시지 전송
     - "Server daemon started....." 및 각 요청 처리 상태 메시지를 콘솔에 출력
 [Calls]        : 
-    - socket(), bind(), listen(), accept(), read(), write(), recvfrom(), sendto(), close(), signal(), remove(), select()
+    - socket(), bind(), listen(), accept(), read(), write(), recvmmsg(), sendmmsg(), close(), signal(), remove(),
+      fcntl(), epoll_create1(), epoll_ctl(), epoll_wait()
 [특기사항]     : 
     - "select.h" 파일에 MsgType, SERV_TCP_PORT, SERV_UDP_PORT, UNIX_STR_PATH, UNIX_DG_PATH 등의 정의가 필요
     - TCP, UDP, UNIX 도메인 소켓을 모두 지원하는 멀티 프로토콜 서버 구현
-    - select 시스템 호출을 사용하여 효율적으로 다중 소켓을 관리
+    - epoll은 준비된 소켓만 돌려주므로 동시 연결이 수천 개여도 감시 비용이
+      연결 수에 비례하지 않는다. (select()의 FD_SETSIZE 제한도 없음)
+    - UDP/UNIX 도메인 비연결형 요청은 dgram.h로 recvmmsg() 한 번에 여러 개 받고
+      sendmmsg() 한 번으로 응답한다.
     - 서버 종료 시 UNIX 도메인 소켓 파일을 삭제하여 리소스 정리
 ===============================================================*/
 #include <stdio.h>
@@ -29,12 +36,49 @@
 #include <signal.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
 #include "select.h"
+#include "dgram.h"
 
-int	TcpSockfd;
-int	UdpSockfd;
-int	UcoSockfd;
-int	UclSockfd;
+#define	MAX_EVENTS		64		// epoll_wait() 한 번에 받는 이벤트 수
+
+#define	KIND_TCP		0		// 서버 소켓 종류 (Listeners[] 인덱스)
+#define	KIND_UDP		1
+#define	KIND_UCO		2
+#define	KIND_UCL		3
+#define	KIND_CONN		4		// accept한 연결 (TCP 또는 UNIX 연결 지향형)
+
+#define	STATE_READ		0		// 요청을 읽는 중
+#define	STATE_WRITE		1		// 응답을 쓰는 중
+
+/*===============================================================
+[Function Name] : 구조체 정의 (ConnType)
+[Description]   : 
+    - epoll에 등록한 소켓 하나의 상태. epoll 이벤트의 data.ptr이 가리킨다.
+    - 서버 소켓은 kind만 쓰고, accept한 연결은 요청/응답을 주고받는
+      동안 msg와 지금까지 읽거나 쓴 바이트 수(off)를 가진다.
+===============================================================*/
+typedef struct  {
+	int		kind;		// KIND_*
+	int		fd;
+	int		proto;		// 연결의 서버 소켓 종류 (KIND_TCP, KIND_UCO)
+	int		state;		// STATE_READ, STATE_WRITE
+	int		off;		// msg에서 읽거나 쓴 바이트 수
+	MsgType	msg;
+}
+	ConnType;
+
+int			TcpSockfd;
+int			UdpSockfd;
+int			UcoSockfd;
+int			UclSockfd;
+int			Epfd;
+ConnType	Listeners[4];	// 서버 소켓 (KIND_TCP .. KIND_UCL)
+DgBatch		Dgrams;			// UDP/UNIX 비연결형 요청 일괄 처리 버퍼
 
 /*===============================================================
 [Function Name] : CloseServer
@@ -60,6 +104,7 @@ CloseServer()
 	close(UdpSockfd);   // UDP 소켓 닫기
 	close(UcoSockfd);   // UNIX 도메인 연결 지향형 소켓 닫기
 	close(UclSockfd);   // UNIX 도메인 비연결형 소켓 닫기
+	close(Epfd);
 	if (remove(UNIX_STR_PATH) < 0)  { // UNIX 도메인 연결 지향형 소켓 파일 삭제
 		perror("remove");
 	}
@@ -111,8 +156,8 @@ MakeTcpSocket()
 		exit(1);
 	}
 
-	// 연결 요청 대기 상태로 설정
-	listen(TcpSockfd, 5);
+	// 연결 요청 대기 상태로 설정 (동시 접속이 몰려도 backlog에서 기다림)
+	listen(TcpSockfd, SOMAXCONN);
 }
 
 /*===============================================================
@@ -197,8 +242,8 @@ MakeUcoSocket()
 		exit(1);
 	}
 
-	// 연결 요청 대기 상태로 설정
-	listen(UcoSockfd, 5);
+	// 연결 요청 대기 상태로 설정 (동시 접속이 몰려도 backlog에서 기다림)
+	listen(UcoSockfd, SOMAXCONN);
 }
 
 /*===============================================================
@@ -244,212 +289,319 @@ MakeUclSocket()
 }
 
 /*===============================================================
-[Function Name] : ProcessTcpRequest
+[Function Name] : SetNonBlocking
 [Description]   : 
-    - TCP 소켓을 통해 들어온 클라이언트의 요청을 읽고, 응답을 전송한다.
+    - fd에 O_NONBLOCK 플래그를 설정한다. (read()/write()/accept()가 블록되지 않도록)
 [Input]         : 
-    - 없음 (글로벌 변수 TcpSockfd 사용)
+    - int fd : 파일 디스크립터
 [Output]        : 
-    - 클라이언트의 요청 메시지를 콘솔에 출력
-    - 클라이언트에게 응답 메시지를 전송하고 "Replied." 메시지를 콘솔에 출력
+    - 없음
+[Call By]       : 
+    - WatchSocket(), AcceptConn()
+[Calls]         : 
+    - fcntl()
+[Given]         : 
+    - 없음
+[Returns]       : 
+    - int : 성공 0, 실패 -1
+===============================================================*/
+int
+SetNonBlocking(int fd)
+{
+	int		flags;
+
+	if ((flags = fcntl(fd, F_GETFL, 0)) < 0)
+		return -1;
+	return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/*===============================================================
+[Function Name] : WatchSocket
+[Description]   : 
+    - 서버 소켓을 non-blocking으로 만들고 epoll에 등록한다.
+[Input]         : 
+    - int fd   : 서버 소켓
+    - int kind : KIND_TCP, KIND_UDP, KIND_UCO, KIND_UCL
+[Output]        : 
+    - 없음
 [Call By]       : 
     - main()
 [Calls]         : 
-    - accept(), read(), write(), printf(), perror(), exit(), close()
+    - SetNonBlocking(), epoll_ctl(), perror(), exit()
 [Given]         : 
-    - TcpSockfd가 유효한 TCP 소켓 디스크립터를 가리키고 있다고 가정
+    - 글로벌 변수 Epfd, Listeners
 [Returns]       : 
     - 없음
 ===============================================================*/
 void
-ProcessTcpRequest()
+WatchSocket(int fd, int kind)
 {
-	int					newSockfd, cliAddrLen, n;
-	struct sockaddr_in	cliAddr;
-	MsgType				msg;
-
-	cliAddrLen = sizeof(cliAddr);
-	// 클라이언트 연결 수락
-	newSockfd = accept(TcpSockfd, (struct sockaddr *) &cliAddr, &cliAddrLen);
-	if (newSockfd < 0)  {
-		perror("accept");
-		exit(1);
-	}
-		
-	// 클라이언트로부터 메시지 읽기
-	if ((n = read(newSockfd, (char *)&msg, sizeof(msg))) < 0)  {
-		perror("read");
+	struct epoll_event	ev;
+
+	Listeners[kind].kind = kind;
+	Listeners[kind].fd = fd;
+	ev.events = EPOLLIN;
+	ev.data.ptr = &Listeners[kind];
+	if (SetNonBlocking(fd) < 0 || epoll_ctl(Epfd, EPOLL_CTL_ADD, fd, &ev) < 0)  {
+		perror("epoll_ctl");
 		exit(1);
 	}
-	printf("Received TCP request: %s.....", msg.data);
+}
 
-	// 응답 메시지 작성
-	msg.type = MSG_REPLY;
-	sprintf(msg.data, "This is a reply from %d.", getpid());
+/*===============================================================
+[Function Name] : MakeReply
+[Description]   : 
+    - 요청 메시지 msg를 콘솔에 출력하고 같은 버퍼에 응답 메시지를 만든다.
+[Input]         : 
+    - MsgType *msg     : 요청 메시지 (응답으로 바뀜)
+    - const char *what : 요청 종류 ("TCP", "UDP", ...)
+[Output]        : 
+    - 클라이언트의 요청 메시지를 콘솔에 출력
+[Call By]       : 
+    - ProcessConn(), DgramReply()
+[Calls]         : 
+    - printf(), sprintf()
+[Given]         : 
+    - 없음
+[Returns]       : 
+    - 없음
+===============================================================*/
+void
+MakeReply(MsgType *msg, const char *what)
+{
+	msg->data[sizeof(msg->data) - 1] = '\0';
+	printf("Received %s request: %s.....", what, msg->data);
 
-	// 클라이언트에게 응답 메시지 전송
-	if (write(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
-		perror("write");
-		exit(1);
-	}
-	printf("Replied.\n");
+	// 응답 메시지 작성
+	msg->type = MSG_REPLY;
+	sprintf(msg->data, "This is a reply from %d.", getpid());
+}
 
-	close(newSockfd); // 클라이언트 소켓 닫기
+/*===============================================================
+[Function Name] : CloseConn
+[Description]   : 
+    - 연결을 닫고 상태를 반납한다. (close()하면 epoll에서도 빠진다)
+[Input]         : 
+    - ConnType *c : 연결
+[Output]        : 
+    - 없음
+[Call By]       : 
+    - ProcessConn()
+[Calls]         : 
+    - close(), free()
+[Given]         : 
+    - 없음
+[Returns]       : 
+    - 없음
+===============================================================*/
+void
+CloseConn(ConnType *c)
+{
+	close(c->fd); // 클라이언트 소켓 닫기
+	free(c);
 }
 
 /*===============================================================
-[Function Name] : ProcessUdpRequest
+[Function Name] : AcceptConn
 [Description]   : 
-    - UDP 소켓을 통해 들어온 클라이언트의 요청을 읽고, 응답을 전송한다.
+    - TCP 또는 UNIX 도메인 연결 지향형 서버 소켓에 대기 중인 연결을
+      EAGAIN까지 모두 accept하여, 요청을 읽는 상태로 epoll에 등록한다.
+    - accept가 실패해도(fd 부족 등) 서버는 계속 동작한다.
 [Input]         : 
-    - 없음 (글로벌 변수 UdpSockfd 사용)
+    - ConnType *lsn : 서버 소켓 (Listeners[KIND_TCP] 또는 Listeners[KIND_UCO])
 [Output]        : 
-    - 클라이언트의 요청 메시지를 콘솔에 출력
-    - 클라이언트에게 응답 메시지를 전송하고 "Replied." 메시지를 콘솔에 출력
+    - 없음
 [Call By]       : 
     - main()
 [Calls]         : 
-    - recvfrom(), sendto(), printf(), perror(), exit()
+    - accept(), SetNonBlocking(), malloc(), epoll_ctl(), perror(), close()
 [Given]         : 
-    - UdpSockfd가 유효한 UDP 소켓 디스크립터를 가리키고 있다고 가정
+    - 글로벌 변수 Epfd
 [Returns]       : 
     - 없음
 ===============================================================*/
 void
-ProcessUdpRequest()
+AcceptConn(ConnType *lsn)
 {
-	int					cliAddrLen, n;
-	struct sockaddr_in	cliAddr;
-	MsgType				msg;
-
-	cliAddrLen = sizeof(cliAddr);
-	// 클라이언트로부터 메시지 수신
-	if ((n = recvfrom(UdpSockfd, (char *)&msg, sizeof(msg), 
-				0, (struct sockaddr *)&cliAddr, &cliAddrLen)) < 0)  {
-		perror("recvfrom");
-		exit(1);
-	}
-	printf("Received UDP request: %s.....", msg.data);
+	struct epoll_event	ev;
+	ConnType			*c;
+	int					newSockfd;
 
-	// 응답 메시지 작성
-	msg.type = MSG_REPLY;
-	sprintf(msg.data, "This is a reply from %d.", getpid());
-
-	// 클라이언트에게 응답 메시지 전송
-	if (sendto(UdpSockfd, (char *)&msg, sizeof(msg),
-				0, (struct sockaddr *)&cliAddr, cliAddrLen) < 0)  {
-		perror("sendto");
-		exit(1);
+	while (1)  {
+		// 클라이언트 연결 수락 (주소는 쓰지 않음)
+		if ((newSockfd = accept(lsn->fd, NULL, NULL)) < 0)  {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				perror("accept");
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			return;
+		}
+		if (SetNonBlocking(newSockfd) < 0 || (c = malloc(sizeof(ConnType))) == NULL)  {
+			perror("accept");
+			close(newSockfd);
+			continue;
+		}
+		c->kind = KIND_CONN;
+		c->fd = newSockfd;
+		c->proto = lsn->kind;
+		c->state = STATE_READ;
+		c->off = 0;
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if (epoll_ctl(Epfd, EPOLL_CTL_ADD, newSockfd, &ev) < 0)  {
+			perror("epoll_ctl");
+			CloseConn(c);
+		}
 	}
-	printf("Replied.\n");
 }
 
 /*===============================================================
-[Function Name] : ProcessUcoRequest
+[Function Name] : ProcessConn
 [Description]   : 
-    - UNIX 도메인 연결 지향형 소켓을 통해 들어온 클라이언트의 요청을 읽고, 응답을 전송한다.
+    - accept한 연결의 상태를 준비된 만큼 진행한다.
+        STATE_READ  : 요청 메시지를 끝까지 읽으면 응답을 만들고 STATE_WRITE로
+        STATE_WRITE : 응답을 끝까지 쓰면 연결을 닫음
+    - 읽거나 쓸 수 없으면(EAGAIN) 그 상태로 돌아가고, 다음 이벤트에서
+      이어서 한다. 응답을 한 번에 다 쓰지 못하면 EPOLLOUT을 기다린다.
+    - 연결의 오류는 그 연결만 닫는다.
 [Input]         : 
-    - 없음 (글로벌 변수 UcoSockfd 사용)
+    - ConnType *c : 연결
 [Output]        : 
     - 클라이언트의 요청 메시지를 콘솔에 출력
     - 클라이언트에게 응답 메시지를 전송하고 "Replied." 메시지를 콘솔에 출력
 [Call By]       : 
     - main()
 [Calls]         : 
-    - accept(), read(), write(), printf(), perror(), exit(), close()
+    - read(), write(), MakeReply(), epoll_ctl(), CloseConn(), printf(), perror()
 [Given]         : 
-    - UcoSockfd가 유효한 UNIX 도메인 연결 지향형 소켓 디스크립터를 가리키고 있다고 가정
+    - 글로벌 변수 Epfd
 [Returns]       : 
     - 없음
 ===============================================================*/
 void
-ProcessUcoRequest()
+ProcessConn(ConnType *c)
 {
-	int					newSockfd, cliAddrLen, n;
-	struct sockaddr_un	cliAddr;
-	MsgType				msg;
-
-	cliAddrLen = sizeof(cliAddr);
-	// 클라이언트 연결 수락
-	newSockfd = accept(UcoSockfd, (struct sockaddr *) &cliAddr, &cliAddrLen);
-	if (newSockfd < 0)  {
-		perror("accept");
-		exit(1);
-	}
-		
-	// 클라이언트로부터 메시지 읽기
-	if ((n = read(newSockfd, (char *)&msg, sizeof(msg))) < 0)  {
-		perror("read");
-		exit(1);
+	struct epoll_event	ev;
+	int					n;
+
+	if (c->state == STATE_READ)  {
+		// 클라이언트로부터 메시지 읽기 (여러 번에 나뉘어 올 수 있음)
+		while (c->off < sizeof(c->msg))  {
+			if ((n = read(c->fd, (char *)&c->msg + c->off, sizeof(c->msg) - c->off)) < 0)  {
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return;
+				perror("read");
+				CloseConn(c);
+				return;
+			}
+			if (n == 0)  {		// 요청을 다 보내기 전에 끊음
+				CloseConn(c);
+				return;
+			}
+			c->off += n;
+		}
+		MakeReply(&c->msg, c->proto == KIND_TCP ? "TCP" : "UNIX-domain CO");
+		c->state = STATE_WRITE;
+		c->off = 0;
 	}
-	printf("Received UNIX-domain CO request: %s.....", msg.data);
-
-	// 응답 메시지 작성
-	msg.type = MSG_REPLY;
-	sprintf(msg.data, "This is a reply from %d.", getpid());
 
 	// 클라이언트에게 응답 메시지 전송
-	if (write(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
-		perror("write");
-		exit(1);
+	while (c->off < sizeof(c->msg))  {
+		if ((n = write(c->fd, (char *)&c->msg + c->off, sizeof(c->msg) - c->off)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)  {
+				// 소켓 버퍼가 비면 이어서 씀
+				ev.events = EPOLLOUT;
+				ev.data.ptr = c;
+				if (epoll_ctl(Epfd, EPOLL_CTL_MOD, c->fd, &ev) < 0)  {
+					perror("epoll_ctl");
+					CloseConn(c);
+				}
+				return;
+			}
+			perror("write");
+			CloseConn(c);
+			return;
+		}
+		c->off += n;
 	}
 	printf("Replied.\n");
 
-	close(newSockfd); // 클라이언트 소켓 닫기
+	CloseConn(c);
 }
 
 /*===============================================================
-[Function Name] : ProcessUclRequest
+[Function Name] : DgramReply
 [Description]   : 
-    - UNIX 도메인 비연결형 소켓을 통해 들어온 클라이언트의 요청을 읽고, 응답을 전송한다.
+    - 데이터그램 요청 하나에 대한 응답을 같은 버퍼에 만든다. (dgServe()의 응답 함수)
 [Input]         : 
-    - 없음 (글로벌 변수 UclSockfd 사용)
+    - char *buf : 요청 데이터그램
+    - int len   : 요청 길이
+    - void *arg : 요청 종류 ("UDP", "UNIX-domain CL")
 [Output]        : 
-    - 클라이언트의 요청 메시지를 콘솔에 출력
-    - 클라이언트에게 응답 메시지를 전송하고 "Replied." 메시지를 콘솔에 출력
+    - 클라이언트의 요청 메시지와 "Replied." 메시지를 콘솔에 출력
+[Call By]       : 
+    - dgServe() in ProcessDgram()
+[Calls]         : 
+    - MakeReply(), memset(), printf()
+[Given]         : 
+    - 없음
+[Returns]       : 
+    - int : 응답 길이
+===============================================================*/
+int
+DgramReply(char *buf, int len, void *arg)
+{
+	if (len < sizeof(MsgType))
+		memset(buf + len, 0, sizeof(MsgType) - len);
+	MakeReply((MsgType *)buf, arg);
+	printf("Replied.\n");
+
+	return sizeof(MsgType);
+}
+
+/*===============================================================
+[Function Name] : ProcessDgram
+[Description]   : 
+    - UDP 또는 UNIX 도메인 비연결형 소켓에 도착한 요청을 EAGAIN까지
+      recvmmsg()로 여러 개씩 읽고, 응답은 sendmmsg()로 한꺼번에 보낸다.
+    - 응답을 보낼 수 없으면(소켓 버퍼 부족, 클라이언트 소켓이 사라짐 등)
+      그 응답만 버린다. (데이터그램은 재전송을 클라이언트가 맡음)
+[Input]         : 
+    - ConnType *lsn : 서버 소켓 (Listeners[KIND_UDP] 또는 Listeners[KIND_UCL])
+[Output]        : 
+    - 클라이언트에게 응답 메시지 전송
 [Call By]       : 
     - main()
 [Calls]         : 
-    - recvfrom(), sendto(), printf(), perror(), exit()
+    - dgServe(), DgramReply(), perror()
 [Given]         : 
-    - UclSockfd가 유효한 UNIX 도메인 비연결형 소켓 디스크립터를 가리키고 있다고 가정
+    - 글로벌 변수 Dgrams
 [Returns]       : 
     - 없음
 ===============================================================*/
 void
-ProcessUclRequest()
+ProcessDgram(ConnType *lsn)
 {
-	int					cliAddrLen, n;
-	struct sockaddr_un	cliAddr;
-	MsgType				msg;
-
-	cliAddrLen = sizeof(cliAddr);
-	// 클라이언트로부터 메시지 수신
-	if ((n = recvfrom(UclSockfd, (char *)&msg, sizeof(msg), 
-				0, (struct sockaddr *)&cliAddr, &cliAddrLen)) < 0)  {
-		perror("recvfrom");
-		exit(1);
-	}
-	printf("Received UNIX-domain CL request: %s.....", msg.data);
-
-	// 응답 메시지 작성
-	msg.type = MSG_REPLY;
-	sprintf(msg.data, "This is a reply from %d.", getpid());
-
-	// 클라이언트에게 응답 메시지 전송
-	if (sendto(UclSockfd, (char *)&msg, sizeof(msg),
-				0, (struct sockaddr *)&cliAddr, cliAddrLen) < 0)  {
-		perror("sendto");
-		exit(1);
-	}
-	printf("Replied.\n");
+	const char	*what = lsn->kind == KIND_UDP ? "UDP" : "UNIX-domain CL";
+	int			n;
+
+	// 한 번에 다 받으면 (n < Dgrams.n) 더 기다리는 요청이 없음
+	while ((n = dgServe(lsn->fd, &Dgrams, MSG_DONTWAIT, DgramReply, (void *)what)) == Dgrams.n)
+		;
+	if (n < 0)
+		perror("recvmmsg");
 }
 
 /*===============================================================
 [Function Name] : main
 [Description]   : 
-    - 서버 소켓들을 초기화하고 select 시스템 호출을 통해 
-      다중 소켓을 모니터링하여 클라이언트의 요청을 처리한다.
+    - 서버 소켓들을 초기화하여 epoll에 등록하고, 준비된 소켓마다
+      요청 처리 함수를 호출한다.
 [Input]         : 
     - 없음
 [Output]        : 
@@ -458,7 +610,8 @@ ProcessUclRequest()
 [Call By]       : 
     - 시스템 호출에 의해 자동으로 호출
 [Calls]         : 
-    - signal(), MakeTcpSocket(), MakeUdpSocket(), MakeUcoSocket(), MakeUclSocket(), select(), FD_ZERO(), FD_SET(), FD_ISSET(), ProcessTcpRequest(), ProcessUdpRequest(), ProcessUcoRequest(), ProcessUclRequest(), perror(), exit()
+    - signal(), MakeTcpSocket(), MakeUdpSocket(), MakeUcoSocket(), MakeUclSocket(), epoll_create1(),
+      dgInit(), WatchSocket(), epoll_wait(), AcceptConn(), ProcessConn(), ProcessDgram(), perror(), exit()
 [Given]         : 
     - "select.h" 파일에 필요한 정의들이 모두 포함되어 있어야 함
 [Returns]       : 
@@ -466,11 +619,13 @@ ProcessUclRequest()
 ===============================================================*/
 int main(int argc, char *argv[])
 {
-	fd_set	fdvar;
-	int		count;
+	struct epoll_event	events[MAX_EVENTS];
+	ConnType			*c;
+	int					count, i;
 
 	// SIGINT 시그널 처리 등록 (Ctrl+C 시 CloseServer 호출)
 	signal(SIGINT, CloseServer);
+	signal(SIGPIPE, SIG_IGN);	// 응답 전에 끊은 클라이언트 때문에 죽지 않도록
 
 	// 각 소켓 생성 및 설정
 	MakeTcpSocket();
@@ -478,38 +633,41 @@ int main(int argc, char *argv[])
 	MakeUcoSocket();
 	MakeUclSocket();
 
+	// 서버 소켓 4개를 epoll에 등록 (연결은 accept할 때 등록)
+	if ((Epfd = epoll_create1(0)) < 0)  {
+		perror("epoll_create1");
+		exit(1);
+	}
+	if (dgInit(&Dgrams, DG_BATCH) < 0)
+		exit(1);
+	WatchSocket(TcpSockfd, KIND_TCP);
+	WatchSocket(UdpSockfd, KIND_UDP);
+	WatchSocket(UcoSockfd, KIND_UCO);
+	WatchSocket(UclSockfd, KIND_UCL);
+
 	printf("Server daemon started.....\n");
 
 	while (1)  {
-		// 파일 디스크립터 집합 초기화
-		FD_ZERO(&fdvar);
-		FD_SET(TcpSockfd, &fdvar);   // TCP 소켓 추가
-		FD_SET(UdpSockfd, &fdvar);   // UDP 소켓 추가
-		FD_SET(UcoSockfd, &fdvar);   // UNIX 도메인 연결 지향형 소켓 추가
-		FD_SET(UclSockfd, &fdvar);   // UNIX 도메인 비연결형 소켓 추가
-
-		// select 호출: 파일 디스크립터 집합 중 이벤트가 발생한 것을 감지
-		if ((count = select(10, &fdvar, (fd_set *)NULL, (fd_set *)NULL, 
-			(struct timeval *)NULL)) < 0)  {
-			perror("select");
+		// 준비된 소켓만 돌려받음
+		if ((count = epoll_wait(Epfd, events, MAX_EVENTS, -1)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			perror("epoll_wait");
 			exit(1);
 		}
 
-		// 이벤트가 발생한 파일 디스크립터에 대해 요청 처리
-		while (count--)  {
-			if (FD_ISSET(TcpSockfd, &fdvar))  {
-				ProcessTcpRequest();
-			}
-			else if (FD_ISSET(UdpSockfd, &fdvar))  {
-				ProcessUdpRequest();
+		// 이벤트가 발생한 소켓마다 요청 처리
+		for (i = 0 ; i < count ; i++)  {
+			c = events[i].data.ptr;
+			if (c->kind == KIND_TCP || c->kind == KIND_UCO)  {
+				AcceptConn(c);
 			}
-			else if (FD_ISSET(UcoSockfd, &fdvar))  {
-				ProcessUcoRequest();
+			else if (c->kind == KIND_UDP || c->kind == KIND_UCL)  {
+				ProcessDgram(c);
 			}
-			else if (FD_ISSET(UclSockfd, &fdvar))  {
-				ProcessUclRequest();
+			else  {
+				ProcessConn(c);
 			}
 		}
 	}
 }
-
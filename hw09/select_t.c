@@ -3,21 +3,29 @@
 [Description]  : 
     - 다중 소켓(TCP, UDP, UNIX 도메인 연결 지향형, UNIX 도메인 비연결형)을 생성하고 관리하여
       클라이언트의 요청을 처리하는 스레드 기반 서버를 구현한다.
-    - select 시스템 호출을 사용하여 다중 소켓을 모니터링하고, 이벤트가 발생한 소켓에 대해
-      새로운 스레드를 생성하여 요청을 전담 처리한다.
+    - select 시스템 호출을 사용하여 다중 소켓을 모니터링하고, accept한 TCP/UNIX 도메인
+      연결 지향형 요청은 미리 만들어 둔 작업자 스레드 풀에 넘겨 처리한다.
     - SIGINT 시그널을 처리하여 서버 종료 시 모든 소켓을 닫고 소켓 파일을 삭제한다.
 [Input]        : 
+    - argv[1] : 작업자 스레드 수 (기본: CPU 코어 수)
     - 클라이언트의 요청 메시지
     - 서버는 클라이언트의 주소 정보를 사용하여 응답을 전송
 [Output]       : 
     - 클라이언트로 응답 메시지 전송
     - "Server daemon started....." 및 각 요청 처리 상태 메시지를 콘솔에 출력
 [Calls]        : 
-    - socket(), bind(), listen(), accept(), recvfrom(), sendto(), read(), write(), close(), signal(), remove(), select(), pthread_create(), perror(), exit(), strcpy(), strlen(), memcpy()
+    - socket(), bind(), listen(), accept(), recvfrom(), sendto(), read(), write(), close(), signal(), remove(), select(), pthread_create(), sem_wait(), sem_post(), perror(), exit(), strcpy(), strlen(), memcpy()
 [특기사항]     : 
     - "select.h" 파일에 MsgType, SERV_TCP_PORT, SERV_UDP_PORT, UNIX_STR_PATH, UNIX_DG_PATH 등의 정의가 필요
     - 스레드 안전성을 위해 동기화가 필요한 경우 추가 구현 필요
-    - 각 클라이언트 요청을 처리하기 위해 새로운 스레드를 생성하여 독립적으로 처리
+    - 요청마다 스레드를 만들지 않는다. 작업자마다 work-stealing 큐(WsQueue)가 있고,
+      main(dispatcher)이 accept한 소켓을 작업자 큐에 돌아가며 넣는다. 자기 큐가 빈
+      작업자는 다른 작업자의 큐에서 훔쳐 오므로, 느린 요청이 한 큐에 몰려도
+      나머지 요청이 그 뒤에서 기다리지 않는다.
+    - 큐에 넣는 쪽은 dispatcher 하나뿐이므로 큐는 single-producer이고, 꺼내는 쪽
+      (주인과 훔치는 작업자)은 모두 top을 CAS로 늘려 가져간다. (lock 없음)
+    - 요청 하나마다 Work 세마포어를 한 번 올리므로, 세마포어를 얻은 작업자는
+      어느 큐엔가 자기 몫의 요청이 있음을 안다. 할 일이 없으면 세마포어에서 잠든다.
     - 오류 발생 시 perror를 통해 에러 메시지를 출력하고 프로그램을 종료
 ===============================================================*/
 #include <stdio.h>
@@ -26,6 +34,8 @@
 #include <unistd.h>
 #include <signal.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -39,21 +49,39 @@ int UdpSockfd;
 int UcoSockfd;
 int UclSockfd;
 
-// 자식 스레드에서 사용할 데이터 구조체
+#define MAX_WORKER      64
+#define WS_SIZE         1024    // 작업자 큐 크기 (2의 거듭제곱)
+
+// 큐 항목: 소켓과 종류(TCP 또는 UNIX 도메인 연결 지향형)
+#define JOB_TCP         0
+#define JOB_UCO         1
+#define JOB(fd, kind)   (((fd) << 1) | (kind))
+#define JOB_FD(job)     ((job) >> 1)
+#define JOB_KIND(job)   ((job) & 1)
+
+// 작업자별 work-stealing 큐 (dispatcher만 bottom에 넣고, 누구나 top에서 꺼냄)
 typedef struct {
-    int sockfd;
-    struct sockaddr_in cliAddr;
-} TcpClientData;
+    _Alignas(64) atomic_long top;       // 다음에 꺼낼 위치 (꺼내는 쪽이 CAS)
+    _Alignas(64) atomic_long bottom;    // 다음에 넣을 위치 (dispatcher만 씀)
+    atomic_int job[WS_SIZE];
+} WsQueue;
 
 typedef struct {
-    int sockfd;
-    struct sockaddr_in cliAddr;
-} UdpClientData;
+    pthread_t tid;
+    int id;
+    WsQueue q;
+    long served;        // 처리한 요청 수
+    long stolen;        // 그중 다른 작업자의 큐에서 훔친 수
+} Worker;
+
+Worker *Workers;
+int NWorker;
+sem_t Work;             // 아직 아무도 맡지 않은 요청 수
 
 typedef struct {
     int sockfd;
-    struct sockaddr_un cliAddr;
-} UnixStreamClientData;
+    struct sockaddr_in cliAddr;
+} UdpClientData;
 
 typedef struct {
     int sockfd;
@@ -62,6 +90,8 @@ typedef struct {
 
 // 서버 종료 시 소켓을 닫고 소켓 파일을 삭제한 후 종료
 void CloseServer() {
+    int i;
+
     close(TcpSockfd);
     close(UdpSockfd);
     close(UcoSockfd);
@@ -74,23 +104,53 @@ void CloseServer() {
     }
 
     printf("\nServer daemon exit.....\n");
+    for (i = 0 ; i < NWorker ; i++)
+        printf("worker%d: served %ld, stolen %ld\n", i, Workers[i].served, Workers[i].stolen);
     exit(0);
 }
 
-// 스레드에서 실행될 TCP 요청 처리 함수
-void* HandleTcpClient(void* arg) {
-    TcpClientData* data = (TcpClientData*)arg;
-    int newSockfd = data->sockfd;
+// 큐에 요청을 넣는다. 가득 차 있으면 -1 (dispatcher만 호출)
+int WsPush(WsQueue *q, int job) {
+    long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&q->top, memory_order_acquire);
+
+    if (b - t >= WS_SIZE)
+        return -1;
+    atomic_store_explicit(&q->job[b & (WS_SIZE - 1)], job, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_release);
+    return 0;
+}
+
+// 큐의 top에서 요청 하나를 꺼낸다. 비어 있으면 -1 (주인과 훔치는 작업자 모두 사용)
+int WsTake(WsQueue *q) {
+    long t, b;
+    int job;
+
+    t = atomic_load_explicit(&q->top, memory_order_acquire);
+    do {
+        b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+        if (t >= b)
+            return -1;
+        // top이 t인 동안은 dispatcher가 이 칸을 덮어쓰지 않는다
+        job = atomic_load_explicit(&q->job[t & (WS_SIZE - 1)], memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak(&q->top, &t, t + 1));
+    return job;
+}
+
+// 요청 하나를 처리한다: 요청을 읽고 응답을 보낸 뒤 소켓을 닫는다
+void ServeClient(int job) {
+    int newSockfd = JOB_FD(job);
+    const char *what = JOB_KIND(job) == JOB_TCP ? "TCP" : "UNIX-domain CO";
     MsgType msg;
 
     // 클라이언트로부터 메시지 읽기
     if (read(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
         perror("read");
         close(newSockfd);
-        free(data);
-        pthread_exit(NULL);
+        return;
     }
-    printf("Received TCP request: %s.....\n", msg.data);
+    msg.data[sizeof(msg.data) - 1] = '\0';
+    printf("Received %s request: %s.....\n", what, msg.data);
 
     // 응답 메시지 작성
     msg.type = MSG_REPLY;
@@ -100,14 +160,54 @@ void* HandleTcpClient(void* arg) {
     if (write(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
         perror("write");
         close(newSockfd);
-        free(data);
-        pthread_exit(NULL);
+        return;
     }
-    printf("Replied to TCP client.\n");
+    printf("Replied to %s client.\n", what);
 
     close(newSockfd);
-    free(data);
-    pthread_exit(NULL);
+}
+
+// 작업자 스레드: 요청이 생길 때까지 잠들었다가, 자기 큐에서 먼저 꺼내고
+// 비어 있으면 다른 작업자의 큐를 돌며 훔쳐 온다
+void* WorkerThread(void* arg) {
+    Worker* self = (Worker*)arg;
+    int i, job;
+
+    while (1)  {
+        while (sem_wait(&Work) < 0)
+            ;   // EINTR
+        // 세마포어를 얻었으므로 어느 큐엔가 내 몫이 있다
+        while ((job = WsTake(&self->q)) < 0)  {
+            for (i = 1 ; i < NWorker ; i++)  {
+                if ((job = WsTake(&Workers[(self->id + i) % NWorker].q)) >= 0)  {
+                    self->stolen++;
+                    break;
+                }
+            }
+            if (job >= 0)
+                break;
+        }
+        ServeClient(job);
+        self->served++;
+    }
+    return NULL;
+}
+
+// accept한 소켓을 작업자 큐에 돌아가며 넣고 작업자 하나를 깨운다
+void Dispatch(int newSockfd, int kind) {
+    static int next;
+    int i;
+
+    for (i = 0 ; i < NWorker ; i++)  {
+        next = (next + 1) % NWorker;
+        if (WsPush(&Workers[next].q, JOB(newSockfd, kind)) == 0)  {
+            sem_post(&Work);
+            return;
+        }
+    }
+    // 모든 큐가 가득 참: 이 요청은 받지 않는다
+    fprintf(stderr, "All worker queues are full, dropping a connection\n");
+    close(newSockfd);
 }
 
 // 스레드에서 실행될 UDP 요청 처리 함수
@@ -144,39 +244,6 @@ void* HandleUdpClient(void* arg) {
     pthread_exit(NULL);
 }
 
-// 스레드에서 실행될 UNIX 도메인 연결 지향형 소켓 요청 처리 함수
-void* HandleUnixStreamClient(void* arg) {
-    UnixStreamClientData* data = (UnixStreamClientData*)arg;
-    int newSockfd = data->sockfd;
-    MsgType msg;
-
-    // 클라이언트로부터 메시지 읽기
-    if (read(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
-        perror("read");
-        close(newSockfd);
-        free(data);
-        pthread_exit(NULL);
-    }
-    printf("Received UNIX-domain CO request: %s.....\n", msg.data);
-
-    // 응답 메시지 작성
-    msg.type = MSG_REPLY;
-    sprintf(msg.data, "This is a reply from %d.", getpid());
-
-    // 클라이언트에게 응답 메시지 전송
-    if (write(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
-        perror("write");
-        close(newSockfd);
-        free(data);
-        pthread_exit(NULL);
-    }
-    printf("Replied to UNIX-domain CO client.\n");
-
-    close(newSockfd);
-    free(data);
-    pthread_exit(NULL);
-}
-
 // 스레드에서 실행될 UNIX 도메인 비연결형 소켓 요청 처리 함수
 void* HandleUnixDatagramClient(void* arg) {
     UnixDatagramClientData* data = (UnixDatagramClientData*)arg;
@@ -215,9 +282,17 @@ int main(int argc, char *argv[]) {
     fd_set fdvar;
     int     maxfd;
     int     count;
+    int     i;
+
+    NWorker = (argc > 1) ? atoi(argv[1]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (NWorker < 1 || NWorker > MAX_WORKER)  {
+        fprintf(stderr, "Usage: %s [nworker (1..%d)]\n", argv[0], MAX_WORKER);
+        exit(1);
+    }
 
     // SIGINT 시그널 처리 등록 (Ctrl+C 시 CloseServer 호출)
     signal(SIGINT, CloseServer);
+    signal(SIGPIPE, SIG_IGN);
 
     // 소켓 생성 및 설정 함수 호출
     // (함수는 원래 select.c에서 사용된 것과 동일)
@@ -242,7 +317,7 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    listen(TcpSockfd, 5);
+    listen(TcpSockfd, SOMAXCONN);
 
     // UDP 소켓 생성
     if ((UdpSockfd = socket(PF_INET, SOCK_DGRAM, 0)) < 0)  {
@@ -280,7 +355,7 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    listen(UcoSockfd, 5);
+    listen(UcoSockfd, SOMAXCONN);
 
     // UNIX 도메인 비연결형 소켓 생성
     if ((UclSockfd = socket(PF_UNIX, SOCK_DGRAM, 0)) < 0)  {
@@ -300,7 +375,24 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    printf("Server daemon started.....\n");
+    // 작업자 스레드 풀: 요청을 처리하는 동안 스레드를 만들지 않는다
+    if (sem_init(&Work, 0, 0) < 0)  {
+        perror("sem_init");
+        exit(1);
+    }
+    if ((Workers = calloc(NWorker, sizeof(Worker))) == NULL)  {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0 ; i < NWorker ; i++)  {
+        Workers[i].id = i;
+        if (pthread_create(&Workers[i].tid, NULL, WorkerThread, &Workers[i]) != 0)  {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    printf("Server daemon started (%d workers).....\n", NWorker);
 
     while (1)  {
         FD_ZERO(&fdvar);
@@ -332,27 +424,8 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
-            // 클라이언트 데이터를 저장할 구조체 할당
-            TcpClientData* clientData = malloc(sizeof(TcpClientData));
-            if (clientData == NULL) {
-                perror("malloc");
-                close(newSockfd);
-                continue;
-            }
-            clientData->sockfd = newSockfd;
-            memcpy(&clientData->cliAddr, &cliAddr_tcp, sizeof(cliAddr_tcp));
-
-            // 새로운 스레드 생성하여 클라이언트 요청 처리
-            pthread_t tid;
-            if (pthread_create(&tid, NULL, HandleTcpClient, (void*)clientData) != 0) {
-                perror("pthread_create");
-                close(newSockfd);
-                free(clientData);
-                continue;
-            }
-
-            // 스레드를 분리하여 자원 자동 해제
-            pthread_detach(tid);
+            // 작업자 큐에 넣음 (작업자가 읽고 응답함)
+            Dispatch(newSockfd, JOB_TCP);
         }
 
         if (FD_ISSET(UdpSockfd, &fdvar))  {
@@ -392,27 +465,8 @@ int main(int argc, char *argv[]) {
                 continue;
             }
 
-            // 클라이언트 데이터를 저장할 구조체 할당
-            UnixStreamClientData* clientData = malloc(sizeof(UnixStreamClientData));
-            if (clientData == NULL) {
-                perror("malloc");
-                close(newSockfd);
-                continue;
-            }
-            clientData->sockfd = newSockfd;
-            memcpy(&clientData->cliAddr, &cliAddr_unco, sizeof(cliAddr_unco));
-
-            // 새로운 스레드 생성하여 클라이언트 요청 처리
-            pthread_t tid;
-            if (pthread_create(&tid, NULL, HandleUnixStreamClient, (void*)clientData) != 0) {
-                perror("pthread_create");
-                close(newSockfd);
-                free(clientData);
-                continue;
-            }
-
-            // 스레드를 분리하여 자원 자동 해제
-            pthread_detach(tid);
+            // 작업자 큐에 넣음 (작업자가 읽고 응답함)
+            Dispatch(newSockfd, JOB_UCO);
         }
 
         if (FD_ISSET(UclSockfd, &fdvar))  {
@@ -4,17 +4,34 @@
     - TCP 서버를 구현하여 클라이언트와 연결을 수락한 후,
       새로운 프로세스를 생성하여 클라이언트 요청을 전담 처리한다.
     - 부모 프로세스는 계속해서 새로운 클라이언트의 연결을 수락할 수 있다.
+    - -w n을 주면 연결마다 fork()하지 않고, 시작할 때 worker n개를 미리
+      fork()해 두는 prefork 모드로 동작한다 (Apache prefork 방식).
 [Input]        : 
+    - -w n : prefork 모드, 시작할 때 만들 worker 수
+    - -m n : 놀고 있는 worker가 이보다 적으면 worker를 늘림 (기본 2)
+    - -M n : 놀고 있는 worker가 이보다 많으면 worker를 줄임 (기본 8)
+    - -x n : worker 수 상한 (기본 64)
+    - -k n : worker 하나가 처리할 최대 요청 수, 넘으면 새 worker로 교체 (기본 1000, 0이면 무제한)
+    - -q   : 요청마다 콘솔에 출력하지 않음
     - 클라이언트의 요청 메시지
     - 서버는 클라이언트의 주소 정보를 사용하여 응답을 전송
 [Output]       : 
     - 클라이언트로 응답 메시지 전송
     - "TCP Server started.....", "Received request: ...", "Replied." 등의 상태 메시지를 콘솔에 출력
 [Calls]        : 
-    - socket(), bind(), listen(), accept(), fork(), read(), write(), close(), perror(), exit(), strcpy(), sprintf()
+    - socket(), bind(), listen(), accept(), fork(), read(), write(), close(), perror(), exit(), strcpy(), sprintf(),
+      setsockopt(), mmap(), waitpid(), kill(), sigaction()
 [특기사항]     : 
     - `tcp.h` 파일에 MsgType, SERV_TCP_PORT 등의 정의가 필요
     - SIGCHLD 시그널을 처리하여 종료된 자식 프로세스의 상태를 정리
+    - prefork 모드에서는 worker들이 같은 listen 소켓에서 각자 accept()를
+      부르고, 연결 하나를 처리한 뒤 다시 accept()로 돌아간다. 연결마다
+      드는 fork() 비용이 응답 경로에서 빠진다.
+    - worker는 공유 메모리(Board)의 자기 칸에 처리 중 여부와 처리한 요청
+      수를 적고, 부모는 MAINT_MS마다 이를 보고 worker 수를 조절한다
+      (놀고 있는 worker를 MinSpare..MaxSpare로 유지). 줄일 때는 놀고 있는
+      worker 하나에 SIGTERM을 보내며, worker는 처리 중인 요청을 끝내고 나간다.
+    - 요청을 MaxRequests개 처리한 worker는 스스로 종료하고 부모가 새로 만든다.
     - 오류 발생 시 perror를 통해 에러 메시지를 출력하고 프로그램을 종료
 ===============================================================*/
 #include <stdio.h>
@@ -22,13 +39,37 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <stdatomic.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include "tcp.h"
 
+#define MAX_WORKERS     1024    // -x 상한
+#define MAINT_MS        100     // 부모가 worker 수를 점검하는 주기 (ms)
+
+// worker 하나의 상태 (부모와 worker가 공유하는 메모리에 있음)
+typedef struct {
+    pid_t       pid;        // 0이면 빈 칸 (부모만 씀)
+    atomic_int  busy;       // 1이면 요청 처리 중 (worker만 씀)
+    atomic_long served;     // 처리한 요청 수 (worker만 씀)
+} WorkerSlot;
+
 // 글로벌 변수 (필요에 따라 조정 가능)
 int Sockfd;
+int Quiet;                  // 1이면 요청마다 출력하지 않음 (-q)
+WorkerSlot *Board;          // worker 상태판 (MaxWorkers칸, MAP_SHARED)
+int MinSpare = 2;           // -m
+int MaxSpare = 8;           // -M
+int MaxWorkers = 64;        // -x
+long MaxRequests = 1000;    // -k
+long Served;                // 종료한 worker들이 처리한 요청 수 (부모)
+int Spawned, Retired;       // 만든 worker 수, 요청 수를 채워 교체된 worker 수 (부모)
+volatile sig_atomic_t Quit; // worker: SIGTERM을 받으면 1
 
 // 자식 프로세스 종료 시 부모 프로세스가 자식의 종료 상태를 수집할 수 있도록 SIGCHLD 시그널 핸들러 등록
 void sigchld_handler(int signo) {
@@ -36,29 +77,280 @@ void sigchld_handler(int signo) {
     while (waitpid(-1, NULL, WNOHANG) > 0);
 }
 
+// prefork 모드: 부모의 점검 대기(nanosleep)만 깨우고, 수집은 Maintain()에서 함
+void ChildExited(int signo) {
+}
+
+// worker: 처리 중인 요청을 끝내고 종료하도록 표시
+void StopWorker(int signo) {
+    Quit = 1;
+}
+
 // 서버 종료 시 소켓을 닫고 종료 메시지를 출력
 void CloseServer() {
+    int     i, n = 0;
+    long    served = Served;
+
     close(Sockfd);
     printf("\nTCP Server exit.....\n");
+    if (Board)  {
+        // 남은 worker를 종료시키고 처리한 요청 수를 합산
+        for (i = 0 ; i < MaxWorkers ; i++)  {
+            if (Board[i].pid > 0)  {
+                kill(Board[i].pid, SIGTERM);
+                served += atomic_load(&Board[i].served);
+                n++;
+            }
+        }
+        printf("%ld requests, %d workers spawned, %d recycled, %d running\n",
+               served, Spawned, Retired, n);
+    }
     exit(0);
 }
 
+/*===============================================================
+[Function Name] : ServeClient
+[Description]   : 
+    - 연결된 클라이언트의 요청 하나를 읽고 응답한 뒤 연결을 닫는다.
+[Input]         : 
+    - int newSockfd : 클라이언트와 연결된 소켓
+[Output]        : 
+    - 클라이언트로 응답 메시지 전송
+[Call By]       : 
+    - main() (fork된 자식), WorkerMain()
+[Calls]         : 
+    - read(), write(), sprintf(), close()
+[Given]         : 
+    - 글로벌 변수 Quiet
+[Returns]       : 
+    - int : 성공 0, 실패 -1
+================================================================*/
+int ServeClient(int newSockfd) {
+    MsgType     msg;
+
+    // 클라이언트로부터 메시지 읽기
+    if (read(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
+        perror("read");
+        close(newSockfd);
+        return -1;
+    }
+    if (!Quiet)
+        printf("Received request: %s.....\n", msg.data);
+
+    // 응답 메시지 작성
+    msg.type = MSG_REPLY;
+    sprintf(msg.data, "This is a reply from %d.", getpid());
+
+    // 클라이언트에게 응답 메시지 전송
+    if (write(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
+        perror("write");
+        close(newSockfd);
+        return -1;
+    }
+    if (!Quiet)
+        printf("Replied.\n");
+
+    close(newSockfd); // 클라이언트 소켓 닫기
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : WorkerMain
+[Description]   : 
+    - prefork worker. 공유 listen 소켓에서 accept()한 연결을 하나씩 처리하고,
+      MaxRequests개를 처리했거나 SIGTERM을 받으면 종료한다.
+    - SIGTERM은 accept()에서 기다리는 동안만 받는다. 요청을 처리하는 동안은
+      막아 두므로 read()/write()가 EINTR로 끊기지 않고, 끝난 뒤에 종료한다.
+[Input]         : 
+    - WorkerSlot *slot : 이 worker의 상태판 칸
+[Output]        : 
+    - 클라이언트로 응답 메시지 전송
+[Call By]       : 
+    - Spawn()
+[Calls]         : 
+    - sigaction(), signal(), sigprocmask(), accept(), ServeClient(), exit()
+[Given]         : 
+    - Sockfd는 listen 중인 소켓
+[Returns]       : 
+    - 없음 (프로세스 종료)
+================================================================*/
+void WorkerMain(WorkerSlot *slot) {
+    struct sigaction    sa;
+    struct sockaddr_in  cliAddr;
+    socklen_t           cliAddrLen;
+    sigset_t            term;
+    int                 newSockfd;
+
+    // SIGTERM은 accept()를 깨워야 하므로 SA_RESTART 없이 등록
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = StopWorker;
+    sigaction(SIGTERM, &sa, NULL);
+    sigemptyset(&term);
+    sigaddset(&term, SIGTERM);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    while (!Quit)  {
+        cliAddrLen = sizeof(cliAddr);
+        newSockfd = accept(Sockfd, (struct sockaddr *) &cliAddr, &cliAddrLen);
+        if (newSockfd < 0)  {
+            if (errno != EINTR)
+                perror("accept");
+            continue;
+        }
+
+        // 처리 중에 온 SIGTERM은 응답을 보낸 뒤에 받음 (Quit)
+        sigprocmask(SIG_BLOCK, &term, NULL);
+        atomic_store(&slot->busy, 1);
+        ServeClient(newSockfd);
+        atomic_store(&slot->busy, 0);
+        sigprocmask(SIG_UNBLOCK, &term, NULL);
+
+        // 요청 수를 채우면 종료 (부모가 새 worker로 교체)
+        if (atomic_fetch_add(&slot->served, 1) + 1 == MaxRequests)
+            exit(2);
+    }
+    exit(0);
+}
+
+/*===============================================================
+[Function Name] : Spawn
+[Description]   : 
+    - 상태판의 빈 칸에 worker 하나를 fork()한다.
+[Input]         : 
+    - 없음
+[Output]        : 
+    - 없음
+[Call By]       : 
+    - Maintain(), main()
+[Calls]         : 
+    - fork(), WorkerMain(), perror()
+[Given]         : 
+    - Board는 MaxWorkers칸
+[Returns]       : 
+    - int : 성공 0, 빈 칸이 없거나 fork() 실패 -1
+================================================================*/
+int Spawn() {
+    int     i;
+    pid_t   pid;
+
+    for (i = 0 ; i < MaxWorkers && Board[i].pid != 0 ; i++)
+        ;
+    if (i == MaxWorkers)
+        return -1;
+
+    atomic_store(&Board[i].busy, 0);
+    atomic_store(&Board[i].served, 0);
+    if ((pid = fork()) < 0)  {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0)
+        WorkerMain(&Board[i]);
+    Board[i].pid = pid;
+    Spawned++;
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : Maintain
+[Description]   : 
+    - 종료한 worker를 수집하고, 놀고 있는 worker 수가 MinSpare..MaxSpare에
+      들도록 worker를 만들거나(MaxWorkers까지) 하나를 줄인다.
+[Input]         : 
+    - 없음
+[Output]        : 
+    - 없음
+[Call By]       : 
+    - main()
+[Calls]         : 
+    - waitpid(), Spawn(), kill()
+[Given]         : 
+    - 부모 프로세스에서만 부름
+[Returns]       : 
+    - 없음
+================================================================*/
+void Maintain() {
+    int     i, status, total = 0, idle = 0, victim = -1;
+    pid_t   pid;
+
+    // 종료한 worker의 칸을 비움
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0)  {
+        for (i = 0 ; i < MaxWorkers ; i++)  {
+            if (Board[i].pid == pid)  {
+                Served += atomic_load(&Board[i].served);
+                if (WIFEXITED(status) && WEXITSTATUS(status) == 2)
+                    Retired++;
+                Board[i].pid = 0;
+                break;
+            }
+        }
+    }
+
+    for (i = 0 ; i < MaxWorkers ; i++)  {
+        if (Board[i].pid == 0)
+            continue;
+        total++;
+        if (!atomic_load(&Board[i].busy))  {
+            idle++;
+            victim = i;
+        }
+    }
+
+    // 놀고 있는 worker가 모자라면 늘리고, 남으면 한 주기에 하나씩 줄임
+    while (idle < MinSpare && total < MaxWorkers && Spawn() == 0)  {
+        idle++;
+        total++;
+    }
+    if (idle > MaxSpare && victim >= 0)
+        kill(Board[victim].pid, SIGTERM);
+}
+
 int main(int argc, char *argv[]) {
-    int                 newSockfd, cliAddrLen, n;
+    int                 newSockfd, cliAddrLen, opt, i, one = 1;
+    int                 workers = 0;    // -w (0이면 연결마다 fork)
     struct sockaddr_in  cliAddr, servAddr;
-    MsgType             msg;
+    struct timespec     tick = { 0, MAINT_MS * 1000000L };
     pid_t               pid;
 
+    while ((opt = getopt(argc, argv, "w:m:M:x:k:q")) != -1)  {
+        if (opt == 'w')
+            workers = atoi(optarg);
+        else if (opt == 'm')
+            MinSpare = atoi(optarg);
+        else if (opt == 'M')
+            MaxSpare = atoi(optarg);
+        else if (opt == 'x')
+            MaxWorkers = atoi(optarg);
+        else if (opt == 'k')
+            MaxRequests = atol(optarg);
+        else if (opt == 'q')
+            Quiet = 1;
+        else  {
+            fprintf(stderr, "Usage: %s [-w workers [-m minSpare] [-M maxSpare] [-x maxWorkers] [-k requestsPerWorker]] [-q]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (MaxWorkers < 1 || MaxWorkers > MAX_WORKERS || workers > MaxWorkers || MinSpare > MaxSpare)  {
+        fprintf(stderr, "need minSpare <= maxSpare, workers <= maxWorkers <= %d\n", MAX_WORKERS);
+        exit(1);
+    }
+
     // SIGINT 시그널 핸들러 등록 (Ctrl+C 시 CloseServer 호출)
     signal(SIGINT, CloseServer);
     // SIGCHLD 시그널 핸들러 등록 (자식 프로세스 종료 시 처리)
-    signal(SIGCHLD, sigchld_handler);
+    signal(SIGCHLD, workers > 0 ? ChildExited : sigchld_handler);
 
     // TCP 소켓 생성
     if ((Sockfd = socket(PF_INET, SOCK_STREAM, 0)) < 0)  {
         perror("socket");
         exit(1);
     }
+    // 서버가 먼저 연결을 닫으므로 TIME_WAIT가 남아 있어도 재시작할 수 있게 함
+    if (setsockopt(Sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)  {
+        perror("setsockopt");
+        exit(1);
+    }
 
     // 서버 주소 구조체 초기화 및 설정
     bzero((char *)&servAddr, sizeof(servAddr));
@@ -73,11 +365,32 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    // 연결 요청 대기 상태로 설정
-    listen(Sockfd, 5);
+    // 연결 요청 대기 상태로 설정 (prefork worker들이 함께 accept())
+    listen(Sockfd, SOMAXCONN);
 
     printf("TCP Server started.....\n");
 
+    if (workers > 0)  {
+        // worker 상태판은 fork() 뒤에도 부모와 worker가 함께 보도록 MAP_SHARED
+        Board = mmap(NULL, MaxWorkers * sizeof(WorkerSlot), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (Board == MAP_FAILED)  {
+            perror("mmap");
+            exit(1);
+        }
+        fflush(stdout);     // worker에 출력 버퍼가 복사되지 않도록
+        for (i = 0 ; i < workers ; i++)
+            Spawn();
+        printf("%d workers preforked.....\n", workers);
+        fflush(stdout);
+
+        // 부모는 연결을 받지 않고 worker 수만 조절
+        while (1)  {
+            nanosleep(&tick, NULL);     // SIGCHLD가 오면 일찍 깸
+            Maintain();
+        }
+    }
+
     cliAddrLen = sizeof(cliAddr);
     while (1)  {
         // 클라이언트 연결 수락
@@ -98,28 +411,8 @@ int main(int argc, char *argv[]) {
         if (pid == 0) { // 자식 프로세스
             close(Sockfd); // 자식 프로세스는 원본 소켓을 닫음
 
-            // 클라이언트로부터 메시지 읽기
-            if ((n = read(newSockfd, (char *)&msg, sizeof(msg))) < 0)  {
-                perror("read");
-                close(newSockfd);
-                exit(1);
-            }
-            printf("Received request: %s.....\n", msg.data);
-
-            // 응답 메시지 작성
-            msg.type = MSG_REPLY;
-            sprintf(msg.data, "This is a reply from %d.", getpid());
-
-            // 클라이언트에게 응답 메시지 전송
-            if (write(newSockfd, (char *)&msg, sizeof(msg)) < 0)  {
-                perror("write");
-                close(newSockfd);
-                exit(1);
-            }
-            printf("Replied.\n");
-
-            close(newSockfd); // 클라이언트 소켓 닫기
-            exit(0); // 자식 프로세스 종료
+            // 요청 처리 후 자식 프로세스 종료
+            exit(ServeClient(newSockfd) < 0 ? 1 : 0);
         }
         else { // 부모 프로세스
             close(newSockfd); // 부모는 클라이언트 소켓을 닫고, 루프를 통해 다음 클라이언트 수락
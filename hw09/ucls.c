@@ -2,14 +2,17 @@
 [Program Name] : ucls.c
 [Description]  : 
     - UNIX 도메인 소켓을 이용한 비연결형(Connection-Less) 서버를 구현하여 클라이언트의 요청을 받고 응답을 전송한다.
+    - 요청은 recvmmsg()로 여러 개씩 받고 응답은 sendmmsg()로 한꺼번에 보낸다. (dgram.h)
 [Input]        : 
+    - -b n : 일괄 처리 크기 (기본 DG_BATCH, 0이면 요청마다 recvfrom()/sendto())
+    - -q   : 요청마다 콘솔에 출력하지 않음 (성능 측정용, dgbench 참조)
     - 클라이언트의 요청 메시지
     - 서버는 클라이언트의 주소 정보를 사용하여 응답을 전송
 [Output]       : 
     - 클라이언트로 응답 메시지 전송
     - "UNIX-domain Connection-Less Server started....." 등의 상태 메시지를 콘솔에 출력
 [Calls]        : 
-    - socket(), bind(), recvfrom(), sendto(), close(), signal(), remove()
+    - socket(), bind(), recvfrom(), sendto(), dgInit(), dgServe(), close(), signal(), remove()
 [특기사항]     : 
     - 서버 종료를 위해 SIGINT 시그널(Ctrl+C) 처리
     - "unix.h" 파일에 MsgType과 UNIX_DG_PATH 등의 정의가 필요
@@ -24,9 +27,16 @@
 #include <arpa/inet.h>
 #include <sys/un.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "unix.h"
+#include "dgram.h"
 
-int	Sockfd; // 서버 소켓 파일 디스크립터
+int		Sockfd; // 서버 소켓 파일 디스크립터
+int		Quiet;  // 1이면 요청마다 출력하지 않음 (-q)
+DgBatch	Batch;  // 일괄 처리 상태 (-b 0이면 쓰지 않음)
+int		Pid;    // 응답에 넣는 프로세스 id (요청마다 getpid()를 부르지 않도록)
 
 /*===============================================================
 [Function Name] : CloseServer
@@ -53,14 +63,67 @@ void CloseServer()
 	}
 
 	printf("\nUNIX-domain Connection-Less Server exit.....\n");
+	if (Batch.nBatch > 0)
+		printf("%ld requests in %ld batches (%.1f per recvmmsg), %ld replies dropped\n",
+			   Batch.nRecv, Batch.nBatch, (double)Batch.nRecv / Batch.nBatch, Batch.nDrop);
 	exit(0); // 프로그램 종료
 }
 
+/*===============================================================
+[Function Name] : MakeReply
+[Description]   : 
+    - 요청 메시지를 읽고 같은 버퍼에 응답 메시지를 만든다. (dgServe()의 응답 함수)
+[Input]         : 
+    - char *buf : 요청 데이터그램 (DG_MSG_MAX 바이트 버퍼)
+    - int len   : 요청 길이
+    - void *arg : 사용하지 않음
+[Output]        : 
+    - 콘솔에 "Received request: <메시지>.....Replied." 출력 (-q가 아니면)
+[Call By]       : 
+    - dgServe()
+[Calls]         : 
+    - printf(), sprintf()
+[Given]         : 
+    - 글로벌 변수 Quiet, Pid
+[Returns]       : 
+    - int : 응답 길이
+===============================================================*/
+int MakeReply(char *buf, int len, void *arg)
+{
+	MsgType	*msg = (MsgType *)buf;
+
+	if (len < sizeof(MsgType))	// 짧은 요청은 나머지를 비움
+		memset(buf + len, 0, sizeof(MsgType) - len);
+	msg->data[sizeof(msg->data) - 1] = '\0';
+	if (!Quiet)
+		printf("Received request: %s.....Replied.\n", msg->data);
+
+	// 응답 메시지 작성
+	msg->type = MSG_REPLY;
+	sprintf(msg->data, "This is a reply from %d.", Pid);
+	return sizeof(MsgType);
+}
+
 int main(int argc, char *argv[])
 {
 	int					servAddrLen, cliAddrLen, n; // 서버 주소 길이, 클라이언트 주소 길이, 읽은 바이트 수
 	struct sockaddr_un	cliAddr, servAddr; // 클라이언트 및 서버 주소 구조체
 	MsgType				msg; // 메시지 구조체 (unix.h에서 정의됨)
+	int					opt, batch = DG_BATCH; // 일괄 처리 크기 (-b)
+
+	while ((opt = getopt(argc, argv, "b:q")) != -1)  {
+		if (opt == 'b')
+			batch = atoi(optarg);
+		else if (opt == 'q')
+			Quiet = 1;
+		else  {
+			fprintf(stderr, "Usage: %s [-b batch (0: recvfrom/sendto)] [-q]\n", argv[0]);
+			exit(1);
+		}
+	}
+	Pid = getpid();
+	if (batch > 0 && dgInit(&Batch, batch) < 0)
+		exit(1);
 
 	signal(SIGINT, CloseServer); // SIGINT 시그널 처리 등록 (Ctrl+C 시 CloseServer 호출)
 
@@ -82,21 +145,32 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
-	printf("UNIX-domain Connection-Less Server started.....\n");
+	printf("UNIX-domain Connection-Less Server started (batch %d).....\n", batch);
+	fflush(stdout);
+
+	// 요청을 recvmmsg()로 받아 sendmmsg()로 응답
+	while (batch > 0)  {
+		if (dgServe(Sockfd, &Batch, MSG_WAITFORONE, MakeReply, NULL) < 0)  {
+			perror("recvmmsg");
+			exit(1);
+		}
+	}
 
-	cliAddrLen = sizeof(cliAddr);
+	// -b 0: 요청마다 recvfrom()/sendto() (비교용)
 	while (1)  {
+		cliAddrLen = sizeof(cliAddr);
 		// 클라이언트로부터 메시지 수신
 		if ((n = recvfrom(Sockfd, (char *)&msg, sizeof(msg), 
 					0, (struct sockaddr *)&cliAddr, &cliAddrLen)) < 0)  {
 			perror("recvfrom");
 			exit(1);
 		}
-		printf("Received request: %s.....", msg.data);
+		if (!Quiet)
+			printf("Received request: %s.....", msg.data);
 
 		// 응답 메시지 작성
 		msg.type = MSG_REPLY;
-		sprintf(msg.data, "This is a reply from %d.", getpid());
+		sprintf(msg.data, "This is a reply from %d.", Pid);
 
 		// 클라이언트에게 응답 메시지 전송
 		if (sendto(Sockfd, (char *)&msg, sizeof(msg),
@@ -104,7 +178,8 @@ int main(int argc, char *argv[])
 			perror("sendto");
 			exit(1);
 		}
-		printf("Replied.\n");
+		if (!Quiet)
+			printf("Replied.\n");
 	}
 }
 
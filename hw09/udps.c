@@ -2,29 +2,61 @@
 [Program Name] : udps.c
 [Description]  : 
     - UDP 서버를 구현하여 클라이언트로부터 요청 메시지를 받고, 이에 대한 응답을 전송한다.
+    - 요청은 recvmmsg()로 여러 개씩 받고 응답은 sendmmsg()로 한꺼번에 보낸다. (dgram.h)
 [Input]        : 
+    - -b n : 일괄 처리 크기 (기본 DG_BATCH, 0이면 요청마다 recvfrom()/sendto())
+    - -q   : 요청마다 콘솔에 출력하지 않음 (성능 측정용, dgbench 참조)
+    - -t n : 스레드 n개가 SO_REUSEPORT로 각자 소켓을 bind (0이면 CPU 코어 수,
+             없으면 소켓 하나와 루프 하나)
     - 클라이언트의 요청 메시지
     - 서버는 클라이언트의 주소와 포트를 파악하여 응답을 전송
 [Output]       : 
     - 클라이언트로 응답 메시지 전송
     - "Received request: <메시지>....." 및 "Replied."를 콘솔에 출력
 [Calls]        : 
-    - socket(), bind(), recvfrom(), sendto(), close(), signal()
+    - socket(), setsockopt(), bind(), recvfrom(), sendto(), dgInit(), dgServe(), close(), signal(),
+      pthread_create(), pthread_setaffinity_np()
 [특기사항]     : 
     - 서버 종료를 위해 SIGINT 시그널(Ctrl+C) 처리
     - "udp.h" 파일에 MsgType과 SERV_UDP_PORT 등의 정의가 필요
     - 서버는 INADDR_ANY를 사용하여 모든 인터페이스에서 연결을 수락
     - UDP는 비연결형 프로토콜이므로 클라이언트의 주소 정보를 사용하여 응답
+    - -t 모드에서는 스레드마다 같은 포트에 SO_REUSEPORT로 bind한 소켓이 있고,
+      커널이 보낸 쪽 주소/포트의 해시로 요청 흐름을 소켓에 나누어 준다.
+      스레드 i는 CPU (i % 코어 수)에 고정되며 소켓, 일괄 처리 버퍼, 통계를
+      따로 가지므로 스레드끼리 공유하는 상태나 lock이 없다.
 ================================================================*/
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "udp.h"
+#include "dgram.h"
 
-int Sockfd; // 서버 소켓 파일 디스크립터
+int Sockfd;     // 서버 소켓 파일 디스크립터
+int Quiet;      // 1이면 요청마다 출력하지 않음 (-q)
+DgBatch Batch;  // 일괄 처리 상태 (-b 0이면 쓰지 않음)
+int Pid;        // 응답에 넣는 프로세스 id (요청마다 getpid()를 부르지 않도록)
+int BatchSize = DG_BATCH;   // 일괄 처리 크기 (-b, 0이면 recvfrom()/sendto())
+
+// -t 모드의 스레드별 상태
+typedef struct {
+    pthread_t   tid;
+    int         idx;
+    int         sockfd;     // SO_REUSEPORT로 bind한 이 스레드의 소켓
+    DgBatch     batch;
+} UdpWorker;
+
+UdpWorker *Workers;
+int NWorker;    // 0이면 -t 모드가 아님
 
 /*===============================================================
 [Function Name] : CloseServer
@@ -39,31 +71,96 @@ int Sockfd; // 서버 소켓 파일 디스크립터
 [Calls]         : 
     - close(), printf(), exit()
 [Given]         : 
-    - 글로벌 변수 Sockfd가 유효한 소켓 디스크립터를 가리키고 있다고 가정
+    - 글로벌 변수 Sockfd (-t 모드이면 Workers)가 유효한 소켓 디스크립터를 가리키고 있다고 가정
 [Returns]       : 
     - 없음 (프로그램 종료)
 ================================================================*/
 void CloseServer()
 {
+    int i;
+
     close(Sockfd); // 서버 소켓 닫기
     printf("\nUDP Server exit.....\n");
+    if (Batch.nBatch > 0)
+        printf("%ld requests in %ld batches (%.1f per recvmmsg), %ld replies dropped\n",
+               Batch.nRecv, Batch.nBatch, (double)Batch.nRecv / Batch.nBatch, Batch.nDrop);
+    // 스레드별 요청 수 (SO_REUSEPORT가 흐름을 얼마나 고르게 나눴는지)
+    for (i = 0 ; i < NWorker ; i++)  {
+        close(Workers[i].sockfd);
+        if (Workers[i].batch.nBatch > 0)
+            printf("thread %d: %ld requests in %ld batches, %ld replies dropped\n", i,
+                   Workers[i].batch.nRecv, Workers[i].batch.nBatch, Workers[i].batch.nDrop);
+    }
     exit(0); // 프로그램 종료
 }
 
-int main(int argc, char *argv[])
+/*===============================================================
+[Function Name] : MakeReply
+[Description]   : 
+    - 요청 메시지를 읽고 같은 버퍼에 응답 메시지를 만든다. (dgServe()의 응답 함수)
+[Input]         : 
+    - char *buf : 요청 데이터그램 (DG_MSG_MAX 바이트 버퍼)
+    - int len   : 요청 길이
+    - void *arg : 사용하지 않음
+[Output]        : 
+    - 콘솔에 "Received request: <메시지>.....Replied." 출력 (-q가 아니면)
+[Call By]       : 
+    - dgServe()
+[Calls]         : 
+    - printf(), sprintf()
+[Given]         : 
+    - 글로벌 변수 Quiet, Pid
+[Returns]       : 
+    - int : 응답 길이
+================================================================*/
+int MakeReply(char *buf, int len, void *arg)
 {
-    int                 cliAddrLen, n; // 클라이언트 주소 길이, 읽은 바이트 수
-    struct sockaddr_in  cliAddr, servAddr; // 클라이언트 및 서버 주소 구조체
-    MsgType             msg; // 메시지 구조체 (udp.h에서 정의됨)
+    MsgType *msg = (MsgType *)buf;
 
-    // SIGINT 시그널 처리 등록 (Ctrl+C 시 CloseServer 호출)
-    signal(SIGINT, CloseServer);
+    if (len < sizeof(MsgType))  // 짧은 요청은 나머지를 비움
+        memset(buf + len, 0, sizeof(MsgType) - len);
+    msg->data[sizeof(msg->data) - 1] = '\0';
+    if (!Quiet)
+        printf("Received request: %s.....Replied.\n", msg->data);
+
+    // 응답 메시지 작성
+    msg->type = MSG_REPLY;
+    sprintf(msg->data, "This is a reply from %d.", Pid);
+    return sizeof(MsgType);
+}
+
+/*===============================================================
+[Function Name] : MakeSocket
+[Description]   : 
+    - UDP 소켓을 만들어 SERV_UDP_PORT에 bind한다.
+    - reusePort이면 SO_REUSEPORT를 설정하여 여러 소켓이 같은 포트에 bind한다.
+[Input]         : 
+    - int reusePort : 1이면 SO_REUSEPORT 설정
+[Output]        : 
+    - 없음
+[Call By]       : 
+    - main()
+[Calls]         : 
+    - socket(), setsockopt(), bind(), perror(), exit()
+[Given]         : 
+    - "udp.h" 파일에 SERV_UDP_PORT가 정의되어 있어야 함
+[Returns]       : 
+    - int : bind한 소켓
+================================================================*/
+int MakeSocket(int reusePort)
+{
+    struct sockaddr_in  servAddr; // 서버 주소 구조체
+    int                 sockfd, one = 1;
 
     // UDP 소켓 생성
-    if ((Sockfd = socket(PF_INET, SOCK_DGRAM, 0)) < 0)  {
+    if ((sockfd = socket(PF_INET, SOCK_DGRAM, 0)) < 0)  {
         perror("socket");
         exit(1);
     }
+    if (reusePort && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)  {
+        perror("setsockopt");
+        exit(1);
+    }
 
     // 서버 주소 구조체 초기화 및 설정
     bzero((char *)&servAddr, sizeof(servAddr));
@@ -72,34 +169,160 @@ int main(int argc, char *argv[])
     servAddr.sin_port = htons(SERV_UDP_PORT);    // 서버 포트 번호 설정
 
     // 소켓과 주소 바인딩
-    if (bind(Sockfd, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0)  {
+    if (bind(sockfd, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0)  {
         perror("bind");
         exit(1);
     }
 
-    printf("UDP Server started.....\n");
+    return sockfd;
+}
 
-    cliAddrLen = sizeof(cliAddr);
+/*===============================================================
+[Function Name] : Serve
+[Description]   : 
+    - sockfd로 들어온 요청에 응답하는 루프. BatchSize > 0이면 recvmmsg()로
+      받아 sendmmsg()로 응답하고, 0이면 요청마다 recvfrom()/sendto() (비교용)
+[Input]         : 
+    - int sockfd : 서버 소켓
+    - DgBatch *b : 일괄 처리 상태 (BatchSize > 0일 때)
+[Output]        : 
+    - 클라이언트로 응답 메시지 전송
+[Call By]       : 
+    - main(), WorkerThread()
+[Calls]         : 
+    - dgServe(), MakeReply(), recvfrom(), sendto(), printf(), perror(), exit()
+[Given]         : 
+    - 글로벌 변수 BatchSize, Quiet, Pid
+[Returns]       : 
+    - 없음 (무한 루프)
+================================================================*/
+void Serve(int sockfd, DgBatch *b)
+{
+    int                 cliAddrLen, n; // 클라이언트 주소 길이, 읽은 바이트 수
+    struct sockaddr_in  cliAddr; // 클라이언트 주소 구조체
+    MsgType             msg; // 메시지 구조체 (udp.h에서 정의됨)
+
+    // 요청을 recvmmsg()로 받아 sendmmsg()로 응답
+    while (BatchSize > 0)  {
+        if (dgServe(sockfd, b, MSG_WAITFORONE, MakeReply, NULL) < 0)  {
+            perror("recvmmsg");
+            exit(1);
+        }
+    }
+
+    // -b 0: 요청마다 recvfrom()/sendto() (비교용)
     while (1)  {
+        cliAddrLen = sizeof(cliAddr);
         // 클라이언트로부터 메시지 수신
-        if ((n = recvfrom(Sockfd, (char *)&msg, sizeof(msg), 
+        if ((n = recvfrom(sockfd, (char *)&msg, sizeof(msg), 
                     0, (struct sockaddr *)&cliAddr, &cliAddrLen)) < 0)  {
             perror("recvfrom");
             exit(1);
         }
-        printf("Received request: %s.....", msg.data);
+        if (!Quiet)
+            printf("Received request: %s.....", msg.data);
 
         // 응답 메시지 작성
         msg.type = MSG_REPLY;
-        sprintf(msg.data, "This is a reply from %d.", getpid());
+        sprintf(msg.data, "This is a reply from %d.", Pid);
 
         // 클라이언트에게 응답 메시지 전송
-        if (sendto(Sockfd, (char *)&msg, sizeof(msg),
+        if (sendto(sockfd, (char *)&msg, sizeof(msg),
                     0, (struct sockaddr *)&cliAddr, cliAddrLen) < 0)  {
             perror("sendto");
             exit(1);
         }
-        printf("Replied.\n");
+        if (!Quiet)
+            printf("Replied.\n");
     }
 }
 
+/*===============================================================
+[Function Name] : WorkerThread
+[Description]   : 
+    - -t 모드의 스레드. CPU (idx % 코어 수)에 고정한 뒤 자기 소켓에서 응답한다.
+[Input]         : 
+    - void *arg : UdpWorker *
+[Output]        : 
+    - 클라이언트로 응답 메시지 전송
+[Call By]       : 
+    - pthread_create() in main()
+[Calls]         : 
+    - pthread_setaffinity_np(), Serve()
+[Given]         : 
+    - 없음
+[Returns]       : 
+    - 없음 (무한 루프)
+================================================================*/
+void *WorkerThread(void *arg)
+{
+    UdpWorker   *w = (UdpWorker *)arg;
+    cpu_set_t   cpus;
+
+    // 스레드 i를 CPU (i % CPU 수)에 고정
+    CPU_ZERO(&cpus);
+    CPU_SET(w->idx % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    Serve(w->sockfd, &w->batch);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int     opt, i;
+    int     threads = -1;   // -t (-1: 소켓 하나)
+
+    while ((opt = getopt(argc, argv, "b:qt:")) != -1)  {
+        if (opt == 'b')
+            BatchSize = atoi(optarg);
+        else if (opt == 'q')
+            Quiet = 1;
+        else if (opt == 't')
+            threads = atoi(optarg);
+        else  {
+            fprintf(stderr, "Usage: %s [-b batch (0: recvfrom/sendto)] [-q] [-t threads (0: one per CPU)]\n", argv[0]);
+            exit(1);
+        }
+    }
+    if (threads == 0)
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    Pid = getpid();
+
+    // SIGINT 시그널 처리 등록 (Ctrl+C 시 CloseServer 호출)
+    signal(SIGINT, CloseServer);
+
+    if (threads < 0)  {
+        if (BatchSize > 0 && dgInit(&Batch, BatchSize) < 0)
+            exit(1);
+        Sockfd = MakeSocket(0);
+        printf("UDP Server started (batch %d).....\n", BatchSize);
+        fflush(stdout);
+        Serve(Sockfd, &Batch);
+    }
+
+    // -t: 스레드마다 SO_REUSEPORT 소켓 (커널이 요청 흐름을 소켓에 나눔)
+    Sockfd = -1;
+    if ((Workers = calloc(threads, sizeof(UdpWorker))) == NULL)  {
+        perror("calloc");
+        exit(1);
+    }
+    for (i = 0 ; i < threads ; i++)  {
+        Workers[i].idx = i;
+        Workers[i].sockfd = MakeSocket(1);
+        if (BatchSize > 0 && dgInit(&Workers[i].batch, BatchSize) < 0)
+            exit(1);
+    }
+    NWorker = threads;
+    for (i = 0 ; i < threads ; i++)  {
+        if (pthread_create(&Workers[i].tid, NULL, WorkerThread, &Workers[i]) != 0)  {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    printf("UDP Server started (batch %d, %d SO_REUSEPORT threads).....\n", BatchSize, threads);
+    fflush(stdout);
+
+    while (1)
+        pause();    // SIGINT를 기다림
+}
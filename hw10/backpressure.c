@@ -0,0 +1,227 @@
+/*===============================================================
+[Program Name] : backpressure.c
+[Description]  :
+    - 송신 대기열 high-water mark 정책과 대기열 깊이 통계 구현.
+    - bpEnqueue()는 수신자 대기열에 메시지를 넣되, 대기열이 hwm에
+      닿아 있으면 설정된 정책(새 메시지 버림/오래된 메시지 버림/
+      deadline 후 연결 끊기)을 적용한다. 대기열은 hwm 이상 자라지 않는다.
+[Input]        :
+    BpConfig *cfg;    // 정책 설정
+    BpStats *st;      // 통계
+    OutQueue *q;      // 수신자 송신 대기열 (크기 == hwm)
+[Output]       :
+    bpEnqueue()는 BP_QUEUED, BP_DROPPED 또는 BP_EVICT
+[Calls]        :
+    clock_gettime(), strcmp(), atoi()
+[특기사항]     :
+    - 대기열 lock은 호출하는 쪽의 책임 (backpressure.h 참조)
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "backpressure.h"
+
+/*===============================================================
+[Function Name] : void bpInit(BpConfig *cfg)
+[Description]   :
+    - 기본 설정 (BP_DROP_NEW, BP_HWM, BP_DEADLINE)
+[Input]         :
+    BpConfig *cfg;    // 설정
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void bpInit(BpConfig *cfg)
+{
+	cfg->policy = BP_DROP_NEW;
+	cfg->hwm = BP_HWM;
+	cfg->deadlineMs = BP_DEADLINE;
+}
+
+/*===============================================================
+[Function Name] : int bpParseOpt(BpConfig *cfg, int opt, const char *arg)
+[Description]   :
+    - getopt()가 돌려준 BP_OPTS 옵션 하나를 설정에 반영
+        -q hwm, -p drop-new|drop-oldest|disconnect, -d deadline_ms
+[Input]         :
+    BpConfig *cfg;    // 설정
+    int opt;          // 옵션 문자
+    const char *arg;  // 옵션 인자 (optarg)
+[Output]        : 없음
+[Calls]         : atoi(), strcmp()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 모르는 옵션이거나 값이 잘못되면 -1
+==================================================================*/
+int bpParseOpt(BpConfig *cfg, int opt, const char *arg)
+{
+	switch (opt)  {
+	case 'q':
+		if ((cfg->hwm = atoi(arg)) < 2)		// drop-oldest는 보내는 중인 메시지를 남겨야 함
+			return -1;
+		return 0;
+	case 'p':
+		if (strcmp(arg, "drop-new") == 0)
+			cfg->policy = BP_DROP_NEW;
+		else if (strcmp(arg, "drop-oldest") == 0)
+			cfg->policy = BP_DROP_OLDEST;
+		else if (strcmp(arg, "disconnect") == 0)
+			cfg->policy = BP_DISCONNECT;
+		else
+			return -1;
+		return 0;
+	case 'd':
+		if ((cfg->deadlineMs = atoi(arg)) < 0)
+			return -1;
+		return 0;
+	}
+
+	return -1;
+}
+
+/*===============================================================
+[Function Name] : long bpNow(void)
+[Description]   :
+    - 단조 증가 시계의 현재 시각 (ms)
+[Input]         : 없음
+[Output]        : 없음
+[Calls]         : clock_gettime()
+[Given]         : 없음
+[Returns]       : long; ms (0이 아님)
+==================================================================*/
+long bpNow(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000 + 1;
+}
+
+/*===============================================================
+[Function Name] : int bpEnqueue(const BpConfig *cfg, BpStats *st, OutQueue *q,
+                                int skip, long *stallSince, MsgBuf *mb)
+[Description]   :
+    - mb를 q에 넣는다. q가 hwm에 닿아 있으면 정책을 적용한다.
+    - *stallSince는 대기열이 가득 찬 채로 처음 발견된 시각이며,
+      빈 자리가 있어 넣을 수 있으면 0으로 돌아간다.
+[Input]         :
+    const BpConfig *cfg;  // 정책 설정
+    BpStats *st;          // 통계
+    OutQueue *q;          // 수신자 송신 대기열
+    int skip;             // 앞에서 버리면 안 되는 메시지 수 (보내는 중인 메시지)
+    long *stallSince;     // 수신자별 정체 시작 시각 (ms, 0이면 정체 아님)
+    MsgBuf *mb;           // 메시지 (참조 하나가 대기열로 넘어감)
+[Output]        : 없음
+[Calls]         : oqPush(), oqRemove(), mbUnref(), bpNow()
+[Given]         : q의 크기는 cfg->hwm
+[Returns]       : int; BP_QUEUED, BP_DROPPED, BP_EVICT (호출하는 쪽에서 연결을 끊음)
+==================================================================*/
+int bpEnqueue(const BpConfig *cfg, BpStats *st, OutQueue *q, int skip,
+			  long *stallSince, MsgBuf *mb)
+{
+	long	now;
+	int		depth, b, max;
+
+	if (oqIsFull(q))  {
+		switch (cfg->policy)  {
+		case BP_DROP_OLDEST:
+			if (oqCount(q) > skip)  {
+				mbUnref(oqRemove(q, skip));
+				atomic_fetch_add_explicit(&st->droppedOld, 1, memory_order_relaxed);
+				break;		// 빈 자리에 새 메시지를 넣음
+			}
+			// 버릴 수 있는 메시지가 없으면 새 메시지를 버림
+			/* fallthrough */
+		case BP_DROP_NEW:
+			mbUnref(mb);
+			atomic_fetch_add_explicit(&st->droppedNew, 1, memory_order_relaxed);
+			return BP_DROPPED;
+		case BP_DISCONNECT:
+			mbUnref(mb);
+			now = bpNow();
+			if (*stallSince == 0)
+				*stallSince = now;
+			else if (now - *stallSince >= cfg->deadlineMs)  {
+				atomic_fetch_add_explicit(&st->evicted, 1, memory_order_relaxed);
+				return BP_EVICT;
+			}
+			atomic_fetch_add_explicit(&st->droppedNew, 1, memory_order_relaxed);
+			return BP_DROPPED;
+		}
+	}
+	*stallSince = 0;
+	oqPush(q, mb);
+
+	// 깊이 통계: log2 히스토그램과 최대값
+	depth = oqCount(q);
+	for (b = 0 ; (1 << b) <= depth && b < BP_HIST - 1 ; b++)
+		;
+	atomic_fetch_add_explicit(&st->hist[b], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&st->enqueued, 1, memory_order_relaxed);
+	max = atomic_load_explicit(&st->maxDepth, memory_order_relaxed);
+	while (depth > max &&
+		   ! atomic_compare_exchange_weak_explicit(&st->maxDepth, &max, depth,
+												   memory_order_relaxed, memory_order_relaxed))
+		;
+
+	return BP_QUEUED;
+}
+
+/*===============================================================
+[Function Name] : void bpSum(BpStats *sum, BpStats *st)
+[Description]   :
+    - 스레드 하나의 통계 st를 sum에 더한다. (maxDepth는 큰 값)
+[Input]         :
+    BpStats *sum;         // 합계 (호출하는 쪽만 씀)
+    BpStats *st;          // 더할 통계
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void bpSum(BpStats *sum, BpStats *st)
+{
+	int		b;
+
+	sum->enqueued += st->enqueued;
+	sum->droppedNew += st->droppedNew;
+	sum->droppedOld += st->droppedOld;
+	sum->evicted += st->evicted;
+	if (st->maxDepth > sum->maxDepth)
+		sum->maxDepth = st->maxDepth;
+	for (b = 0 ; b < BP_HIST ; b++)
+		sum->hist[b] += st->hist[b];
+}
+
+/*===============================================================
+[Function Name] : void bpPrint(const BpConfig *cfg, BpStats *st)
+[Description]   :
+    - 정책 설정과 대기열 통계를 출력
+[Input]         :
+    const BpConfig *cfg;  // 정책 설정
+    BpStats *st;          // 통계
+[Output]        : 통계 (stdout)
+[Calls]         : printf()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void bpPrint(const BpConfig *cfg, BpStats *st)
+{
+	static const char	*name[] = { "drop-new", "drop-oldest", "disconnect" };
+	int					b;
+
+	printf("  backpressure: %s, hwm %d, deadline %d ms\n",
+		   name[cfg->policy], cfg->hwm, cfg->deadlineMs);
+	printf("  enqueued: %ld, dropped new: %ld, dropped oldest: %ld, evicted: %ld, max depth: %d\n",
+		   (long)st->enqueued, (long)st->droppedNew, (long)st->droppedOld,
+		   (long)st->evicted, (int)st->maxDepth);
+	printf("  depth histogram:");
+	for (b = 0 ; b < BP_HIST ; b++)  {
+		if (st->hist[b])
+			printf(" [%d-%d]:%ld", b ? 1 << (b - 1) : 0, b ? (1 << b) - 1 : 0, (long)st->hist[b]);
+	}
+	printf("\n");
+}
@@ -0,0 +1,69 @@
+/*===============================================================
+[Program Name] : backpressure.h
+[Description]  :
+    - 느린 수신자에 대한 송신 대기열 정책(backpressure) 선언.
+    - 클라이언트마다 송신 대기열에 high-water mark(hwm)를 두고, 대기열이
+      hwm에 닿으면 정책에 따라 처리한다.
+        BP_DROP_NEW    : 새 메시지를 버림
+        BP_DROP_OLDEST : 가장 오래된 (아직 보내기 시작하지 않은) 메시지를 버림
+        BP_DISCONNECT  : 새 메시지를 버리고, hwm에 머문 시간이
+                         deadline을 넘으면 연결을 끊음
+    - 대기열 깊이와 버린/끊은 수를 BpStats에 센다.
+[특기사항]     :
+    - 함수 정의는 backpressure.c에 있음.
+    - 대기열 lock은 호출하는 쪽의 책임, BpStats는 atomic으로 센다.
+    - 여러 스레드가 대기열에 넣는 서버는 스레드마다 BpStats를 두고
+      출력할 때 bpSum()으로 합친다. (카운터 cache line을 공유하지 않도록)
+==================================================================*/
+
+#ifndef _BACKPRESSURE_H_
+#define _BACKPRESSURE_H_
+
+#include <stdatomic.h>
+#include "outq.h"
+#include "msgbuf.h"
+
+#define	BP_HWM			128			// 기본 high-water mark
+#define	BP_DEADLINE		5000		// 기본 disconnect deadline (ms)
+#define	BP_HIST			12			// 깊이 히스토그램 칸 수 (0, 1, 2-3, 4-7, ...)
+
+#define	BP_QUEUED		0			// bpEnqueue() 리턴값
+#define	BP_DROPPED		1
+#define	BP_EVICT		(-1)
+
+typedef enum  {
+	BP_DROP_NEW,
+	BP_DROP_OLDEST,
+	BP_DISCONNECT
+}
+	BpPolicy;
+
+typedef struct  {
+	BpPolicy	policy;
+	int			hwm;			// 클라이언트별 최대 대기 메시지 수
+	int			deadlineMs;		// BP_DISCONNECT: hwm에 머물 수 있는 시간
+}
+	BpConfig;
+
+typedef struct  {
+	atomic_long	enqueued;
+	atomic_long	droppedNew;
+	atomic_long	droppedOld;
+	atomic_long	evicted;
+	atomic_int	maxDepth;
+	atomic_long	hist[BP_HIST];	// 넣은 직후의 대기열 깊이 분포
+}
+	BpStats;
+
+void	bpInit(BpConfig *cfg);
+int		bpParseOpt(BpConfig *cfg, int opt, const char *arg);
+long	bpNow(void);
+int		bpEnqueue(const BpConfig *cfg, BpStats *st, OutQueue *q, int skip,
+				  long *stallSince, MsgBuf *mb);
+void	bpSum(BpStats *sum, BpStats *st);
+void	bpPrint(const BpConfig *cfg, BpStats *st);
+
+#define	BP_OPTS			"q:p:d:"	// getopt 옵션 문자열 (bpParseOpt()가 처리)
+#define	BP_USAGE		"[-q hwm] [-p drop-new|drop-oldest|disconnect] [-d deadline_ms]"
+
+#endif
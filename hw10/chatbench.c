@@ -0,0 +1,503 @@
+/*===============================================================
+[Program Name] : chatbench.c (Chat Load Generator)
+[Description]  :
+    - chatc_multithread.c를 바탕으로 만든 채팅 서버 부하 생성기.
+    - 가상 사용자 여러 명(수천 명)으로 접속하여, 송신 스레드가 정해진
+      속도로 타임스탬프가 담긴 메시지를 보내고, 수신 스레드들이 모든
+      사용자 소켓에서 브로드캐스트를 받아 종단 간(fan-out) 지연을 잰다.
+    - 끝나면 처리량과 지연 분포(p50/p99/p999/max)를 출력하고
+      같은 내용을 CSV 한 줄로 남긴다.
+[Input]        :
+    -h host      : 서버 주소 (기본 127.0.0.1)
+    -u users     : 가상 사용자 수 (기본 100)
+    -s senders   : 그 중 메시지를 보내는 사용자 수 (기본 10)
+    -r rate      : 전체 송신 속도 (messages/s, 기본 100)
+    -d seconds   : 측정 시간 (기본 10)
+    -t threads   : 수신 스레드 수 (기본 4)
+    -R rooms     : 0보다 크면 사용자 i가 "/join benchN" (N = i % rooms)로 방에 들어감
+    -l label     : CSV에 남길 이름 (예: chats, chats_select)
+    -o file      : CSV를 덧붙일 파일 (없으면 stdout, 빈 파일이면 헤더를 먼저 씀)
+[Output]       :
+    처리량/지연 요약과 CSV 한 줄
+[Calls]        :
+    int  ConnectUser(struct sockaddr_in *addr, int i)
+    void *SendThread(void *arg)
+    void *ReceiveThread(void *arg)
+    void HistAdd(long *hist, long v)
+    long HistPercentile(long *hist, long n, double p)
+    main()
+[특기사항]     :
+    - 송신 시각은 실제로 보낸 시각이 아니라 예정된 시각을 쓴다. 송신이 밀려도
+      밀린 만큼이 지연에 잡힌다 (coordinated omission 방지).
+    - 같은 호스트(loopback)에서 CLOCK_MONOTONIC으로 재므로 시계 차이가 없다.
+    - 지연 히스토그램은 2의 거듭제곱 구간을 16칸으로 나눈 log-linear 형태로,
+      수신 스레드마다 따로 세고 끝날 때 합친다.
+==================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "chat.h"
+#include "frame.h"
+
+#define MAX_BUF        256
+#define MAX_THREAD     64
+#define MAX_EVENTS     256
+#define HIST_SUB_BITS  4                            // 2의 거듭제곱 구간마다 16칸
+#define HIST_SIZE      (64 << HIST_SUB_BITS)
+#define BENCH_TAG      "> T "                        // 서버가 붙인 "uid> " 뒤의 벤치 메시지 표시
+
+/*===============================================================
+[Structure]     : Receiver
+[Description]   :
+    - 수신 스레드 하나의 상태. 사용자 [first, last) 소켓을 epoll로 보고,
+      받은 벤치 메시지 수와 지연 히스토그램을 스레드마다 따로 센다.
+==================================================================*/
+typedef struct  {
+	pthread_t	tid;
+	int			first, last;
+	int			epfd;
+	long		received;
+	long		sum;                // 지연 합 (ns, 평균 계산용)
+	long		hist[HIST_SIZE];
+} Receiver;
+
+int			NUsers = 100, NSenders = 10, NThreads = 4, NRooms = 0;
+double		Rate = 100.0, Duration = 10.0;
+int			*Sockfd;                // 사용자별 소켓
+atomic_int	Stop;                   // 1: 송신 중지, 2: 수신 중지
+long		Sent, Expected;         // 보낸 메시지 수, 받아야 할 전달 수
+Receiver	Recv[MAX_THREAD];
+
+/*===============================================================
+[Function Name] : NowNs(void)
+[Description]   :
+    - CLOCK_MONOTONIC 현재 시각 (ns)
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : SendThread(), ReceiveThread(), main()
+[Calls]         : clock_gettime()
+[Given]         : 없음
+[Returns]       : long (ns)
+==================================================================*/
+long NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+/*===============================================================
+[Function Name] : HistAdd(long *hist, long v)
+[Description]   :
+    - 지연 v(ns)를 log-linear 히스토그램에 더한다. 16 미만은 그대로,
+      그 이상은 2의 거듭제곱 구간마다 16칸 (상대 오차 6% 이내)
+[Input]         :
+    long *hist   - 히스토그램 (HIST_SIZE칸)
+    long v       - 값 (ns)
+[Output]        : 없음
+[Call By]       : ReceiveThread()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void HistAdd(long *hist, long v)
+{
+	int e;
+
+	if (v < 0)
+		v = 0;
+	if (v < (1 << HIST_SUB_BITS)) {
+		hist[v]++;
+		return;
+	}
+	e = 63 - __builtin_clzl(v);
+	hist[((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) +
+		 ((v >> (e - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1))]++;
+}
+
+/*===============================================================
+[Function Name] : HistValue(int idx)
+[Description]   :
+    - 히스토그램 칸 idx의 하한 값 (ns)
+[Input]         :
+    int idx      - 칸 번호
+[Output]        : 없음
+[Call By]       : HistPercentile()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : long (ns)
+==================================================================*/
+long HistValue(int idx)
+{
+	int e;
+
+	if (idx < (1 << HIST_SUB_BITS))
+		return idx;
+	e = (idx >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+	return (long)((1 << HIST_SUB_BITS) + (idx & ((1 << HIST_SUB_BITS) - 1))) << (e - HIST_SUB_BITS);
+}
+
+/*===============================================================
+[Function Name] : HistPercentile(long *hist, long n, double p)
+[Description]   :
+    - n개를 담은 히스토그램에서 p 분위(0~1) 값
+[Input]         :
+    long *hist   - 히스토그램
+    long n       - 전체 개수
+    double p     - 분위 (예: 0.99)
+[Output]        : 없음
+[Call By]       : main()
+[Calls]         : HistValue()
+[Given]         : 없음
+[Returns]       : long (ns, 비어 있으면 0)
+==================================================================*/
+long HistPercentile(long *hist, long n, double p)
+{
+	long want = (long)(p * n + 0.5), acc = 0;
+	int  i;
+
+	if (n == 0)
+		return 0;
+	if (want < 1)
+		want = 1;
+	for (i = 0; i < HIST_SIZE; i++) {
+		acc += hist[i];
+		if (acc >= want)
+			return HistValue(i);
+	}
+	return HistValue(HIST_SIZE - 1);
+}
+
+/*===============================================================
+[Function Name] : ConnectUser(struct sockaddr_in *addr, int i)
+[Description]   :
+    - 서버에 접속하여 "benchN" ID를 보내고, 방을 쓰는 경우 방에 들어간다.
+[Input]         :
+    struct sockaddr_in *addr - 서버 주소
+    int i                    - 사용자 번호
+[Output]        : 없음
+[Call By]       : main()
+[Calls]         : socket(), connect(), setsockopt(), frameWrite()
+[Given]         : 전역변수 NRooms
+[Returns]       : int (소켓, 실패 시 -1)
+==================================================================*/
+int ConnectUser(struct sockaddr_in *addr, int i)
+{
+	char buf[MAX_BUF];
+	int  fd, one = 1;
+
+	if ((fd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+		perror("socket");
+		return -1;
+	}
+	if (connect(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0) {
+		perror("connect");
+		close(fd);
+		return -1;
+	}
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	snprintf(buf, sizeof(buf), "bench%d", i);
+	if (frameWrite(fd, buf, strlen(buf)) < 0) {
+		perror("send");
+		close(fd);
+		return -1;
+	}
+	if (NRooms > 0) {
+		snprintf(buf, sizeof(buf), "/join bench%d\n", i % NRooms);
+		if (frameWrite(fd, buf, strlen(buf)) < 0) {
+			perror("send");
+			close(fd);
+			return -1;
+		}
+	}
+	return fd;
+}
+
+/*===============================================================
+[Function Name] : *SendThread(void *arg)
+[Description]   :
+    - 송신 사용자들(0 ~ NSenders-1)을 돌아가며 1/Rate초 간격의 예정 시각에
+      "T <예정 시각 ns> <순번>" 메시지를 보낸다.
+    - 보낼 때마다 받아야 할 전달 수(같은 방의 다른 사용자 수)를 더한다.
+[Input]         : 없음
+[Output]        : 서버로 메시지 전송
+[Call By]       : pthread_create() in main()
+[Calls]         : clock_nanosleep(), frameWrite()
+[Given]         : 전역변수 Sockfd, NSenders, NUsers, NRooms, Rate, Stop, Sent, Expected
+[Returns]       : 없음(스레드 함수이므로 pthread_exit)
+==================================================================*/
+void *SendThread(void *arg)
+{
+	struct timespec ts;
+	char  buf[MAX_BUF];
+	long  start, due, interval = (long)(1e9 / Rate);
+	int   len, s, peers;
+
+	start = NowNs();
+	for (Sent = 0; ! atomic_load(&Stop); Sent++) {
+		due = start + Sent * interval;
+		ts.tv_sec  = due / 1000000000L;
+		ts.tv_nsec = due % 1000000000L;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+			;
+
+		s = Sent % NSenders;
+		len = snprintf(buf, sizeof(buf), "T %ld %ld\n", due, Sent);
+		if (frameWrite(Sockfd[s], buf, len) < 0) {
+			perror("send");
+			break;
+		}
+
+		// 같은 방의 다른 사용자 수
+		if (NRooms > 0)
+			peers = NUsers / NRooms + (s % NRooms < NUsers % NRooms) - 1;
+		else
+			peers = NUsers - 1;
+		Expected += peers;
+	}
+	pthread_exit(NULL);
+}
+
+/*===============================================================
+[Function Name] : *ReceiveThread(void *arg)
+[Description]   :
+    - 맡은 사용자 소켓들을 epoll로 보며 프레임을 받아, 벤치 메시지이면
+      지금 시각과 예정 송신 시각의 차이를 히스토그램에 더한다.
+    - 로그인/방 안내 등 다른 메시지는 무시한다.
+[Input]         :
+    void *arg    - Receiver *
+[Output]        : 없음
+[Call By]       : pthread_create() in main()
+[Calls]         : epoll_wait(), frRead(), frNext(), HistAdd()
+[Given]         : 전역변수 Sockfd, Stop
+[Returns]       : 없음(스레드 함수이므로 pthread_exit)
+==================================================================*/
+void *ReceiveThread(void *arg)
+{
+	Receiver          *r = arg;
+	FrameReader       *fr;
+	struct epoll_event ev, events[MAX_EVENTS];
+	char              *p, *t;
+	long               sent, lat;
+	int                i, n, nev, len;
+
+	if ((fr = calloc(r->last - r->first, sizeof(FrameReader))) == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+	if ((r->epfd = epoll_create1(0)) < 0) {
+		perror("epoll_create1");
+		exit(1);
+	}
+	for (i = r->first; i < r->last; i++) {
+		if (frInit(&fr[i - r->first], FRAME_BUF) < 0)
+			exit(1);
+		ev.events  = EPOLLIN;
+		ev.data.u32 = i;
+		if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, Sockfd[i], &ev) < 0) {
+			perror("epoll_ctl");
+			exit(1);
+		}
+	}
+
+	while (atomic_load(&Stop) < 2) {
+		if ((nev = epoll_wait(r->epfd, events, MAX_EVENTS, 100)) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("epoll_wait");
+			exit(1);
+		}
+		for (int e = 0; e < nev; e++) {
+			i = events[e].data.u32;
+			n = frRead(&fr[i - r->first], Sockfd[i]);
+			if (n <= 0) {
+				fprintf(stderr, "bench%d: %s\n", i, n == 0 ? "closed by server" : strerror(errno));
+				epoll_ctl(r->epfd, EPOLL_CTL_DEL, Sockfd[i], NULL);
+				continue;
+			}
+			while ((n = frNext(&fr[i - r->first], &p, &len)) > 0) {
+				// "benchN> T <ns> <seq>\n"
+				if ((t = memmem(p, len, BENCH_TAG, sizeof(BENCH_TAG) - 1)) == NULL)
+					continue;
+				sent = strtol(t + sizeof(BENCH_TAG) - 1, NULL, 10);
+				lat = NowNs() - sent;
+				HistAdd(r->hist, lat);
+				r->sum += lat;
+				r->received++;
+			}
+		}
+	}
+
+	for (i = r->first; i < r->last; i++)
+		frDestroy(&fr[i - r->first]);
+	free(fr);
+	close(r->epfd);
+	pthread_exit(NULL);
+}
+
+/*===============================================================
+[Function Name] : main(int argc, char *argv[])
+[Description]   :
+    - 옵션을 읽고 사용자들을 접속시킨 뒤 수신/송신 스레드를 시작
+    - 측정 시간이 지나면 송신을 멈추고 남은 메시지를 잠시 기다린 후
+      결과를 합쳐 요약과 CSV를 출력
+[Input]         :
+    int argc, char *argv[] - 옵션 (프로그램 설명 참조)
+[Output]        : 처리량/지연 요약, CSV
+[Call By]       : OS
+[Calls]         : ConnectUser(), pthread_create(), SendThread(), ReceiveThread(),
+                  HistPercentile()
+[Given]         : 전역변수 모두
+[Returns]       : int (프로그램 종료 상태)
+==================================================================*/
+int main(int argc, char *argv[])
+{
+	struct sockaddr_in servAddr;
+	struct hostent    *hp;
+	struct rlimit      rl;
+	struct stat        st;
+	pthread_t          tidSend;
+	static long        hist[HIST_SIZE];
+	char              *host = "127.0.0.1", *label = "chat", *csv = NULL;
+	long               received = 0, sum = 0, start, elapsed;
+	FILE              *out = stdout;
+	int                opt, i, j, per;
+
+	while ((opt = getopt(argc, argv, "h:u:s:r:d:t:R:l:o:")) != -1) {
+		switch (opt) {
+		case 'h': host = optarg; break;
+		case 'u': NUsers = atoi(optarg); break;
+		case 's': NSenders = atoi(optarg); break;
+		case 'r': Rate = atof(optarg); break;
+		case 'd': Duration = atof(optarg); break;
+		case 't': NThreads = atoi(optarg); break;
+		case 'R': NRooms = atoi(optarg); break;
+		case 'l': label = optarg; break;
+		case 'o': csv = optarg; break;
+		default:
+			fprintf(stderr, "Usage: %s [-h host] [-u users] [-s senders] [-r rate] [-d seconds]\n"
+					"       [-t threads] [-R rooms] [-l label] [-o csvfile]\n", argv[0]);
+			exit(1);
+		}
+	}
+	if (NUsers < 2 || NSenders < 1 || NSenders > NUsers || Rate <= 0 || Duration <= 0 ||
+		NThreads < 1 || NThreads > MAX_THREAD || NRooms < 0) {
+		fprintf(stderr, "Invalid options\n");
+		exit(1);
+	}
+	if (NThreads > NUsers)
+		NThreads = NUsers;
+
+	// 사용자마다 소켓 하나: 파일 디스크립터 한도를 최대로
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	bzero((char *)&servAddr, sizeof(servAddr));
+	servAddr.sin_family = PF_INET;
+	servAddr.sin_port   = htons(SERV_TCP_PORT);
+	if (isdigit(host[0])) {
+		servAddr.sin_addr.s_addr = inet_addr(host);
+	} else {
+		if ((hp = gethostbyname(host)) == NULL) {
+			fprintf(stderr, "Unknown host: %s\n", host);
+			exit(1);
+		}
+		memcpy(&servAddr.sin_addr, hp->h_addr, hp->h_length);
+	}
+
+	if ((Sockfd = calloc(NUsers, sizeof(int))) == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+	for (i = 0; i < NUsers; i++) {
+		if ((Sockfd[i] = ConnectUser(&servAddr, i)) < 0) {
+			fprintf(stderr, "Connected only %d users\n", i);
+			exit(1);
+		}
+	}
+	sleep(1);   // 로그인/방 이동이 끝나기를 기다림
+
+	// 수신 스레드: 사용자를 고르게 나누어 맡김
+	per = (NUsers + NThreads - 1) / NThreads;
+	for (j = 0; j < NThreads; j++) {
+		Recv[j].first = j * per;
+		Recv[j].last  = (j + 1) * per < NUsers ? (j + 1) * per : NUsers;
+		if (pthread_create(&Recv[j].tid, NULL, ReceiveThread, &Recv[j])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+
+	start = NowNs();
+	if (pthread_create(&tidSend, NULL, SendThread, NULL)) {
+		perror("pthread_create");
+		exit(1);
+	}
+	usleep((useconds_t)(Duration * 1e6));
+	atomic_store(&Stop, 1);
+	pthread_join(tidSend, NULL);
+	elapsed = NowNs() - start;
+
+	sleep(1);   // 전달 중인 메시지를 기다림
+	atomic_store(&Stop, 2);
+	for (j = 0; j < NThreads; j++) {
+		pthread_join(Recv[j].tid, NULL);
+		received += Recv[j].received;
+		sum += Recv[j].sum;
+		for (i = 0; i < HIST_SIZE; i++)
+			hist[i] += Recv[j].hist[i];
+	}
+
+	printf("%s: %d users, %d senders, %d rooms, %.0f msg/s for %.1f s\n",
+		   label, NUsers, NSenders, NRooms, Rate, elapsed / 1e9);
+	printf("  sent %ld (%.0f msg/s), delivered %ld of %ld (%.0f msg/s, %.2f%% lost)\n",
+		   Sent, Sent / (elapsed / 1e9), received, Expected, received / (elapsed / 1e9),
+		   Expected ? 100.0 * (Expected - received) / Expected : 0.0);
+	printf("  latency us: p50 %.1f  p99 %.1f  p999 %.1f  max %.1f  mean %.1f\n",
+		   HistPercentile(hist, received, 0.5) / 1e3, HistPercentile(hist, received, 0.99) / 1e3,
+		   HistPercentile(hist, received, 0.999) / 1e3, HistPercentile(hist, received, 1.0) / 1e3,
+		   received ? sum / 1e3 / received : 0.0);
+
+	if (csv) {
+		if ((out = fopen(csv, "a")) == NULL) {
+			perror(csv);
+			exit(1);
+		}
+	}
+	if (out == stdout || (stat(csv, &st) == 0 && st.st_size == 0))
+		fprintf(out, "label,users,senders,rooms,rate,seconds,sent,expected,delivered,"
+				"send_per_s,deliver_per_s,p50_us,p99_us,p999_us,max_us,mean_us\n");
+	fprintf(out, "%s,%d,%d,%d,%.0f,%.2f,%ld,%ld,%ld,%.0f,%.0f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+			label, NUsers, NSenders, NRooms, Rate, elapsed / 1e9, Sent, Expected, received,
+			Sent / (elapsed / 1e9), received / (elapsed / 1e9),
+			HistPercentile(hist, received, 0.5) / 1e3, HistPercentile(hist, received, 0.99) / 1e3,
+			HistPercentile(hist, received, 0.999) / 1e3, HistPercentile(hist, received, 1.0) / 1e3,
+			received ? sum / 1e3 / received : 0.0);
+	if (out != stdout)
+		fclose(out);
+
+	for (i = 0; i < NUsers; i++)
+		close(Sockfd[i]);
+	return 0;
+}
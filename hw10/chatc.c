@@ -16,12 +16,16 @@
     - main(int argc, char *argv[])
 [특기사항]     :
     - Ctrl + C(SIGINT) 입력 시 CloseClient()를 통해 정상 종료.
+    - 표준 입력이 EOF(Ctrl + D)에 도달해도 CloseClient()로 종료.
     - 서버가 종료되면 recv()에서 0 반환 → 클라이언트 종료 처리.
+    - ID와 메시지는 길이 접두 프레임(frame.h)으로 보내고, 받은 데이터는
+      재조립 버퍼에 모아 완성된 프레임을 모두 출력한다.
 ==================================================================*/
 
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -31,6 +35,7 @@
 #include <stdlib.h>  // exit() 사용을 위해 추가
 #include <ctype.h>   // isdigit() 사용을 위해 추가
 #include "chat.h"
+#include "frame.h"
 
 /*===============================================================
 [Definition] : 상수, 전역변수 등 정의
@@ -57,7 +62,7 @@ int  Sockfd;  // 서버와 통신할 소켓 식별자
 [Call By]       :
     - main()에서 호출됨
 [Calls]         :
-    - send(), recv(), select() 등 소켓 관련 함수
+    - frameWrite(), frRingRead(), frRingFlush(), select() 등 소켓 관련 함수
 [Given]         :
     - 전역변수 Sockfd
 [Returns]       :
@@ -65,9 +70,13 @@ int  Sockfd;  // 서버와 통신할 소켓 식별자
 ==================================================================*/
 void ChatClient(void)
 {
-    char    buf[MAX_BUF];
-    int     count, n;
-    fd_set  fdset;
+    char        buf[MAX_BUF];
+    int         count, n;
+    fd_set      fdset;
+    FrameRing   ring;
+
+    if (frRingInit(&ring, FR_RING_SIZE) < 0)
+        exit(1);
 
     printf("Enter ID: ");
     fflush(stdout);
@@ -79,12 +88,13 @@ void ChatClient(void)
      */
     *strchr(buf, '\n') = '\0';
 
-    // 입력받은 ID를 서버로 전송
-    if (send(Sockfd, buf, strlen(buf)+1, 0) < 0) {
+    // 입력받은 ID를 서버로 전송 (첫 프레임)
+    if (frameWrite(Sockfd, buf, strlen(buf)) < 0) {
         perror("send");
         exit(1);
     }
     printf("Press ^C to exit\n");
+    fflush(stdout);     // 이후 메시지는 stdio를 거치지 않고 writev()로 출력
 
     while (1) {
         FD_ZERO(&fdset);
@@ -101,7 +111,7 @@ void ChatClient(void)
         while (count--) {
             // 소켓에서 읽을 데이터가 있는 경우
             if (FD_ISSET(Sockfd, &fdset)) {
-                if ((n = recv(Sockfd, buf, MAX_BUF, 0)) < 0) {
+                if ((n = frRingRead(&ring, Sockfd)) < 0) {
                     perror("recv");
                     exit(1);
                 }
@@ -111,13 +121,22 @@ void ChatClient(void)
                     close(Sockfd);
                     exit(1);
                 }
-                // 서버로부터 받은 메시지를 화면에 출력
-                printf("%s", buf);
+                // 서버로부터 받은 메시지(완성된 프레임)를 writev() 한 번으로 모두 출력
+                if (frRingFlush(&ring, STDOUT_FILENO) < 0) {
+                    if (errno == EPROTO)
+                        fprintf(stderr, "Invalid frame from server.....\n");
+                    else
+                        perror("writev");
+                    close(Sockfd);
+                    exit(1);
+                }
             }
             // 키보드 입력(STDIN)이 있는 경우
             else if (FD_ISSET(STDIN_FILENO, &fdset)) {
-                fgets(buf, MAX_BUF, stdin);
-                if ((n = send(Sockfd, buf, strlen(buf)+1, 0)) < 0) {
+                // EOF(^D)면 stdin이 계속 readable로 보고되므로 바로 종료
+                if (fgets(buf, MAX_BUF, stdin) == NULL)
+                    CloseClient(0);
+                if ((n = frameWrite(Sockfd, buf, strlen(buf))) < 0) {
                     perror("send");
                     exit(1);
                 }
@@ -137,6 +156,7 @@ void ChatClient(void)
     - "Chat client terminated....." 메시지 출력
 [Call By]       :
     - signal(SIGINT, CloseClient)에 의해 호출
+    - ChatClient()에서 표준 입력 EOF 시 호출
 [Calls]         :
     - close() 함수 (소켓 닫기)
 [Given]         :
@@ -14,6 +14,7 @@
     main()
 [특기사항]     :
     - POSIX pthreads 사용
+    - ID와 메시지는 길이 접두 프레임(frame.h)으로 주고받는다.
 ==================================================================*/
 
 #include <stdio.h>
@@ -21,12 +22,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <ctype.h>
 #include <signal.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include "chat.h"
+#include "frame.h"
 
 #define MAX_BUF       256
 
@@ -58,7 +61,7 @@ void CloseClient(int signo)
 [Input]         : 없음(전역변수 Sockfd 사용)
 [Output]        : 서버로 채팅 메시지 전송
 [Call By]       : pthread_create() in main()
-[Calls]         : send()
+[Calls]         : frameWrite()
 [Given]         : 전역변수 Sockfd
 [Returns]       : 없음(스레드 함수이므로 pthread_exit)
 ==================================================================*/
@@ -72,7 +75,7 @@ void *SendThread(void *arg)
 			// EOF or error
 			break;
 		}
-		n = send(Sockfd, buf, strlen(buf)+1, 0);
+		n = frameWrite(Sockfd, buf, strlen(buf));
 		if (n < 0) {
 			perror("send");
 			pthread_exit(NULL);
@@ -85,20 +88,25 @@ void *SendThread(void *arg)
 [Function Name] : *ReceiveThread(void *arg)
 [Description]   : 
     - 서버로부터 메시지를 수신하여 화면에 출력하는 스레드
+    - 큰 수신 링으로 읽고, 들어 있는 완성된 프레임을 writev() 한 번으로
+      모두 출력 (메시지마다 printf()/fflush() 하지 않음)
 [Input]         : 없음(전역변수 Sockfd 사용)
 [Output]        : 화면에 받은 메시지 출력
 [Call By]       : pthread_create() in main()
-[Calls]         : recv()
+[Calls]         : frRingRead(), frRingFlush()
 [Given]         : 전역변수 Sockfd
 [Returns]       : 없음(스레드 함수이므로 pthread_exit)
 ==================================================================*/
 void *ReceiveThread(void *arg)
 {
-	char buf[MAX_BUF];
+	FrameRing ring;
 	int  n;
 
+	if (frRingInit(&ring, FR_RING_SIZE) < 0)
+		pthread_exit(NULL);
+
 	while (1) {
-		n = recv(Sockfd, buf, MAX_BUF, 0);
+		n = frRingRead(&ring, Sockfd);
 		if (n < 0) {
 			perror("recv");
 			pthread_exit(NULL);
@@ -107,8 +115,13 @@ void *ReceiveThread(void *arg)
 			fprintf(stderr, "Server terminated.....\n");
 			pthread_exit(NULL);
 		}
-		printf("%s", buf);
-		fflush(stdout);
+		if (frRingFlush(&ring, STDOUT_FILENO) < 0) {
+			if (errno == EPROTO)
+				fprintf(stderr, "Invalid frame from server.....\n");
+			else
+				perror("writev");
+			pthread_exit(NULL);
+		}
 	}
 	pthread_exit(NULL);
 }
@@ -175,7 +188,7 @@ int main(int argc, char *argv[])
 	if (fgets(buf, MAX_BUF, stdin) != NULL) {
 		char *p = strchr(buf, '\n');
 		if (p) *p = '\0'; // 개행 문자 제거
-		if (send(Sockfd, buf, strlen(buf)+1, 0) < 0) {
+		if (frameWrite(Sockfd, buf, strlen(buf)) < 0) {
 			perror("send");
 			exit(1);
 		}
@@ -0,0 +1,409 @@
+/*===============================================================
+[Program Name] : chatlog.c
+[Description]  :
+    - append-only 세그먼트 채팅 로그와 group-commit 쓰기 스레드 구현.
+    - 버퍼를 두 개 두어, lgAppend()가 한쪽을 채우는 동안 쓰기 스레드는
+      다른 쪽을 write()하고 fdatasync()한다. 동기화가 끝나면 버퍼를 바꾸므로
+      fsync 한 번에 그동안 쌓인 레코드가 모두 기록된다 (group commit).
+    - 재시작할 때는 세그먼트 파일을 이름 순서로 mmap하여 읽는다.
+      중간에 잘린 마지막 레코드(쓰는 도중 종료)는 무시한다.
+[Input]        :
+    ChatLog *lg;      // 로그
+    const char *dir;  // 세그먼트 디렉토리
+[Output]       :
+    세그먼트 파일 (dir/chat-NNNNNNNN.log)
+[Calls]        :
+    open(), write(), fdatasync(), fsync(), mmap(), scandir(), pthread_create()
+[특기사항]     :
+    - 재시작하면 항상 새 세그먼트에 쓰므로, 이전 세그먼트의 잘린 꼬리
+      뒤에 이어 쓰지 않는다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "chatlog.h"
+
+#define	LG_HDR			2			// 레코드 길이 필드 크기
+#define	LG_MAX_BODY		0xffff		// 레코드 길이 필드로 나타낼 수 있는 최대값
+
+/*===============================================================
+[Function Name] : static int lgIsSegment(const struct dirent *d)
+[Description]   :
+    - scandir() 필터: 세그먼트 파일 이름(chat-*.log)인지 검사
+[Input]         :
+    const struct dirent *d;   // 디렉토리 항목
+[Output]        : 없음
+[Calls]         : strncmp(), strlen()
+[Given]         : 없음
+[Returns]       : int; 세그먼트이면 1
+==================================================================*/
+static int lgIsSegment(const struct dirent *d)
+{
+	int		n = strlen(d->d_name);
+
+	return n > 9 && strncmp(d->d_name, "chat-", 5) == 0 && strcmp(d->d_name + n - 4, ".log") == 0;
+}
+
+/*===============================================================
+[Function Name] : static int lgOpenSegment(ChatLog *lg)
+[Description]   :
+    - lg->seg 번호의 세그먼트를 새로 만들고, 디렉토리를 fsync하여
+      파일 자체가 사라지지 않도록 한다.
+[Input]         :
+    ChatLog *lg;      // 로그
+[Output]        : 없음
+[Calls]         : open(), fsync()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+static int lgOpenSegment(ChatLog *lg)
+{
+	char	path[LG_PATH + 32];
+
+	snprintf(path, sizeof(path), "%s/chat-%08d.log", lg->dir, lg->seg);
+	if ((lg->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0644)) < 0)  {
+		perror(path);
+		return -1;
+	}
+	lg->segBytes = 0;
+	fsync(lg->dirFd);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : static int lgWrite(int fd, const char *p, int n)
+[Description]   :
+    - n바이트를 모두 쓸 때까지 write() 반복
+[Input]         :
+    int fd;           // 세그먼트
+    const char *p;    // 데이터
+    int n;            // 길이
+[Output]        : 없음
+[Calls]         : write()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+static int lgWrite(int fd, const char *p, int n)
+{
+	ssize_t	w;
+
+	while (n > 0)  {
+		if ((w = write(fd, p, n)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += w;
+		n -= w;
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : static void *lgWriter(void *arg)
+[Description]   :
+    - group-commit 쓰기 스레드
+    - 레코드가 들어오면 windowMs만큼 더 모은 뒤 버퍼를 바꾸고, 채워진
+      버퍼를 write() 한 번 + fdatasync() 한 번으로 기록한다.
+    - 세그먼트가 LG_SEG_SIZE를 넘게 되면 먼저 다음 세그먼트로 넘어간다.
+    - stop이면 남은 레코드를 모두 기록하고 끝난다.
+[Input]         :
+    void *arg;        // ChatLog *
+[Output]        : 세그먼트 파일
+[Calls]         : nanosleep(), lgWrite(), fdatasync(), lgOpenSegment()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+static void *lgWriter(void *arg)
+{
+	ChatLog			*lg = arg;
+	struct timespec	ts;
+	int				b, n;
+
+	ts.tv_sec  = lg->windowMs / 1000;
+	ts.tv_nsec = (lg->windowMs % 1000) * 1000000L;
+
+	pthread_mutex_lock(&lg->lock);
+	while (1)  {
+		while (lg->len[lg->cur] == 0 && ! lg->stop)
+			pthread_cond_wait(&lg->ready, &lg->lock);
+		if (lg->len[lg->cur] == 0)		// stop && 남은 레코드 없음
+			break;
+
+		// group-commit 창: 첫 레코드 뒤에 들어오는 레코드들을 같이 기록
+		if (lg->windowMs > 0 && ! lg->stop && lg->len[lg->cur] < LG_BUF_SIZE / 2)  {
+			pthread_mutex_unlock(&lg->lock);
+			nanosleep(&ts, NULL);
+			pthread_mutex_lock(&lg->lock);
+		}
+		b = lg->cur;
+		lg->cur = 1 - b;				// 다른 버퍼는 지난 commit 뒤에 비어 있음
+		n = lg->len[b];
+		pthread_cond_broadcast(&lg->space);
+		pthread_mutex_unlock(&lg->lock);
+
+		if (lg->segBytes > 0 && lg->segBytes + n > LG_SEG_SIZE)  {
+			close(lg->fd);				// 지난 commit에서 이미 동기화됨
+			lg->seg++;
+			if (lgOpenSegment(lg) < 0)
+				exit(1);
+		}
+		if (lgWrite(lg->fd, lg->buf[b], n) < 0 || fdatasync(lg->fd) < 0)  {
+			perror("chat log");
+			exit(1);
+		}
+		lg->segBytes += n;
+
+		pthread_mutex_lock(&lg->lock);
+		lg->len[b] = 0;
+		lg->bytes += n;
+		lg->commits++;
+	}
+	pthread_mutex_unlock(&lg->lock);
+
+	return NULL;
+}
+
+/*===============================================================
+[Function Name] : int lgOpen(ChatLog *lg, const char *dir, int windowMs)
+[Description]   :
+    - dir에 (없으면 만들고) 기존 세그먼트 다음 번호로 새 세그먼트를 열고
+      쓰기 스레드를 시작한다.
+    - 쓰기 스레드는 모든 시그널을 막은 채로 만든다.
+[Input]         :
+    ChatLog *lg;      // 초기화할 로그
+    const char *dir;  // 세그먼트 디렉토리
+    int windowMs;     // group-commit 창 (ms, 0이면 기다리지 않음)
+[Output]        : 없음
+[Calls]         : mkdir(), open(), scandir(), malloc(), lgOpenSegment(),
+                  pthread_sigmask(), pthread_create()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int lgOpen(ChatLog *lg, const char *dir, int windowMs)
+{
+	struct dirent	**list;
+	sigset_t		all, old;
+	int				i, n, seg;
+
+	memset(lg, 0, sizeof(ChatLog));
+	snprintf(lg->dir, sizeof(lg->dir), "%s", dir);
+	lg->windowMs = windowMs;
+
+	if (mkdir(lg->dir, 0755) < 0 && errno != EEXIST)  {
+		perror(lg->dir);
+		return -1;
+	}
+	if ((lg->dirFd = open(lg->dir, O_RDONLY | O_DIRECTORY)) < 0)  {
+		perror(lg->dir);
+		return -1;
+	}
+	if ((n = scandir(lg->dir, &list, lgIsSegment, alphasort)) < 0)  {
+		perror("scandir");
+		return -1;
+	}
+	for (i = 0 ; i < n ; i++)  {
+		if (sscanf(list[i]->d_name, "chat-%d.log", &seg) == 1 && seg > lg->seg)
+			lg->seg = seg;
+		free(list[i]);
+	}
+	free(list);
+	lg->seg++;
+	if (lgOpenSegment(lg) < 0)
+		return -1;
+
+	if ((lg->buf[0] = malloc(LG_BUF_SIZE)) == NULL || (lg->buf[1] = malloc(LG_BUF_SIZE)) == NULL)  {
+		perror("malloc");
+		return -1;
+	}
+	pthread_mutex_init(&lg->lock, NULL);
+	pthread_cond_init(&lg->ready, NULL);
+	pthread_cond_init(&lg->space, NULL);
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+	i = pthread_create(&lg->tid, NULL, lgWriter, lg);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (i)  {
+		perror("pthread_create");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int lgAppend(ChatLog *lg, int kind, const char *room, const char *data, int len)
+[Description]   :
+    - 레코드 하나를 쓰기 버퍼에 복사한다. (디스크 I/O 없음)
+    - 버퍼가 가득 차면 쓰기 스레드가 버퍼를 바꿀 때까지 기다린다.
+      (로그에 남기지 않고 버리지는 않음)
+[Input]         :
+    ChatLog *lg;      // 로그
+    int kind;         // LG_CHAT, LG_NOTICE
+    const char *room; // 방 이름 (255자 이하)
+    const char *data; // 데이터 (보낸 프레임)
+    int len;          // 데이터 길이
+[Output]        : 없음
+[Calls]         : memcpy(), pthread_cond_wait(), pthread_cond_signal()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 레코드가 너무 크거나 로그가 닫히면 -1
+==================================================================*/
+int lgAppend(ChatLog *lg, int kind, const char *room, const char *data, int len)
+{
+	int		rl = strlen(room), body, n;
+	char	*p;
+
+	if (rl > 255)
+		rl = 255;
+	body = 2 + rl + len;
+	if (body > LG_MAX_BODY)
+		return -1;
+	n = LG_HDR + body;
+
+	pthread_mutex_lock(&lg->lock);
+	while (lg->len[lg->cur] + n > LG_BUF_SIZE && ! lg->stop)  {
+		lg->stalls++;
+		pthread_cond_signal(&lg->ready);
+		pthread_cond_wait(&lg->space, &lg->lock);
+	}
+	if (lg->stop)  {
+		pthread_mutex_unlock(&lg->lock);
+		return -1;
+	}
+
+	p = lg->buf[lg->cur] + lg->len[lg->cur];
+	p[0] = (body >> 8) & 0xff;
+	p[1] = body & 0xff;
+	p[2] = kind;
+	p[3] = rl;
+	memcpy(p + 4, room, rl);
+	memcpy(p + 4 + rl, data, len);
+	if (lg->len[lg->cur] == 0)
+		pthread_cond_signal(&lg->ready);	// 쓰기 스레드는 빈 버퍼에서만 기다림
+	lg->len[lg->cur] += n;
+	lg->records++;
+	pthread_mutex_unlock(&lg->lock);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : void lgClose(ChatLog *lg)
+[Description]   :
+    - 남은 레코드를 기록(fdatasync)하고 쓰기 스레드를 끝낸 뒤 파일을 닫는다.
+[Input]         :
+    ChatLog *lg;      // 로그
+[Output]        : 없음
+[Calls]         : pthread_cond_broadcast(), pthread_join(), close(), free()
+[Given]         : lg의 lock을 잡고 있는 스레드에서 부르면 안 됨
+[Returns]       : 없음
+==================================================================*/
+void lgClose(ChatLog *lg)
+{
+	pthread_mutex_lock(&lg->lock);
+	lg->stop = 1;
+	pthread_cond_broadcast(&lg->ready);
+	pthread_cond_broadcast(&lg->space);
+	pthread_mutex_unlock(&lg->lock);
+
+	pthread_join(lg->tid, NULL);
+	close(lg->fd);
+	close(lg->dirFd);
+	free(lg->buf[0]);
+	free(lg->buf[1]);
+}
+
+/*===============================================================
+[Function Name] : void lgPrint(ChatLog *lg)
+[Description]   :
+    - 레코드 수와 fdatasync 수 (commit 하나에 들어간 평균 레코드 수) 출력
+[Input]         :
+    ChatLog *lg;      // 로그
+[Output]        : 통계
+[Calls]         : printf()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void lgPrint(ChatLog *lg)
+{
+	printf("  chat log: %s, %ld records, %ld bytes, %ld fdatasync (%.1f records/commit), %ld stalls\n",
+		   lg->dir, lg->records, lg->bytes, lg->commits,
+		   lg->commits ? (double)lg->records / lg->commits : 0.0, lg->stalls);
+}
+
+/*===============================================================
+[Function Name] : long lgReplay(const char *dir, LgReplayFn fn, void *arg)
+[Description]   :
+    - dir의 세그먼트를 번호 순서로 mmap하여 레코드마다 fn을 부른다.
+    - 세그먼트 끝의 잘린 레코드는 건너뛴다.
+[Input]         :
+    const char *dir;  // 세그먼트 디렉토리
+    LgReplayFn fn;    // 레코드마다 부를 함수 (data는 fn 안에서만 유효)
+    void *arg;        // fn에 넘길 인자
+[Output]        : 없음
+[Calls]         : scandir(), open(), fstat(), mmap(), madvise(), munmap()
+[Given]         : 없음
+[Returns]       : long; 읽은 레코드 수 (디렉토리가 없으면 0), 실패 시 -1
+==================================================================*/
+long lgReplay(const char *dir, LgReplayFn fn, void *arg)
+{
+	struct dirent	**list;
+	struct stat		st;
+	char			path[LG_PATH + 32], room[256];
+	unsigned char	*p;
+	long			off, total = 0;
+	int				i, n, fd, body, rl;
+
+	if ((n = scandir(dir, &list, lgIsSegment, alphasort)) < 0)
+		return errno == ENOENT ? 0 : -1;
+
+	for (i = 0 ; i < n ; i++)  {
+		snprintf(path, sizeof(path), "%s/%s", dir, list[i]->d_name);
+		free(list[i]);
+		if ((fd = open(path, O_RDONLY)) < 0)  {
+			perror(path);
+			continue;
+		}
+		if (fstat(fd, &st) < 0 || st.st_size == 0)  {
+			close(fd);
+			continue;
+		}
+		if ((p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)  {
+			perror("mmap");
+			close(fd);
+			continue;
+		}
+		close(fd);
+		madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+		for (off = 0 ; off + LG_HDR <= st.st_size ; off += LG_HDR + body)  {
+			body = (p[off] << 8) | p[off + 1];
+			if (body < 2 || off + LG_HDR + body > st.st_size)
+				break;					// 잘린 레코드
+			rl = p[off + 3];
+			if (2 + rl > body)
+				break;
+			memcpy(room, p + off + 4, rl);
+			room[rl] = '\0';
+			fn(arg, p[off + 2], room, (char *)p + off + 4 + rl, body - 2 - rl);
+			total++;
+		}
+		munmap(p, st.st_size);
+	}
+	free(list);
+
+	return total;
+}
@@ -0,0 +1,62 @@
+/*===============================================================
+[Program Name] : chatlog.h
+[Description]  :
+    - 브로드캐스트 메시지를 디스크에 남기는 append-only 채팅 로그 선언.
+    - 로그는 디렉토리 안의 세그먼트 파일(chat-00000001.log, ...)로
+      나뉘며, 세그먼트가 LG_SEG_SIZE를 넘으면 다음 파일로 넘어간다.
+    - lgAppend()는 레코드를 메모리 버퍼에 복사만 하고, 전용 쓰기 스레드가
+      group-commit 창(windowMs) 동안 모인 레코드를 write() 한 번과
+      fdatasync() 한 번으로 기록한다. (메시지마다 fsync하지 않음)
+    - lgReplay()는 세그먼트를 mmap하여 레코드를 차례로 돌려준다.
+[특기사항]     :
+    - 함수 정의는 chatlog.c에 있음.
+    - 레코드 = 2바이트 길이(network byte order) + kind(1) + 방 이름 길이(1)
+               + 방 이름 + 데이터 (서버가 보낸 프레임 그대로)
+==================================================================*/
+
+#ifndef _CHATLOG_H_
+#define _CHATLOG_H_
+
+#include <pthread.h>
+
+#define	LG_SEG_SIZE		(64 * 1024 * 1024)	// 세그먼트 최대 크기 (넘으면 다음 파일)
+#define	LG_BUF_SIZE		(1024 * 1024)		// 쓰기 버퍼 하나의 크기 (두 개를 번갈아 씀)
+#define	LG_WINDOW		2					// 기본 group-commit 창 (ms)
+#define	LG_PATH			256
+
+#define	LG_CHAT			'c'			// kind: 채팅 메시지
+#define	LG_NOTICE		'n'			// kind: 입장/퇴장 등 알림
+
+typedef struct  {
+	char			dir[LG_PATH];
+	int				dirFd;			// 새 세그먼트를 만든 뒤 디렉토리를 fsync
+	int				fd;				// 현재 세그먼트
+	int				seg;			// 현재 세그먼트 번호
+	long			segBytes;
+	int				windowMs;
+
+	pthread_t		tid;			// 쓰기 스레드
+	pthread_mutex_t	lock;
+	pthread_cond_t	ready;			// 쓸 레코드가 생김 (또는 stop)
+	pthread_cond_t	space;			// 쓰기 스레드가 버퍼를 바꿈
+	char			*buf[2];
+	int				len[2];
+	int				cur;			// lgAppend()가 채우는 버퍼
+	int				stop;
+
+	long			records;		// 통계 (lock으로 보호)
+	long			bytes;
+	long			commits;		// fdatasync() 수
+	long			stalls;			// 버퍼가 차서 lgAppend()가 기다린 수
+}
+	ChatLog;
+
+typedef void	(*LgReplayFn)(void *arg, int kind, const char *room, const char *data, int len);
+
+int		lgOpen(ChatLog *lg, const char *dir, int windowMs);
+int		lgAppend(ChatLog *lg, int kind, const char *room, const char *data, int len);
+void	lgClose(ChatLog *lg);
+void	lgPrint(ChatLog *lg);
+long	lgReplay(const char *dir, LgReplayFn fn, void *arg);
+
+#endif
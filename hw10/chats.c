@@ -1,21 +1,112 @@
 /*===============================================================
 [Program Name] : chats.c (Chat Server with Threads)
-[Description]  : 
-    - 스레드를 사용하여 서버에서 다중 클라이언트 연결을 처리한다.
+[Description]  :
+    - 크기가 고정된 작업자 스레드 풀로 서버에서 다중 클라이언트 연결을 처리한다.
     - 클라이언트로부터 전달받은 메시지를 다른 클라이언트에게 브로드캐스팅한다.
-[Input]        : 
-    none (프로그램 실행 시 포트 번호 등을 별도로 받지 않고, 소스 내에서 설정)
+    - 클라이언트마다 크기가 제한된 송신 대기열을 두어, 브로드캐스트하는
+      쪽은 다른 클라이언트의 send()에서 블록되지 않는다.
+[Input]        :
+    -q hwm       : 클라이언트별 송신 대기열 high-water mark (기본 BP_HWM)
+    -p policy    : 대기열이 가득 찼을 때 drop-new | drop-oldest | disconnect
+    -d deadline  : disconnect 정책에서 가득 찬 채로 버틸 수 있는 시간 (ms)
+    -l logdir    : 브로드캐스트를 남길 채팅 로그 디렉토리 (없으면 남기지 않음)
+    -g window    : 채팅 로그 group-commit 창 (ms, 기본 LG_WINDOW)
+    -s path      : 통계를 내보낼 UNIX 도메인 관리 소켓 (SIGUSR1은 항상 stdout에 보고)
+    -H path      : hot restart용 handoff 소켓. 이 경로에 실행 중인 서버가 있으면
+                   그 서버의 소켓과 접속자를 넘겨받고, 이후 이 경로에서 다음
+                   서버를 기다린다.
+    -B name      : 같은 호스트의 다른 채팅 서버 프로세스와 브로드캐스트를 주고받을
+                   공유 메모리 버스 이름 ("/chatbus" 등, 없으면 이 프로세스만)
+    -P port      : 서버 포트 (기본 SERV_TCP_PORT, 한 호스트에 여러 프로세스를 띄울 때)
+    nworker      : 작업자 스레드 수 (기본: CPU 코어 수)
 [Output]       :
     채팅 메시지 송수신, 클라이언트 로그인/로그아웃 정보
-[Calls]        : 
-    int GetID()
-    void SendToOtherClients(int id, char *buf)
-    void ProcessClient(int id)
+[Calls]        :
+    int GetID(int sockfd)
+    ClientType *ClientGet(int id)
+    void ClientUnref(ClientType *c)
+    MemberList *EmptyMembers(void)
+    MemberList *GetMembers(Room *room)
+    void PutMembers(MemberList *m)
+    MemberList *ReplaceMembers(Room *room, ClientType *add, ClientType *remove)
+    Room *NewRoom(const char *name)
+    int JoinRoom(ClientType *c, const char *name)
+    void ArmClient(ClientType *c, int op)
+    void FlushLocked(ClientType *c)
+    void MarkDirty(ClientType *c)
+    void FlushDirty(void)
+    void EnqueueMessage(ClientType *c, MsgBuf *mb)
+    void SendToOtherClients(ClientType *sender, char *buf, int len, int keep)
+    void SendNotice(ClientType *c, const char *fmt, ...)
+    void ReplayHistory(ClientType *c, int n)
+    void RestoreRecord(void *arg, int kind, const char *room, const char *data, int len)
+    int HandleCommand(ClientType *c, char *buf, int len)
+    int ReadClient(ClientType *c)
+    void LogOut(ClientType *c)
+    void HandleEvent(int id, uint32_t events)
+    void *WorkerThread(void *arg)
+    int SetNonBlocking(int fd)
+    int AcceptClients(void)
+    int ClaimClient(ClientType *c)
+    void DeliverRemote(int kind, const char *name, const char *data, int len)
+    void *BusThread(void *arg)
+    void StopBus(void)
+    void HandOff(void)
+    void RestoreClient(int fd, char *body, int len)
+    int TakeOver(const char *path)
     void CloseServer(int signo)
     main()
 [특기사항]     :
     - 소켓 프로그래밍 기반
     - POSIX pthreads 사용
+    - 연결마다 스레드를 만들지 않는다. 클라이언트 소켓은 EPOLLONESHOT으로
+      epoll에 등록되고, epoll의 준비 목록이 곧 작업 대기열이 된다.
+      작업자는 준비된 소켓을 하나씩 꺼내 recv() 한 번으로 들어온 프레임을
+      처리한 뒤 소켓을 다시 등록(re-arm)한다. 한 소켓은 한 번에 한
+      작업자만 처리하므로 연결별 수신 상태에는 lock이 필요 없다.
+    - 스레드 수(스택 메모리)는 접속자 수와 관계없이 작업자 수로 고정된다.
+    - 접속자 목록은 copy-on-write 스냅샷(MemberList)으로 관리한다.
+      로그인/로그아웃 때만 새 목록을 만들어 교체하고, 브로드캐스트는
+      스냅샷의 참조만 얻어 전역 Mutex 없이 순회한다.
+    - 브로드캐스트 메시지는 풀에서 얻은 MsgBuf에 한 번만 만들고,
+      같은 버퍼를 참조 카운트로 모든 수신자가 공유한다.
+    - 작업자는 이벤트 하나를 처리하는 동안 메시지를 넣은 연결을 모아 두었다가
+      (dirty list) 끝날 때 연결마다 sendmsg() 한 번으로 보낸다. 소켓 버퍼가
+      차면 EPOLLOUT을 기다렸다가 이어서 보낸다.
+    - 메시지는 길이 접두 프레임(frame.h)으로 주고받는다. 연결마다
+      재조립 버퍼(FrameReader)를 두어 한 번의 recv()로 들어온 여러
+      프레임과 나뉘어 들어온 프레임을 모두 처리한다.
+    - 클라이언트는 한 번에 한 방(Room)에 있으며, 로그인하면 로비(LOBBY)에
+      들어간다. "/join 방이름"으로 방을 옮기고 "/leave"로 로비에 돌아간다.
+      접속자 스냅샷은 방마다 따로 있으므로 메시지 하나의 비용은 그 방의
+      인원 수에만 비례한다.
+    - 방마다 최근 HIST_LEN개 채팅 메시지를 lock-free ring(history.h)에
+      MsgBuf 참조로 보관한다. "/history [n]"을 보내면 (로그인 직후 등)
+      같은 버퍼를 다시 대기열에 넣어 보내므로, 재접속이 몰려도 메모리에서
+      복사 없이 응답한다.
+    - -l을 주면 모든 브로드캐스트를 append-only 채팅 로그(chatlog.h)에
+      남긴다. 디스크 쓰기와 fdatasync()는 로그의 쓰기 스레드가 묶어서 하므로
+      작업자는 메모리 복사만 한다. 재시작하면 로그 세그먼트를 mmap으로
+      읽어 방별 최근 메시지 기록을 되살린다.
+    - 송신 대기열이 high-water mark에 닿으면 backpressure 정책을 적용하므로
+      읽지 않는 클라이언트가 메모리를 무한히 잡거나 다른 클라이언트의
+      전송을 막지 못한다.
+    - 메시지/바이트/대기열 통계는 스레드마다 캐시 라인을 따로 쓰는
+      슬롯(stats.h)에 세므로 처리 경로에서 lock이나 공유 atomic이 없다.
+      SIGUSR1이나 관리 소켓(-s)으로 요청하면 그때 슬롯을 더해 보고한다.
+    - -H로 hot restart를 한다. 새 서버를 같은 -H 경로로 띄우면 실행 중인
+      서버가 서버 소켓과 클라이언트 소켓을 SCM_RIGHTS로 넘기고(handoff.h),
+      클라이언트마다 uid, 방, 받다 만 프레임, 보내지 못한 바이트를 함께
+      보낸 뒤 끝난다. 서버 소켓은 한 번도 닫히지 않으므로 그 사이에 온
+      접속은 backlog에서 기다리고, 접속자는 끊기지 않는다.
+    - SIGINT/SIGTERM은 모든 스레드에서 막고 main 루프가 signalfd로 받으므로
+      종료 작업(통계 출력, 로그 기록)을 시그널 핸들러 밖에서 한다.
+    - -B를 주면 한 호스트의 여러 서버 프로세스가 공유 메모리 버스(shmbus.h)로
+      방을 나눠 쓴다. 브로드캐스트 프레임을 버스에 한 번 복사해 두면, 각
+      프로세스의 버스 스레드가 자기 MsgBuf로 한 번 복사하여 그 방의 접속자에게
+      보낸다. (중계 서버를 거치는 TCP 왕복이 없음) 버스 스레드가 받은
+      메시지는 다시 버스에 올리지 않는다. 버스가 한 바퀴 넘게 밀리면 뒤처진
+      프로세스는 넘친 메시지를 잃는다. (보내는 쪽은 기다리지 않음)
 ==================================================================*/
 
 #include <stdio.h>
@@ -27,19 +118,47 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <strings.h>
+#include <ctype.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
 #include "chat.h"
+#include "clienttab.h"
+#include "outq.h"
+#include "msgbuf.h"
+#include "frame.h"
+#include "room.h"
+#include "backpressure.h"
+#include "history.h"
+#include "chatlog.h"
+#include "stats.h"
+#include "handoff.h"
+#include "shmbus.h"
 
 #define DEBUG
-#define MAX_CLIENT       5
 #define MAX_ID           32
 #define MAX_BUF          256
+#define MAX_WORKER       64
+#define MAX_EVENTS       8      // 작업자가 한 번에 꺼내는 준비된 소켓 수 (작게 두어 고르게 분배)
+#define BUS_WAIT_MS      100    // 버스 스레드가 한 번에 잠드는 최대 시간 (StopBus() 지연)
 
 /*===============================================================
 [Function Name] : 구조체 정의 (ClientType)
-[Description]   : 
+[Description]   :
     - 각 클라이언트의 상태 정보를 저장하기 위한 구조체
-    - 소켓 FD, 사용중 여부, 스레드 ID, 사용자 ID를 포함
+    - 소켓 FD, 재조립 버퍼, 사용자 ID, 현재 방, 송신 대기열을 포함
+    - 사용중 여부는 클라이언트 테이블(CTab)이 관리
+    - refcnt가 0이 되어야 테이블 슬롯을 반납한다. (연결 자신과, 이 클라이언트를
+      담고 있는 접속자 스냅샷, dirty list, 처리 중인 작업자가 참조를 가짐)
+    - fr, uid, room은 소켓을 처리 중인 작업자(busy)만 건드린다.
+      나머지 송신/스케줄 상태는 qLock으로 보호한다.
 [Input]         : 없음
 [Output]        : 없음
 [Call By]       : main()
@@ -48,247 +167,1837 @@
 [Returns]       : 없음
 ==================================================================*/
 typedef struct  {
-	int			sockfd;     // 클라이언트 소켓 식별자
-	int			inUse;      // 현재 사용중인지 여부 (0: not in use, 1: in use)
-	pthread_t	tid;        // 클라이언트 전용 스레드 ID
-	char		uid[MAX_ID];// 클라이언트 사용자 ID
+	int				id;         // 세대 태그가 붙은 테이블 id
+	int				sockfd;     // 클라이언트 소켓 식별자 (닫히면 -1)
+	FrameReader		fr;         // 수신 재조립 버퍼
+	char			uid[MAX_ID];// 클라이언트 사용자 ID
+	Room			*room;      // 현재 방 (로그인 전에는 NULL)
+	atomic_int		refcnt;
+	pthread_mutex_t	qLock;      // 송신 대기열과 아래 상태 보호
+	int				busy;       // 작업자가 이 소켓을 처리 중
+	uint32_t		pending;    // 처리 중에 추가로 들어온 epoll 이벤트
+	int				dirty;      // 어떤 작업자의 dirty list에 들어 있음
+	int				blocked;    // 소켓 버퍼가 차서 EPOLLOUT을 기다림
+	int				closing;    // 1이면 더 이상 대기열에 넣거나 보내지 않음
+	long			stallSince; // 대기열이 가득 찬 채로 처음 발견된 시각 (ms)
+	int				off;        // 대기열 맨 앞 메시지에서 이미 보낸 바이트 수
+	OutQueue		q;
 } ClientType;
 
-int             Sockfd;
-pthread_mutex_t Mutex;
-ClientType      Client[MAX_CLIENT];
+/*===============================================================
+[Function Name] : 구조체 정의 (Worker)
+[Description]   :
+    - 작업자 스레드별 상태. dirty list는 이벤트 하나를 처리하는 동안
+      메시지를 넣은 연결들이며, 처리가 끝나면 FlushDirty()로 보낸다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : main(), WorkerThread()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+typedef struct  {
+	pthread_t		tid;
+	StSlot			*st;		// 이 작업자의 통계 슬롯
+	ClientType		**dirty;
+	int				nDirty;
+	int				dirtySize;
+	_Alignas(CACHE_LINE) BpStats	bp;	// 이 작업자의 송신 대기열 통계
+} Worker;
 
 /*===============================================================
-[Function Name] : GetID()
-[Description]   : 
-    - Client[] 배열에서 사용 가능한(빈) 인덱스를 찾아 리턴
+[Function Name] : 구조체 정의 (HandoffClient)
+[Description]   :
+    - hot restart 때 클라이언트 소켓과 함께 넘기는 상태 (HO_CLIENT body 앞부분)
+    - 뒤에 inLen 바이트의 받다 만 프레임, outLen 바이트의 보내지 못한
+      데이터(맨 앞 메시지의 남은 부분부터)가 이어진다.
 [Input]         : 없음
-[Output]        : 사용 가능한 Client[] 배열 인덱스
-[Call By]       : main()
+[Output]        : 없음
+[Call By]       : HandOff(), RestoreClient()
 [Calls]         : 없음
-[Given]         : Global 변수 Client[]
-[Returns]       : int (클라이언트 배열의 사용 가능한 인덱스)
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+typedef struct  {
+	char	uid[MAX_ID];
+	char	room[MAX_ROOM];	// 로그인 전이면 빈 문자열
+	int		inLen;
+	int		outLen;
+} HandoffClient;
+
+/*===============================================================
+[Function Name] : 구조체 정의 (HandoffBus)
+[Description]   :
+    - hot restart 때 HO_END body로 넘기는 공유 메모리 버스 위치.
+      새 서버가 넘겨준 서버의 cursor와 참여자 id를 이어 쓰므로 그 사이의
+      메시지를 잃거나, 넘겨준 서버가 이미 보낸 메시지를 다시 받지 않는다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : HandOff(), TakeOver()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+typedef struct  {
+	unsigned long	cursor;
+	int				self;
+} HandoffBus;
+
+/*===============================================================
+[Function Name] : 구조체 정의 (MemberList)
+[Description]   :
+    - 방 하나의 접속자 목록 읽기 전용 스냅샷. 만들어진 뒤에는 바뀌지 않으며,
+      마지막 참조가 PutMembers()로 반납될 때 해제된다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : SendToOtherClients(), ReplaceMembers()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
 ==================================================================*/
-int GetID()
+typedef struct  {
+	atomic_int	refcnt;
+	int			n;
+	ClientType	*member[];
+} MemberList;
+
+int             Sockfd;
+int             Epfd;       // 클라이언트 소켓의 준비 목록 (작업 대기열)
+Worker          *Workers;
+int             NWorker;
+__thread Worker *Self;      // 현재 작업자 스레드
+__thread StSlot *St;        // 현재 스레드의 통계 슬롯 (main은 acceptor 슬롯)
+__thread BpStats *BpSt;     // 현재 스레드의 송신 대기열 통계 (main은 BpStat)
+pthread_mutex_t Mutex;      // 테이블 할당/반납, 방 인덱스 및 스냅샷 교체를 직렬화
+pthread_mutex_t SnapLock;   // 방의 members 포인터를 읽고 참조를 얻는 동안만 잡음
+CTab            Clients;    // 클라이언트 테이블 (세대 태그 id로 접근)
+RoomTab         Rooms;      // 방 이름 -> 방 (members는 MemberList *)
+Room            *Lobby;     // 기본 방 (비어도 지우지 않음)
+StTable         Stats;      // 스레드별 통계 (슬롯 0은 main, 1부터 작업자)
+BpConfig        Bp;         // 송신 대기열 정책 (-q, -p, -d)
+_Alignas(CACHE_LINE) BpStats BpStat;   // main의 송신 대기열 깊이/버림 통계
+char            *LogDir;    // 채팅 로그 디렉토리 (-l, 없으면 NULL)
+ChatLog         Log;
+char            *HandoffPath;   // hot restart handoff 소켓 경로 (-H, 없으면 NULL)
+int             HandoffFd = -1; // 다음 서버를 기다리는 handoff 소켓
+int             Port = SERV_TCP_PORT;   // 서버 포트 (-P)
+char            *BusName;   // 공유 메모리 버스 이름 (-B, 없으면 NULL)
+ShmBus          Bus;
+Worker          BusWorker;  // 버스 스레드 (dirty list와 통계 슬롯)
+atomic_int      BusStop;    // 1이면 버스 스레드가 끝남
+
+#define	CLIENT(id)	((ClientType *)ctabGet(&Clients, (id)))
+
+/*===============================================================
+[Function Name] : GetID(int sockfd)
+[Description]   :
+    - 클라이언트 테이블의 free list에서 빈 슬롯을 O(1)에 할당하고
+      소켓, 재조립 버퍼, 송신 대기열을 초기화한 뒤 세대 태그가 붙은 id를 리턴
+    - 테이블이 가득 차면 청크를 추가하여 늘린다.
+[Input]         :
+    int sockfd   - accept()로 얻은 클라이언트 소켓
+[Output]        : 없음
+[Call By]       : main()
+[Calls]         : ctabAlloc(), frInit(), oqInit(), pthread_mutex_lock(), pthread_mutex_unlock()
+[Given]         : Global 변수 Clients, Mutex, Bp
+[Returns]       : int (클라이언트 id, 할당 실패 시 -1)
+==================================================================*/
+int GetID(int sockfd)
 {
-	int	i;
-	for (i = 0 ; i < MAX_CLIENT ; i++)  {
-		if (! Client[i].inUse)  {
-			Client[i].inUse = 1;   // 해당 인덱스 사용중으로 마킹
-			return i;
+	int			id;
+	ClientType	*c;
+
+	pthread_mutex_lock(&Mutex);
+	if ((id = ctabAlloc(&Clients)) >= 0)  {
+		c = CLIENT(id);
+		c->id = id;
+		c->sockfd = sockfd;
+		atomic_init(&c->refcnt, 1);		// 연결의 참조 (LogOut()에서 반납)
+		pthread_mutex_init(&c->qLock, NULL);
+		if (frInit(&c->fr, FRAME_BUF) < 0)  {
+			ctabFree(&Clients, id);
+			id = -1;
 		}
+		else if (oqInit(&c->q, Bp.hwm) < 0)  {
+			frDestroy(&c->fr);
+			ctabFree(&Clients, id);
+			id = -1;
+		}
+	}
+	pthread_mutex_unlock(&Mutex);
+
+	return id;  // 테이블을 더 늘릴 수 없을 때 -1 리턴(오류 처리용)
+}
+
+/*===============================================================
+[Function Name] : ClientGet(int id)
+[Description]   :
+    - epoll 이벤트의 id로 클라이언트를 찾고 참조를 하나 얻는다.
+    - 이미 반납된 슬롯(세대가 다름)이나 마지막 참조가 반납되는 중인
+      클라이언트이면 NULL을 리턴한다.
+[Input]         :
+    int id       - 세대 태그가 붙은 클라이언트 id
+[Output]        : 없음
+[Call By]       : HandleEvent()
+[Calls]         : ctabGet(), pthread_mutex_lock(), pthread_mutex_unlock()
+[Given]         : Global 변수 Clients, Mutex
+[Returns]       : ClientType * (사용 후 ClientUnref()로 반납) 또는 NULL
+==================================================================*/
+ClientType *ClientGet(int id)
+{
+	ClientType	*c;
+	int			ref;
+
+	pthread_mutex_lock(&Mutex);
+	if ((c = CLIENT(id)) != NULL)  {
+		ref = atomic_load(&c->refcnt);
+		do  {
+			if (ref == 0)  {	// ClientUnref()가 슬롯을 반납하는 중
+				c = NULL;
+				break;
+			}
+		} while (! atomic_compare_exchange_weak(&c->refcnt, &ref, ref + 1));
+	}
+	pthread_mutex_unlock(&Mutex);
+
+	return c;
+}
+
+/*===============================================================
+[Function Name] : ClientUnref(ClientType *c)
+[Description]   :
+    - 클라이언트 참조를 반납하고, 마지막 참조이면 대기열을 비우고
+      테이블 슬롯을 free list로 돌려준다.
+[Input]         :
+    ClientType *c - 클라이언트
+[Output]        : 없음
+[Call By]       : LogOut(), PutMembers(), FlushDirty(), HandleEvent()
+[Calls]         : oqPop(), mbUnref(), oqDestroy(), ctabFree()
+[Given]         : Global 변수 Clients, Mutex, Thread-local 변수 St
+[Returns]       : 없음
+==================================================================*/
+void ClientUnref(ClientType *c)
+{
+	MsgBuf	*mb;
+
+	if (atomic_fetch_sub(&c->refcnt, 1) != 1)
+		return;
+
+	stAdd(St, ST_QUEUED, -oqCount(&c->q));
+	while ((mb = oqPop(&c->q)) != NULL)
+		mbUnref(mb);
+	oqDestroy(&c->q);
+	pthread_mutex_destroy(&c->qLock);
+
+	pthread_mutex_lock(&Mutex);
+	ctabFree(&Clients, c->id);
+	pthread_mutex_unlock(&Mutex);
+}
+
+/*===============================================================
+[Function Name] : EmptyMembers(void)
+[Description]   :
+    - 접속자가 없는 빈 스냅샷을 만든다. (새 방을 만들 때)
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : NewRoom()
+[Calls]         : malloc()
+[Given]         : 없음
+[Returns]       : MemberList * (refcnt 1)
+==================================================================*/
+MemberList *EmptyMembers(void)
+{
+	MemberList	*m;
+
+	if ((m = malloc(sizeof(MemberList))) == NULL)  {
+		perror("malloc");
+		exit(1);
 	}
-	return -1;  // 모든 클라이언트가 사용중일 때 -1 리턴(오류 처리용)
+	atomic_init(&m->refcnt, 1);
+	m->n = 0;
+
+	return m;
 }
 
 /*===============================================================
-[Function Name] : SendToOtherClients(int id, char *buf)
-[Description]   : 
-    - id번 클라이언트가 보낸 메시지를 다른 클라이언트에게 전달(broadcast)
-[Input]         : 
-    int id       - 메시지를 보낸 클라이언트 인덱스
-    char *buf    - 메시지 버퍼
-[Output]        : 없음(단, 다른 클라이언트에게 메시지를 보냄)
-[Call By]       : ProcessClient()
+[Function Name] : GetMembers(Room *room)
+[Description]   :
+    - room의 현재 접속자 스냅샷의 참조를 얻는다. SnapLock은 포인터를
+      읽고 refcnt를 올리는 동안만 잡는다.
+[Input]         :
+    Room *room   - 방
+[Output]        : 없음
+[Call By]       : SendToOtherClients()
 [Calls]         : pthread_mutex_lock(), pthread_mutex_unlock()
-[Given]         : Global 변수 Client[]
+[Given]         : Global 변수 SnapLock
+[Returns]       : MemberList * (사용 후 PutMembers()로 반납)
+==================================================================*/
+MemberList *GetMembers(Room *room)
+{
+	MemberList	*m;
+
+	pthread_mutex_lock(&SnapLock);
+	m = room->members;
+	atomic_fetch_add(&m->refcnt, 1);
+	pthread_mutex_unlock(&SnapLock);
+
+	return m;
+}
+
+/*===============================================================
+[Function Name] : PutMembers(MemberList *m)
+[Description]   :
+    - 스냅샷 참조를 반납. 마지막 참조이면 스냅샷이 가지고 있던
+      클라이언트 참조들을 반납하고 스냅샷을 해제한다.
+[Input]         :
+    MemberList *m - 스냅샷
+[Output]        : 없음
+[Call By]       : SendToOtherClients(), JoinRoom()
+[Calls]         : ClientUnref(), free()
+[Given]         : 없음
 [Returns]       : 없음
 ==================================================================*/
-void SendToOtherClients(int id, char *buf)
+void PutMembers(MemberList *m)
 {
 	int		i;
-	char	msg[MAX_BUF + MAX_ID];
 
-	sprintf(msg, "%s> %s", Client[id].uid, buf);
+	if (atomic_fetch_sub(&m->refcnt, 1) != 1)
+		return;
+
+	for (i = 0 ; i < m->n ; i++)
+		ClientUnref(m->member[i]);
+	free(m);
+}
+
+/*===============================================================
+[Function Name] : ReplaceMembers(Room *room, ClientType *add, ClientType *remove)
+[Description]   :
+    - room의 스냅샷을 복사하면서 add를 추가하고 remove를 뺀 새 스냅샷을
+      만들어 교체한다 (copy-on-write). 이전 스냅샷을 순회 중인
+      브로드캐스트는 그대로 끝까지 진행된다.
+    - 복사 비용은 그 방의 인원 수에만 비례한다.
+[Input]         :
+    Room *room         - 방
+    ClientType *add    - 추가할 클라이언트 (없으면 NULL)
+    ClientType *remove - 제거할 클라이언트 (없으면 NULL)
+[Output]        : 없음
+[Call By]       : JoinRoom()
+[Calls]         : malloc()
+[Given]         : Mutex를 잡은 상태에서 호출, Global 변수 SnapLock
+[Returns]       : MemberList * (이전 스냅샷; Mutex를 푼 뒤 PutMembers()로 반납)
+==================================================================*/
+MemberList *ReplaceMembers(Room *room, ClientType *add, ClientType *remove)
+{
+	MemberList	*old, *new;
+	int			i;
+
+	old = room->members;
+	if ((new = malloc(sizeof(MemberList) + (old->n + 1) * sizeof(ClientType *))) == NULL)  {
+		perror("malloc");
+		exit(1);
+	}
+	atomic_init(&new->refcnt, 1);
+	new->n = 0;
+	for (i = 0 ; i < old->n ; i++)  {
+		if (old->member[i] != remove)  {
+			atomic_fetch_add(&old->member[i]->refcnt, 1);
+			new->member[new->n++] = old->member[i];
+		}
+	}
+	if (add)  {
+		atomic_fetch_add(&add->refcnt, 1);
+		new->member[new->n++] = add;
+	}
+
+	pthread_mutex_lock(&SnapLock);
+	room->members = new;
+	pthread_mutex_unlock(&SnapLock);
+	room->nMembers = new->n;
+
+	return old;
+}
+
+/*===============================================================
+[Function Name] : NewRoom(const char *name)
+[Description]   :
+    - 방 인덱스에 name 방을 만들고 빈 접속자 스냅샷과 빈 메시지 기록을 붙인다.
+[Input]         :
+    const char *name - 방 이름
+[Output]        : 없음
+[Call By]       : JoinRoom(), main()
+[Calls]         : rtCreate(), EmptyMembers(), malloc(), hsInit()
+[Given]         : Mutex를 잡은 상태에서 호출 (main()은 예외), Global 변수 Rooms
+[Returns]       : Room *; 방을 만들 수 없으면 NULL
+==================================================================*/
+Room *NewRoom(const char *name)
+{
+	Room		*room;
+	History		*h;
+
+	if ((room = rtCreate(&Rooms, name)) == NULL)
+		return NULL;
+	if ((h = malloc(sizeof(History))) == NULL)  {
+		perror("malloc");
+		exit(1);
+	}
+	hsInit(h);
+	room->members = EmptyMembers();
+	room->history = h;
+
+	return room;
+}
+
+/*===============================================================
+[Function Name] : JoinRoom(ClientType *c, const char *name)
+[Description]   :
+    - c를 현재 방에서 빼고 name 방에 넣는다. 방이 없으면 만든다.
+    - 로비가 아닌 방이 비면 방 인덱스에서 지운다. 빈 방의 스냅샷과 메시지
+      기록은 아무도 쓰지 않으므로 (방의 접속자만 그 방에 보내고 기록을 읽음)
+      바로 반납해도 된다.
+    - name이 NULL이면 방에서 나가기만 한다. (log-out)
+[Input]         :
+    ClientType *c    - 클라이언트
+    const char *name - 들어갈 방 이름 (MAX_ROOM-1자 이하) 또는 NULL
+[Output]        : 없음
+[Call By]       : ReadClient(), HandleCommand(), LogOut()
+[Calls]         : rtFind(), NewRoom(), rtRemove(), ReplaceMembers(),
+                  PutMembers(), hsDestroy(), free()
+[Given]         : Global 변수 Rooms, Lobby, Mutex
+                  c->room은 c를 처리 중인 작업자만 바꾼다.
+[Returns]       : int; 성공 0, 방을 만들 수 없으면 -1
+==================================================================*/
+int JoinRoom(ClientType *c, const char *name)
+{
+	Room		*old, *room = NULL;
+	MemberList	*put[3];
+	History		*hist = NULL;
+	int			i, nPut = 0;
+
+	pthread_mutex_lock(&Mutex);
+	old = c->room;
+	if (name)  {
+		if ((room = rtFind(&Rooms, name)) == NULL)  {
+			if ((room = NewRoom(name)) == NULL)  {
+				pthread_mutex_unlock(&Mutex);
+				return -1;
+			}
+		}
+		if (room == old)  {
+			pthread_mutex_unlock(&Mutex);
+			return 0;
+		}
+	}
+	if (old)  {
+		put[nPut++] = ReplaceMembers(old, NULL, c);
+		if (old->nMembers == 0 && old != Lobby)  {
+			put[nPut++] = old->members;
+			hist = old->history;
+			rtRemove(&Rooms, old);
+		}
+	}
+	if (room)
+		put[nPut++] = ReplaceMembers(room, c, NULL);
+	c->room = room;
+	pthread_mutex_unlock(&Mutex);
+
+	for (i = 0 ; i < nPut ; i++)
+		PutMembers(put[i]);
+	if (hist)  {
+		hsDestroy(hist);
+		free(hist);
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : ArmClient(ClientType *c, int op)
+[Description]   :
+    - c의 소켓을 EPOLLONESHOT으로 epoll에 (다시) 등록한다. 이벤트가 한 번
+      전달되면 다시 등록할 때까지 다른 작업자에게 전달되지 않는다.
+    - 송신이 막혀 있으면(blocked) 쓰기 가능도 기다린다.
+[Input]         :
+    ClientType *c - 클라이언트
+    int op        - EPOLL_CTL_ADD 또는 EPOLL_CTL_MOD
+[Output]        : 없음
+[Call By]       : main(), FlushLocked(), HandleEvent()
+[Calls]         : epoll_ctl()
+[Given]         : c->qLock을 잡은 상태에서 호출 (ADD는 예외), Global 변수 Epfd
+[Returns]       : 없음
+==================================================================*/
+void ArmClient(ClientType *c, int op)
+{
+	struct epoll_event	ev;
+
+	ev.events = EPOLLIN | EPOLLONESHOT | (c->blocked ? EPOLLOUT : 0);
+	ev.data.u64 = 0;
+	ev.data.u32 = c->id;
+	if (epoll_ctl(Epfd, op, c->sockfd, &ev) < 0)
+		perror("epoll_ctl");
+}
+
+/*===============================================================
+[Function Name] : FlushLocked(ClientType *c)
+[Description]   :
+    - c의 송신 대기열을 sendmsg()로 모아 보낸다. (non-blocking 소켓)
+    - 소켓 버퍼가 차면 blocked로 표시하고 EPOLLOUT을 기다린다. 작업자가
+      c를 처리 중이면 그 작업자가 끝날 때 다시 등록하므로 건드리지 않는다.
+    - 전송 실패 시 소켓을 shutdown하여 작업자가 log-out 처리를 하도록 한다.
+[Input]         :
+    ClientType *c - 클라이언트
+[Output]        : 클라이언트에게 메시지 전송
+[Call By]       : EnqueueMessage(), FlushDirty(), HandleEvent()
+[Calls]         : mbSendQueue(), ArmClient(), shutdown()
+[Given]         : c->qLock을 잡은 상태에서 호출, Thread-local 변수 St
+[Returns]       : 없음
+==================================================================*/
+void FlushLocked(ClientType *c)
+{
+	int		before, sent;
+	ssize_t	n;
+
+	while (! c->closing && ! c->blocked && ! oqIsEmpty(&c->q))  {
+		before = oqCount(&c->q);
+		stAdd(St, ST_SENDS, 1);
+		if ((n = mbSendQueue(c->sockfd, &c->q, &c->off)) < 0)  {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)  {
+				c->blocked = 1;
+				if (! c->busy)
+					ArmClient(c, EPOLL_CTL_MOD);
+				break;
+			}
+			perror("sendmsg");
+			c->closing = 1;
+			shutdown(c->sockfd, SHUT_RDWR);
+			break;
+		}
+		sent = before - oqCount(&c->q);
+		stAdd(St, ST_MSG_OUT, sent);
+		stAdd(St, ST_BYTES_OUT, n);
+		stAdd(St, ST_QUEUED, -sent);
+	}
+}
+
+/*===============================================================
+[Function Name] : MarkDirty(ClientType *c)
+[Description]   :
+    - c를 현재 작업자의 dirty list에 넣는다. (참조를 하나 얻음)
+      목록은 필요하면 두 배로 늘린다.
+[Input]         :
+    ClientType *c - 대기열에 메시지가 들어간 클라이언트 (c->dirty가 1로 바뀐 쪽)
+[Output]        : 없음
+[Call By]       : EnqueueMessage()
+[Calls]         : realloc()
+[Given]         : Thread-local 변수 Self
+[Returns]       : 없음
+==================================================================*/
+void MarkDirty(ClientType *c)
+{
+	ClientType	**p;
+	int			size;
+
+	if (Self->nDirty == Self->dirtySize)  {
+		size = Self->dirtySize ? Self->dirtySize * 2 : 256;
+		if ((p = realloc(Self->dirty, size * sizeof(ClientType *))) == NULL)  {
+			perror("realloc");
+			exit(1);
+		}
+		Self->dirty = p;
+		Self->dirtySize = size;
+	}
+	atomic_fetch_add(&c->refcnt, 1);
+	Self->dirty[Self->nDirty++] = c;
+}
+
+/*===============================================================
+[Function Name] : FlushDirty(void)
+[Description]   :
+    - 이벤트 하나를 처리하는 동안 메시지를 넣은 연결들을 연결마다
+      sendmsg() 한 번(대기열이 길면 MB_IOV_MAX개씩)으로 보낸다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : HandleEvent()
+[Calls]         : FlushLocked(), ClientUnref()
+[Given]         : Thread-local 변수 Self
+[Returns]       : 없음
+==================================================================*/
+void FlushDirty(void)
+{
+	ClientType	*c;
+	int			i;
+
+	for (i = 0 ; i < Self->nDirty ; i++)  {
+		c = Self->dirty[i];
+		pthread_mutex_lock(&c->qLock);
+		c->dirty = 0;
+		FlushLocked(c);
+		pthread_mutex_unlock(&c->qLock);
+		ClientUnref(c);
+	}
+	Self->nDirty = 0;
+}
+
+/*===============================================================
+[Function Name] : EnqueueMessage(ClientType *c, MsgBuf *mb)
+[Description]   :
+    - mb의 참조를 하나 늘려 c의 송신 대기열에 넣고, c를 dirty list에
+      넣어 현재 이벤트 처리가 끝날 때 보내도록 한다.
+    - 대기열이 high-water mark에 닿아 있으면 먼저 보내 보고, 그래도 차 있으면
+      backpressure 정책을 따른다. disconnect 정책의 deadline이 지나면 소켓을
+      shutdown하여 작업자가 log-out 처리를 하도록 한다. (송신자는 절대 블록되지 않음)
+    - 닫히는 중인 클라이언트에 대한 메시지는 버린다.
+[Input]         :
+    ClientType *c - 받는 클라이언트
+    MsgBuf *mb    - 공유 메시지 버퍼
+[Output]        : 없음
+[Call By]       : SendToMembers(), SendNotice()
+[Calls]         : mbRef(), mbUnref(), FlushLocked(), bpEnqueue(), MarkDirty(), shutdown()
+[Given]         : Global 변수 Bp, Thread-local 변수 St, BpSt
+[Returns]       : 없음
+==================================================================*/
+void EnqueueMessage(ClientType *c, MsgBuf *mb)
+{
+	int		r, before, mark = 0;
+
+	mbRef(mb);
+	pthread_mutex_lock(&c->qLock);
+	if (! c->closing && ! c->blocked && oqIsFull(&c->q))
+		FlushLocked(c);
+	if (c->closing)  {
+		pthread_mutex_unlock(&c->qLock);
+		mbUnref(mb);
+		return;
+	}
+	// 보내는 중인 맨 앞 메시지(off > 0)는 버리지 않는다
+	before = oqCount(&c->q);
+	r = bpEnqueue(&Bp, BpSt, &c->q, c->off > 0, &c->stallSince, mb);
+	// 넣었는데 깊이가 그대로면 drop-oldest로 하나를 버린 것
+	if (r != BP_QUEUED || oqCount(&c->q) == before)
+		stAdd(St, ST_DROPS, 1);
+	stAdd(St, ST_QUEUED, oqCount(&c->q) - before);
+	if (r == BP_EVICT)  {
+		c->closing = 1;
+		shutdown(c->sockfd, SHUT_RDWR);
+	}
+	else if (r == BP_QUEUED && ! c->dirty)  {
+		c->dirty = 1;
+		mark = 1;
+	}
+	pthread_mutex_unlock(&c->qLock);
+
+	if (mark)
+		MarkDirty(c);
+	if (r == BP_EVICT)
+		printf("Client %d (ID: %s) evicted: send queue full for %d ms\n",
+			   CTAB_SLOT(c->id), c->uid, Bp.deadlineMs);
+}
+
+/*===============================================================
+[Function Name] : NewMessage(ClientType *sender, char *buf, int len)
+[Description]   :
+    - sender가 보낸 payload로 "uid> ..." 프레임을 담은 공유 메시지 버퍼를 만든다.
+[Input]         :
+    ClientType *sender - 메시지를 보낸 클라이언트
+    char *buf          - 메시지 payload (NUL로 끝나지 않아도 됨)
+    int len            - payload 길이
+[Output]        : 없음
+[Call By]       : SendToOtherClients(), SendLeftNotice()
+[Calls]         : mbAlloc(), snprintf()
+[Given]         : 없음
+[Returns]       : MsgBuf * (참조 1개), 풀이 비었으면 NULL
+==================================================================*/
+MsgBuf *NewMessage(ClientType *sender, char *buf, int len)
+{
+	MsgBuf		*mb;
+	int			plen;
+
+	if ((mb = mbAlloc()) == NULL)
+		return NULL;
+	if (len > MAX_BUF)
+		len = MAX_BUF;
+	plen = snprintf(mb->data + FRAME_HDR, MB_DATA_SIZE - FRAME_HDR, "%s> %.*s", sender->uid, len, buf);
+	if (plen > MB_DATA_SIZE - FRAME_HDR - 1)
+		plen = MB_DATA_SIZE - FRAME_HDR - 1;
+	FRAME_PUT_LEN(mb->data, plen);
+	mb->len = FRAME_HDR + plen;
 #ifdef DEBUG
-	printf("[DEBUG] Broadcasting: %s", msg);
+	printf("[DEBUG] Broadcasting: %.*s", plen, mb->data + FRAME_HDR);
 	fflush(stdout);
 #endif
 
-	pthread_mutex_lock(&Mutex);                // 임계영역 시작
-	for (i = 0 ; i < MAX_CLIENT ; i++)  {
-		if (Client[i].inUse && (i != id))  {
-			if (send(Client[i].sockfd, msg, strlen(msg)+1, 0) < 0)  {
-				perror("send");
-				exit(1);
-			}
-		}
+	return mb;
+}
+
+/*===============================================================
+[Function Name] : SendToMembers(ClientType *sender, MemberList *m, MsgBuf *mb)
+[Description]   :
+    - 접속자 스냅샷 m의 sender가 아닌 모두에게 mb를 보낸다.
+[Input]         :
+    ClientType *sender - 메시지를 보낸 클라이언트
+    MemberList *m      - 방의 접속자 스냅샷
+    MsgBuf *mb         - 공유 메시지 버퍼
+[Output]        : 없음(단, 다른 클라이언트의 대기열에 메시지를 넣음)
+[Call By]       : SendToOtherClients(), SendLeftNotice()
+[Calls]         : EnqueueMessage()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void SendToMembers(ClientType *sender, MemberList *m, MsgBuf *mb)
+{
+	int			i;
+
+	for (i = 0 ; i < m->n ; i++)  {
+		if (m->member[i] != sender)
+			EnqueueMessage(m->member[i], mb);
 	}
-	pthread_mutex_unlock(&Mutex);              // 임계영역 끝
 }
 
 /*===============================================================
-[Function Name] : ProcessClient(int id)
-[Description]   : 
-    - id번 클라이언트가 보낸 메시지를 수신하여 다른 클라이언트에게 전달
-    - 클라이언트가 연결을 종료하면 log-out 처리 후 스레드 종료
-[Input]         : 
-    int id       - 클라이언트 배열 인덱스
-[Output]        : 클라이언트 로그인/로그아웃 및 메시지 송수신 결과
-[Call By]       : pthread_create()에 의해 생성된 스레드
-[Calls]         : SendToOtherClients()
-[Given]         : Global 변수 Client[], Mutex
-[Returns]       : 없음 (스레드 함수이므로 pthread_exit()로 종료)
+[Function Name] : SendToOtherClients(ClientType *sender, char *buf, int len, int keep)
+[Description]   :
+    - sender가 보낸 메시지를 같은 방의 다른 클라이언트에게 전달(broadcast)
+    - "uid> msg" payload의 프레임은 MsgBuf에 한 번만 만들고 길이도 한 번만
+      계산하며, 같은 버퍼를 각 클라이언트의 송신 대기열에 넣는다.
+    - keep이면 같은 버퍼를 방의 최근 메시지 기록에도 넣는다. (채팅 메시지만;
+      입장/퇴장 알림은 기록하지 않음)
+    - 채팅 로그를 남기는 중이면 알림을 포함한 모든 브로드캐스트를 로그에 넣는다.
+    - 버스(-B)가 있으면 같은 프레임을 버스에도 올려 다른 서버 프로세스의
+      같은 방 접속자에게 전달한다.
+    - 방의 접속자 스냅샷을 얻어 대기열에 넣기만 하므로 전역 Mutex를
+      잡지 않고, 느린 수신자에게 블록되지도 않는다.
+[Input]         :
+    ClientType *sender - 메시지를 보낸 클라이언트
+    char *buf          - 메시지 payload (NUL로 끝나지 않아도 됨)
+    int len            - payload 길이
+    int keep           - 1이면 방의 최근 메시지 기록에 넣음
+[Output]        : 없음(단, 다른 클라이언트의 대기열에 메시지를 넣음)
+[Call By]       : ReadClient(), HandleCommand(), LogOut()
+[Calls]         : NewMessage(), mbUnref(), hsPush(), lgAppend(), sbPublish(), GetMembers(),
+                  PutMembers(), SendToMembers()
+[Given]         : Global 변수 LogDir, Log, BusName, Bus, Thread-local 변수 St
+[Returns]       : 없음
 ==================================================================*/
-void ProcessClient(int id)
+void SendToOtherClients(ClientType *sender, char *buf, int len, int keep)
 {
-	char	buf[MAX_BUF];
-	int		n;
+	MsgBuf		*mb;
+	MemberList	*m;
 
-	if (pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL))  {
-		perror("pthread_setcancelstate");
-		exit(1);
+	if ((mb = NewMessage(sender, buf, len)) == NULL)
+		return;
+
+	stAdd(St, ST_BROADCASTS, 1);
+	if (keep)
+		hsPush(sender->room->history, mb);
+	if (LogDir)
+		lgAppend(&Log, keep ? LG_CHAT : LG_NOTICE, sender->room->name, mb->data, mb->len);
+	if (BusName)
+		sbPublish(&Bus, keep ? LG_CHAT : LG_NOTICE, sender->room->name, mb->data, mb->len);
+	m = GetMembers(sender->room);
+	SendToMembers(sender, m, mb);
+	PutMembers(m);
+	mbUnref(mb);	// 만든 쪽의 참조 반납: 마지막 송신이 끝나면 풀로 돌아감
+}
+
+/*===============================================================
+[Function Name] : SendLeftNotice(ClientType *c, const char *room, MemberList *m)
+[Description]   :
+    - c가 room 방을 떠났음을 그 방의 (떠나기 전) 접속자 스냅샷 m에게 알린다.
+      c는 이미 다른 방으로 옮겼고, room은 비어서 지워졌을 수 있으므로
+      방 대신 이름과 스냅샷을 받는다.
+[Input]         :
+    ClientType *c    - 방을 옮긴 클라이언트
+    const char *room - 떠난 방 이름
+    MemberList *m    - 떠나기 전에 얻어 둔 그 방의 접속자 스냅샷
+[Output]        : 없음(단, 다른 클라이언트의 대기열에 메시지를 넣음)
+[Call By]       : HandleCommand()
+[Calls]         : NewMessage(), lgAppend(), sbPublish(), SendToMembers(), mbUnref()
+[Given]         : Global 변수 LogDir, Log, BusName, Bus, Thread-local 변수 St
+[Returns]       : 없음
+==================================================================*/
+void SendLeftNotice(ClientType *c, const char *room, MemberList *m)
+{
+	MsgBuf		*mb;
+
+	if ((mb = NewMessage(c, "left the room.....\n", 19)) == NULL)
+		return;
+	stAdd(St, ST_BROADCASTS, 1);
+	if (LogDir)
+		lgAppend(&Log, LG_NOTICE, room, mb->data, mb->len);
+	if (BusName)
+		sbPublish(&Bus, LG_NOTICE, room, mb->data, mb->len);
+	SendToMembers(c, m, mb);
+	mbUnref(mb);
+}
+
+/*===============================================================
+[Function Name] : SendNotice(ClientType *c, const char *fmt, ...)
+[Description]   :
+    - 서버가 c에게만 보내는 안내 메시지 ("[server] ..." payload)
+[Input]         :
+    ClientType *c    - 받는 클라이언트
+    const char *fmt  - printf 형식 문자열
+[Output]        : 없음(단, c의 대기열에 메시지를 넣음)
+[Call By]       : HandleCommand(), ReplayHistory()
+[Calls]         : mbAlloc(), vsnprintf(), EnqueueMessage(), mbUnref()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void SendNotice(ClientType *c, const char *fmt, ...)
+{
+	int			plen;
+	MsgBuf		*mb;
+	va_list		ap;
+
+	if ((mb = mbAlloc()) == NULL)
+		return;
+	plen = snprintf(mb->data + FRAME_HDR, MB_DATA_SIZE - FRAME_HDR, "[server] ");
+	va_start(ap, fmt);
+	plen += vsnprintf(mb->data + FRAME_HDR + plen, MB_DATA_SIZE - FRAME_HDR - plen, fmt, ap);
+	va_end(ap);
+	if (plen > MB_DATA_SIZE - FRAME_HDR - 1)
+		plen = MB_DATA_SIZE - FRAME_HDR - 1;
+	FRAME_PUT_LEN(mb->data, plen);
+	mb->len = FRAME_HDR + plen;
+
+	EnqueueMessage(c, mb);
+	mbUnref(mb);
+}
+
+/*===============================================================
+[Function Name] : ReplayHistory(ClientType *c, int n)
+[Description]   :
+    - c가 있는 방의 최근 메시지 n개를 c에게 다시 보낸다.
+    - 기록에 있는 MsgBuf의 참조를 얻어 그대로 대기열에 넣으므로 프레임을
+      다시 만들거나 복사하지 않는다.
+[Input]         :
+    ClientType *c - 요청한 클라이언트
+    int n         - 보낼 메시지 수 (HIST_LEN 이하로 줄임)
+[Output]        : 없음(단, c의 대기열에 메시지를 넣음)
+[Call By]       : HandleCommand()
+[Calls]         : hsRecent(), SendNotice(), EnqueueMessage(), mbUnref()
+[Given]         : c가 방에 있어야 함 (방을 지우지 않도록)
+[Returns]       : 없음
+==================================================================*/
+void ReplayHistory(ClientType *c, int n)
+{
+	MsgBuf	*mb[HIST_LEN];
+	int		i;
+
+	n = hsRecent(c->room->history, n, mb);
+	SendNotice(c, "last %d messages in #%s\n", n, c->room->name);
+	for (i = 0 ; i < n ; i++)  {
+		EnqueueMessage(c, mb[i]);
+		mbUnref(mb[i]);
 	}
-	if (pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL))  {
-		perror("pthread_setcanceltype");
-		exit(1);
+}
+
+/*===============================================================
+[Function Name] : HandleCommand(ClientType *c, char *buf, int len)
+[Description]   :
+    - '/'로 시작하는 방 명령을 처리한다.
+        /join 방이름 : 방을 옮김 (없으면 만듦)
+        /leave       : 로비로 돌아감
+        /history [n] : 지금 방의 최근 메시지 n개 (기본 HIST_LEN)를 다시 받음
+    - 방을 옮길 때 이전 방과 새 방에 알린다. (옮기는 데 성공한 뒤에만)
+[Input]         :
+    ClientType *c - 명령을 보낸 클라이언트
+    char *buf     - payload (NUL로 끝나지 않아도 됨)
+    int len       - payload 길이
+[Output]        : 없음
+[Call By]       : ReadClient()
+[Calls]         : GetMembers(), JoinRoom(), PutMembers(), SendLeftNotice(), SendToOtherClients(),
+                  SendNotice(), ReplayHistory()
+[Given]         : 없음
+[Returns]       : int; 명령이면 1, 일반 메시지이면 0
+==================================================================*/
+int HandleCommand(ClientType *c, char *buf, int len)
+{
+	char		name[MAX_ROOM], oldName[MAX_ROOM];
+	MemberList	*old;
+	int			i, n;
+
+	if (len < 1 || buf[0] != '/')
+		return 0;
+
+	if (len >= 5 && strncmp(buf, "/join", 5) == 0 && (len == 5 || isspace((unsigned char)buf[5])))  {
+		for (i = 5 ; i < len && isspace((unsigned char)buf[i]) ; i++)
+			;
+		for (n = 0 ; i < len && ! isspace((unsigned char)buf[i]) && n < MAX_ROOM - 1 ; i++)
+			name[n++] = buf[i];
+		name[n] = '\0';
+		if (n == 0)  {
+			SendNotice(c, "usage: /join room\n");
+			return 1;
+		}
+	}
+	else if (len >= 6 && strncmp(buf, "/leave", 6) == 0 && (len == 6 || isspace((unsigned char)buf[6])))
+		strcpy(name, LOBBY);
+	else if (len >= 8 && strncmp(buf, "/history", 8) == 0 && (len == 8 || isspace((unsigned char)buf[8])))  {
+		for (i = 8, n = 0 ; i < len && isspace((unsigned char)buf[i]) ; i++)
+			;
+		for ( ; i < len && isdigit((unsigned char)buf[i]) && n < HIST_LEN ; i++)
+			n = n * 10 + buf[i] - '0';
+		ReplayHistory(c, n > 0 ? n : HIST_LEN);
+		return 1;
+	}
+	else
+		return 0;
+
+	if (strcmp(c->room->name, name) == 0)  {
+		SendNotice(c, "already in #%s\n", name);
+		return 1;
 	}
+	// 방을 옮긴 뒤에만 알린다 (옮기지 못하면 그대로 남아 있음)
+	strcpy(oldName, c->room->name);
+	old = GetMembers(c->room);
+	if (JoinRoom(c, name) < 0)  {
+		PutMembers(old);
+		SendNotice(c, "cannot create #%s\n", name);
+		return 1;
+	}
+	SendLeftNotice(c, oldName, old);
+	PutMembers(old);
+	SendToOtherClients(c, "joined the room.....\n", 21, 0);
+	SendNotice(c, "joined #%s (%d members)\n", name, c->room->nMembers);
+
+	return 1;
+}
 
-	// 클라이언트로부터 사용자 ID 수신
-	if ((n = recv(Client[id].sockfd, Client[id].uid, MAX_ID, 0)) < 0)  {
+/*===============================================================
+[Function Name] : ReadClient(ClientType *c)
+[Description]   :
+    - recv()를 한 번 호출하고, 읽은 데이터에 들어 있는 프레임을 모두 처리한다.
+    - 첫 프레임은 사용자 ID이며, 로그인하면 로비에 들어간다.
+      '/'로 시작하는 방 명령은 HandleCommand()가 처리하고, 나머지는
+      같은 방에 브로드캐스트한다.
+[Input]         :
+    ClientType *c - 클라이언트 (호출한 작업자가 처리 중)
+[Output]        : 클라이언트 로그인 정보
+[Call By]       : HandleEvent()
+[Calls]         : frRead(), frNext(), JoinRoom(), HandleCommand(), SendToOtherClients()
+[Given]         : 없음
+[Returns]       : int; 0 계속, -1 연결 종료 또는 오류 (log-out 처리 필요)
+==================================================================*/
+int ReadClient(ClientType *c)
+{
+	char		*p;
+	int			n, len;
+	ssize_t		r;
+
+	stAdd(St, ST_RECVS, 1);
+	if ((r = frRead(&c->fr, c->sockfd)) < 0)  {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			return 0;
 		perror("recv");
-		exit(1);
+		return -1;	// shutdown한 경우 등: log-out으로 처리
+	}
+	if (r == 0)
+		return -1;
+	stAdd(St, ST_BYTES_IN, r);
+
+	while ((n = frNext(&c->fr, &p, &len)) > 0)  {
+		stAdd(St, ST_MSG_IN, 1);
+		if (c->room == NULL)  {
+			// 클라이언트로부터 사용자 ID 수신 (첫 프레임)
+			if (len > MAX_ID - 1)
+				len = MAX_ID - 1;
+			memcpy(c->uid, p, len);
+			c->uid[len] = '\0';
+			printf("Client %d log-in (ID: %s).....\n", CTAB_SLOT(c->id), c->uid);
+			if (JoinRoom(c, LOBBY) < 0)
+				exit(1);
+		}
+		else if (! HandleCommand(c, p, len))
+			SendToOtherClients(c, p, len, 1);
 	}
-	printf("Client %d log-in (ID: %s).....\n", id, Client[id].uid);
+	if (n < 0)  {
+		fprintf(stderr, "Client %d: invalid frame\n", CTAB_SLOT(c->id));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : LogOut(ClientType *c)
+[Description]   :
+    - 클라이언트 소켓 종료 처리: 방에서 나가고, 소켓을 epoll에서 빼고
+      닫은 뒤 연결의 참조를 반납한다.
+    - c->busy는 그대로 두므로 이후에 도착한 이벤트는 무시된다.
+[Input]         :
+    ClientType *c - 클라이언트 (호출한 작업자가 처리 중)
+[Output]        : 클라이언트 로그아웃 정보
+[Call By]       : HandleEvent()
+[Calls]         : SendToOtherClients(), JoinRoom(), frDestroy(), epoll_ctl(),
+                  close(), ClientUnref()
+[Given]         : Global 변수 Epfd
+[Returns]       : 없음
+==================================================================*/
+void LogOut(ClientType *c)
+{
+	if (c->room)  {
+		printf("Client %d log-out (ID: %s).....\n", CTAB_SLOT(c->id), c->uid);
+		SendToOtherClients(c, "log-out.....\n", 13, 0);
+		JoinRoom(c, NULL);
+	}
+	frDestroy(&c->fr);
+	stAdd(St, ST_CLOSES, 1);
+
+	// closing을 먼저 표시하여 다른 작업자가 닫힌 소켓에 보내지 않도록 함
+	pthread_mutex_lock(&c->qLock);
+	c->closing = 1;
+	epoll_ctl(Epfd, EPOLL_CTL_DEL, c->sockfd, NULL);
+	close(c->sockfd);
+	c->sockfd = -1;
+	pthread_mutex_unlock(&c->qLock);
+
+	ClientUnref(c);	// 마지막 참조이면 슬롯을 다시 사용 가능 상태로 (free list)
+}
+
+/*===============================================================
+[Function Name] : HandleEvent(int id, uint32_t events)
+[Description]   :
+    - 준비된 소켓 하나를 처리한다: 읽을 데이터가 있으면 recv() 한 번 분량의
+      메시지를 처리하고, 쓰기 가능이면 남은 송신 대기열을 보낸 뒤
+      소켓을 다시 등록한다.
+    - 다른 작업자가 이미 처리 중이면 이벤트를 pending에 남겨 그 작업자가
+      이어서 처리하게 한다. (FlushLocked()가 막힌 소켓을 등록하는 순간
+      이벤트가 이미 다른 작업자에게 전달되어 있을 수 있음)
+    - 처리 중에 메시지를 넣은 연결들은 끝날 때 FlushDirty()로 보내고,
+      그 다음에 busy를 푼다.
+[Input]         :
+    int id          - epoll 이벤트의 클라이언트 id
+    uint32_t events - epoll 이벤트
+[Output]        : 없음
+[Call By]       : WorkerThread()
+[Calls]         : ClientGet(), ReadClient(), LogOut(), FlushLocked(), ArmClient(),
+                  FlushDirty(), ClientUnref()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void HandleEvent(int id, uint32_t events)
+{
+	ClientType	*c;
+
+	if ((c = ClientGet(id)) == NULL)
+		return;
+
+	pthread_mutex_lock(&c->qLock);
+	if (c->busy)  {
+		c->pending |= events;
+		pthread_mutex_unlock(&c->qLock);
+		ClientUnref(c);
+		return;
+	}
+	c->busy = 1;
+	pthread_mutex_unlock(&c->qLock);
+
+	while (events)  {
+		if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && ReadClient(c) < 0)  {
+			LogOut(c);
+			break;
+		}
+
+		pthread_mutex_lock(&c->qLock);
+		if (events & EPOLLOUT)
+			c->blocked = 0;
+		FlushLocked(c);
+		events = c->pending;
+		c->pending = 0;
+		pthread_mutex_unlock(&c->qLock);
+		if (events)
+			continue;
+
+		// 다른 연결에 넣은 메시지를 보낸 뒤에야 c를 놓는다.
+		// (ClaimClient()로 모두 잡은 뒤에는 보내는 작업자가 없도록)
+		FlushDirty();
+		pthread_mutex_lock(&c->qLock);
+		if ((events = c->pending) == 0)  {
+			c->busy = 0;
+			ArmClient(c, EPOLL_CTL_MOD);
+		}
+		c->pending = 0;
+		pthread_mutex_unlock(&c->qLock);
+	}
+
+	FlushDirty();	// LogOut()의 알림
+	ClientUnref(c);
+}
+
+/*===============================================================
+[Function Name] : *WorkerThread(void *arg)
+[Description]   :
+    - epoll의 준비 목록에서 준비된 소켓을 꺼내 처리하는 작업자 스레드
+    - EPOLLONESHOT이므로 꺼낸 소켓은 다시 등록할 때까지 이 작업자만 처리한다.
+[Input]         :
+    void *arg    - Worker *
+[Output]        : 없음
+[Call By]       : pthread_create() in main()
+[Calls]         : epoll_wait(), HandleEvent()
+[Given]         : Global 변수 Epfd
+[Returns]       : 없음(무한 루프)
+==================================================================*/
+void *WorkerThread(void *arg)
+{
+	struct epoll_event	events[MAX_EVENTS];
+	int					n, i;
+
+	Self = arg;
+	St = Self->st;
+	BpSt = &Self->bp;
 
-	// 메시지 수신 루프
 	while (1)  {
-		if ((n = recv(Client[id].sockfd, buf, MAX_BUF, 0)) < 0)  {
-			perror("recv");
+		if ((n = epoll_wait(Epfd, events, MAX_EVENTS, -1)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			perror("epoll_wait");
 			exit(1);
 		}
-		if (n == 0)  {
-			// 클라이언트 소켓 종료 처리
-			printf("Client %d log-out (ID: %s).....\n", id, Client[id].uid);
+		for (i = 0 ; i < n ; i++)
+			HandleEvent(events[i].data.u32, events[i].events);
+	}
 
-			pthread_mutex_lock(&Mutex);
-			close(Client[id].sockfd);
-			Client[id].inUse = 0; // 다시 사용 가능 상태로
-			pthread_mutex_unlock(&Mutex);
+	return NULL;
+}
 
-			strcpy(buf, "log-out.....\n");
-			SendToOtherClients(id, buf);
+/*===============================================================
+[Function Name] : SetNonBlocking(int fd)
+[Description]   :
+    - fd에 O_NONBLOCK 플래그를 설정 (작업자가 recv()/sendmsg()에서
+      블록되지 않도록)
+[Input]         :
+    int fd       - 파일 디스크립터
+[Output]        : 없음
+[Call By]       : main()
+[Calls]         : fcntl()
+[Given]         : 없음
+[Returns]       : int (성공 0, 실패 -1)
+==================================================================*/
+int SetNonBlocking(int fd)
+{
+	int		flags;
 
-			pthread_exit(NULL); // 스레드 종료
+	if ((flags = fcntl(fd, F_GETFL, 0)) < 0)
+		return -1;
+	return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/*===============================================================
+[Function Name] : RestoreRecord(void *arg, int kind, const char *room, const char *data, int len)
+[Description]   :
+    - 채팅 로그 레코드 하나를 방의 최근 메시지 기록에 되살린다. (재시작할 때)
+    - 레코드의 데이터는 보냈던 프레임 그대로이므로 MsgBuf에 복사만 한다.
+      알림(LG_NOTICE)은 기록에 넣지 않는다.
+[Input]         :
+    void *arg        - 사용하지 않음
+    int kind         - LG_CHAT, LG_NOTICE
+    const char *room - 방 이름
+    const char *data - 프레임 (mmap된 세그먼트 안)
+    int len          - 프레임 길이
+[Output]        : 없음
+[Call By]       : lgReplay() in main()
+[Calls]         : rtFind(), NewRoom(), mbAlloc(), hsPush(), mbUnref()
+[Given]         : 작업자를 만들기 전에 호출, Global 변수 Rooms
+[Returns]       : 없음
+==================================================================*/
+void RestoreRecord(void *arg, int kind, const char *room, const char *data, int len)
+{
+	Room	*r;
+	MsgBuf	*mb;
+
+	if (kind != LG_CHAT || len > MB_DATA_SIZE)
+		return;
+	if ((r = rtFind(&Rooms, room)) == NULL && (r = NewRoom(room)) == NULL)
+		return;
+	if ((mb = mbAlloc()) == NULL)
+		return;
+	memcpy(mb->data, data, len);
+	mb->len = len;
+	hsPush(r->history, mb);
+	mbUnref(mb);
+}
+
+/*===============================================================
+[Function Name] : AcceptClients(void)
+[Description]   :
+    - 서버 소켓에 대기 중인 연결을 EAGAIN까지 모두 accept하여
+      클라이언트 테이블에 넣고 epoll에 등록한다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : main()
+[Calls]         : accept(), SetNonBlocking(), GetID(), ArmClient()
+[Given]         : Global 변수 Sockfd (non-blocking), Mutex
+[Returns]       : int; 0 계속, -1 서버 소켓 오류
+==================================================================*/
+int AcceptClients(void)
+{
+	struct sockaddr_in	cliAddr;
+	socklen_t			cliAddrLen;
+	ClientType			*c;
+	int					newSockfd, id;
+
+	while (1)  {
+		cliAddrLen = sizeof(cliAddr);
+		newSockfd = accept(Sockfd, (struct sockaddr *) &cliAddr, &cliAddrLen);
+		if (newSockfd < 0)  {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			perror("accept");
+			return -1;
+		}
+		if (SetNonBlocking(newSockfd) < 0)  {
+			perror("fcntl");
+			close(newSockfd);
+			continue;
 		}
 
-		// 받은 메시지를 다른 클라이언트에게 전송
-		SendToOtherClients(id, buf);
+		stAdd(St, ST_ACCEPTS, 1);
+		id = GetID(newSockfd);
+		if (id < 0) {
+			// 더 이상 클라이언트를 받을 수 없음
+			fprintf(stderr, "Maximum number of clients reached.\n");
+			close(newSockfd);
+			continue;
+		}
+
+		// 등록하는 순간부터 작업자가 처리하므로 초기화가 끝난 뒤에 등록
+		pthread_mutex_lock(&Mutex);
+		c = CLIENT(id);   // 청크는 옮겨지지 않으므로 포인터가 유지됨
+		pthread_mutex_unlock(&Mutex);
+		ArmClient(c, EPOLL_CTL_ADD);
 	}
 }
 
 /*===============================================================
-[Function Name] : CloseServer(int signo)
-[Description]   : 
-    - SIGINT(Ctrl+C) 시그널을 받았을 때, 서버를 안전하게 종료
-[Input]         : 
-    int signo    - 시그널 번호
-[Output]        : 서버 종료 메시지
-[Call By]       : signal(SIGINT, CloseServer)
-[Calls]         : pthread_cancel(), pthread_join(), close()
-[Given]         : Global 변수 Sockfd, Client[], Mutex
-[Returns]       : 없음(프로그램 종료)
+[Function Name] : ClaimClient(ClientType *c)
+[Description]   :
+    - 처리 중인 작업자가 끝나기를 기다렸다가 busy를 잡아 둔다. 이후 도착한
+      이벤트는 pending에만 쌓이므로 작업자가 c를 다시 처리하지 않는다.
+    - 소켓을 epoll에서 빼서 이 프로세스에는 더 이상 이벤트가 오지 않게 한다.
+[Input]         :
+    ClientType *c - 클라이언트 (참조를 가진 상태)
+[Output]        : 없음
+[Call By]       : HandOff()
+[Calls]         : usleep(), epoll_ctl()
+[Given]         : Global 변수 Epfd
+[Returns]       : int; 1 잡음, 0 이미 닫힘 (LogOut()이 끝남)
 ==================================================================*/
-void CloseServer(int signo)
+int ClaimClient(ClientType *c)
 {
-	int		i;
+	while (1)  {
+		pthread_mutex_lock(&c->qLock);
+		if (c->sockfd < 0)  {
+			pthread_mutex_unlock(&c->qLock);
+			return 0;
+		}
+		if (! c->busy)
+			break;
+		pthread_mutex_unlock(&c->qLock);
+		usleep(1000);
+	}
+	c->busy = 1;
+	epoll_ctl(Epfd, EPOLL_CTL_DEL, c->sockfd, NULL);
+	pthread_mutex_unlock(&c->qLock);
 
-	close(Sockfd);
+	return 1;
+}
+
+/*===============================================================
+[Function Name] : DeliverRemote(int kind, const char *name, const char *data, int len)
+[Description]   :
+    - 다른 서버 프로세스가 버스에 올린 브로드캐스트 프레임을 이 프로세스의
+      name 방 접속자에게 보낸다. 버스의 칸에서 MsgBuf로 한 번만 복사하고
+      같은 버퍼를 모든 접속자가 공유한다.
+    - 채팅 메시지는 방의 최근 메시지 기록에도 넣는다. 채팅 로그에는
+      메시지를 받은 서버가 이미 남겼으므로 다시 남기지 않는다.
+    - 이 프로세스에 그 방이 없으면 (접속자가 없으면) 버린다.
+[Input]         :
+    int kind         - LG_CHAT 또는 LG_NOTICE
+    const char *name - 방 이름
+    const char *data - 프레임
+    int len          - 프레임 길이
+[Output]        : 없음(단, 접속자의 대기열에 메시지를 넣음)
+[Call By]       : BusThread()
+[Calls]         : rtFind(), GetMembers(), hsPush(), mbAlloc(), EnqueueMessage(),
+                  PutMembers(), mbUnref()
+[Given]         : Global 변수 Rooms, Mutex, Thread-local 변수 St
+[Returns]       : 없음
+==================================================================*/
+void DeliverRemote(int kind, const char *name, const char *data, int len)
+{
+	Room		*room;
+	MsgBuf		*mb;
+	MemberList	*m;
+	int			i;
+
+	if ((mb = mbAlloc()) == NULL)
+		return;
+	memcpy(mb->data, data, len);
+	mb->len = len;
+
+	// 방이 지워지지 않도록 Mutex를 잡은 채로 스냅샷과 기록에 접근
+	pthread_mutex_lock(&Mutex);
+	if ((room = rtFind(&Rooms, name)) == NULL)  {
+		pthread_mutex_unlock(&Mutex);
+		mbUnref(mb);
+		return;
+	}
+	if (kind == LG_CHAT)
+		hsPush(room->history, mb);
+	m = GetMembers(room);
+	pthread_mutex_unlock(&Mutex);
+
+	stAdd(St, ST_BROADCASTS, 1);
+	for (i = 0 ; i < m->n ; i++)
+		EnqueueMessage(m->member[i], mb);
+	PutMembers(m);
+	mbUnref(mb);
+}
+
+/*===============================================================
+[Function Name] : BusThread(void *arg)
+[Description]   :
+    - 공유 메모리 버스의 메시지를 읽어 이 프로세스의 접속자에게 보낸다.
+      읽을 수 있는 메시지를 모두 대기열에 넣은 뒤 한꺼번에 보내고,
+      없으면 버스에서 잠든다.
+    - BusStop이 1이 되면 (StopBus()) 끝난다.
+[Input]         :
+    void *arg    - Worker * (dirty list와 통계 슬롯)
+[Output]        : 없음
+[Call By]       : pthread_create() in main()
+[Calls]         : sbRead(), DeliverRemote(), FlushDirty(), sbWait()
+[Given]         : Global 변수 Bus, BusStop
+[Returns]       : 없음
+==================================================================*/
+void *BusThread(void *arg)
+{
+	char	key[SB_KEY];
+	char	data[MB_DATA_SIZE];
+	int		kind, len;
+
+	Self = arg;
+	St = Self->st;
+	BpSt = &Self->bp;
+
+	while (! atomic_load(&BusStop))  {
+		while ((len = sbRead(&Bus, &kind, key, data, sizeof(data))) > 0)  {
+			stAdd(St, ST_MSG_IN, 1);
+			stAdd(St, ST_BYTES_IN, len);
+			DeliverRemote(kind, key, data, len);
+		}
+		FlushDirty();
+		sbWait(&Bus, BUS_WAIT_MS);
+	}
+
+	return NULL;
+}
 
-	for (i = 0 ; i < MAX_CLIENT ; i++)  {
-		if (Client[i].inUse)  {
-			if (pthread_cancel(Client[i].tid))  {
-				perror("pthread_cancel");
+/*===============================================================
+[Function Name] : StopBus(void)
+[Description]   :
+    - 버스 스레드를 멈추고 끝날 때까지 기다린다. 이후 Bus.cursor는
+      더 바뀌지 않으며 버스를 닫아도 된다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : HandOff(), CloseServer()
+[Calls]         : pthread_join()
+[Given]         : Global 변수 BusStop, BusWorker
+[Returns]       : 없음
+==================================================================*/
+void StopBus(void)
+{
+	atomic_store(&BusStop, 1);
+	pthread_join(BusWorker.tid, NULL);
+}
+
+/*===============================================================
+[Function Name] : HandOff(void)
+[Description]   :
+    - handoff 소켓에 접속한 새 서버에게 이 서버를 넘기고 끝낸다.
+      1. 서버 소켓을 먼저 넘긴다. (이후 접속은 새 서버가 받음)
+      2. 모든 클라이언트를 작업자에게서 잡아 둔다. 다 잡은 뒤에는 아무도
+         메시지를 읽지 않으므로 대기열이 더 늘지 않는다.
+      3. 채팅 로그를 닫아 새 서버가 이어 읽을 수 있게 한다.
+      4. 클라이언트마다 소켓과 uid, 방, 받다 만 프레임, 보내지 못한 데이터를 넘긴다.
+         넘긴 뒤에는 같은 qLock 안에서 closing으로 표시하여, 아직 dirty list에
+         이 클라이언트를 가진 작업자(LogOut()의 알림 등)가 넘긴 데이터를 이 프로세스의
+         fd로 다시 보내거나 shutdown()하지 못하게 한다.
+    - 닫히는 중인 클라이언트(closing)는 넘기지 않는다.
+[Input]         : 없음
+[Output]        : handoff 결과
+[Call By]       : main()
+[Calls]         : accept(), hoSend(), StopBus(), ClientGet(), ClaimClient(), lgClose(),
+                  oqPeek(), ClientUnref(), sbClose(), stPrint()
+[Given]         : Global 변수 HandoffFd, Sockfd, Clients, Mutex, LogDir, Log, BusName, Bus
+[Returns]       : 없음 (넘겨주면 프로그램 종료)
+==================================================================*/
+void HandOff(void)
+{
+	ClientType		**list, *c;
+	HandoffClient	*h;
+	HandoffBus		hb;
+	MsgBuf			*mb;
+	char			*body;
+	int				*ids, sock, id, i, j, nIds = 0, n = 0, sent = 0, len, off;
+
+	if ((sock = accept(HandoffFd, NULL, NULL)) < 0)
+		return;
+	if (hoSend(sock, HO_LISTEN, Sockfd, NULL, 0) < 0)  {
+		perror("handoff");
+		close(sock);
+		return;
+	}
+	printf("Handing off to a new server.....\n");
+
+	// 버스에서 받은 메시지를 모두 대기열에 넣은 뒤 멈춘다 (cursor를 넘김)
+	if (BusName)
+		StopBus();
+
+	// 지금 있는 클라이언트의 참조를 얻어 둔다 (이후 접속은 새 서버가 받음)
+	pthread_mutex_lock(&Mutex);
+	if ((ids = malloc((Clients.nUsed + 1) * sizeof(int))) == NULL ||
+		(list = malloc((Clients.nUsed + 1) * sizeof(ClientType *))) == NULL)  {
+		perror("malloc");
+		exit(1);
+	}
+	CTAB_FOREACH(&Clients, id)
+		ids[nIds++] = id;
+	pthread_mutex_unlock(&Mutex);
+	for (i = 0 ; i < nIds ; i++)  {
+		if ((c = ClientGet(ids[i])) != NULL)
+			list[n++] = c;
+	}
+	for (i = 0 ; i < n ; i++)  {
+		if (! ClaimClient(list[i]))  {
+			ClientUnref(list[i]);
+			list[i] = NULL;
+		}
+	}
+	if (LogDir)
+		lgClose(&Log);
+
+	for (i = 0 ; i < n ; i++)  {
+		if ((c = list[i]) == NULL)
+			continue;
+		pthread_mutex_lock(&c->qLock);
+		if (! c->closing)  {
+			len = sizeof(HandoffClient) + (c->fr.end - c->fr.start);
+			for (j = 0 ; (mb = oqPeek(&c->q, j)) != NULL ; j++)
+				len += mb->len;
+			if ((body = calloc(1, len)) == NULL)  {
+				perror("calloc");
 				exit(1);
 			}
-			if (pthread_join(Client[i].tid, NULL))  {
-				perror("pthread_join");
+			h = (HandoffClient *)body;
+			memcpy(h->uid, c->uid, MAX_ID);
+			if (c->room)
+				memcpy(h->room, c->room->name, MAX_ROOM);
+			h->inLen = c->fr.end - c->fr.start;
+			memcpy(body + sizeof(HandoffClient), c->fr.buf + c->fr.start, h->inLen);
+			off = sizeof(HandoffClient) + h->inLen;
+			for (j = 0 ; (mb = oqPeek(&c->q, j)) != NULL ; j++)  {
+				memcpy(body + off, mb->data + (j ? 0 : c->off), mb->len - (j ? 0 : c->off));
+				off += mb->len - (j ? 0 : c->off);
+			}
+			h->outLen = off - sizeof(HandoffClient) - h->inLen;
+			if (hoSend(sock, HO_CLIENT, c->sockfd, body, off) < 0)  {
+				perror("handoff");
 				exit(1);
 			}
-			close(Client[i].sockfd);
+			free(body);
+			sent++;
 		}
+		c->closing = 1;		// 이제 새 서버가 보냄
+		pthread_mutex_unlock(&c->qLock);
 	}
-	if (pthread_mutex_destroy(&Mutex) < 0)  {
-		perror("pthread_mutex_destroy");
+	hb.cursor = Bus.cursor;
+	hb.self = Bus.self;
+	hoSend(sock, HO_END, -1, &hb, BusName ? sizeof(hb) : 0);
+	close(sock);
+	if (BusName)
+		sbClose(&Bus);		// 새 서버가 이미 열었으므로 버스는 남음
+
+	// 관리 소켓 파일은 새 서버의 것이므로 지우지 않는다
+	printf("Handed off %d clients, exiting.....\n", sent);
+	stPrint(&Stats);
+	exit(0);
+}
+
+/*===============================================================
+[Function Name] : RestoreClient(int fd, char *body, int len)
+[Description]   :
+    - 넘겨받은 클라이언트 소켓과 상태로 클라이언트를 되살린다.
+      방에 다시 넣고(알림 없음), 받다 만 프레임은 재조립 버퍼에,
+      보내지 못한 데이터는 송신 대기열에 넣은 뒤 epoll에 등록한다.
+[Input]         :
+    int fd       - 클라이언트 소켓
+    char *body   - HandoffClient + 받다 만 프레임 + 보내지 못한 데이터
+    int len      - body 길이
+[Output]        : 클라이언트 복구 메시지
+[Call By]       : TakeOver()
+[Calls]         : GetID(), JoinRoom(), frPut(), mbAlloc(), oqPush(), ArmClient()
+[Given]         : 작업자를 만들기 전에 호출
+[Returns]       : 없음
+==================================================================*/
+void RestoreClient(int fd, char *body, int len)
+{
+	HandoffClient	*h = (HandoffClient *)body;
+	ClientType		*c;
+	MsgBuf			*mb;
+	char			*out;
+	int				id, n, off;
+
+	if (len < (int)sizeof(HandoffClient) || h->inLen < 0 || h->outLen < 0 ||
+		len != (int)sizeof(HandoffClient) + h->inLen + h->outLen)  {
+		fprintf(stderr, "handoff: bad client record\n");
+		close(fd);
+		return;
+	}
+	if ((id = GetID(fd)) < 0)  {
+		fprintf(stderr, "Maximum number of clients reached.\n");
+		close(fd);
+		return;
+	}
+	pthread_mutex_lock(&Mutex);
+	c = CLIENT(id);
+	pthread_mutex_unlock(&Mutex);
+
+	memcpy(c->uid, h->uid, MAX_ID);
+	c->uid[MAX_ID - 1] = '\0';
+	h->room[MAX_ROOM - 1] = '\0';
+	if (h->room[0] && JoinRoom(c, h->room) < 0)
+		exit(1);
+	if (frPut(&c->fr, body + sizeof(HandoffClient), h->inLen) < 0)
+		c->closing = 1;
+
+	// 보내지 못한 데이터는 프레임 경계와 상관없이 버퍼 단위로 나누어 넣는다
+	out = body + sizeof(HandoffClient) + h->inLen;
+	for (off = 0 ; off < h->outLen && ! c->closing ; off += n)  {
+		n = h->outLen - off < MB_DATA_SIZE ? h->outLen - off : MB_DATA_SIZE;
+		if (oqIsFull(&c->q) || (mb = mbAlloc()) == NULL)  {
+			c->closing = 1;		// 일부만 보내면 프레임이 깨짐
+			break;
+		}
+		memcpy(mb->data, out + off, n);
+		mb->len = n;
+		oqPush(&c->q, mb);
+		stAdd(St, ST_QUEUED, 1);
+	}
+	if (c->closing)  {
+		// 이어서 보낼 수 없으면 끊는다 (작업자가 log-out 처리)
+		fprintf(stderr, "Client %d (ID: %s): cannot restore state\n", CTAB_SLOT(id), c->uid);
+		shutdown(fd, SHUT_RDWR);
+	}
+	c->blocked = ! oqIsEmpty(&c->q);	// EPOLLOUT을 기다렸다가 이어서 보냄
+	ArmClient(c, EPOLL_CTL_ADD);
+	if (c->room)
+		printf("Client %d resumed (ID: %s).....\n", CTAB_SLOT(id), c->uid);
+	else
+		printf("Client %d resumed (not logged in).....\n", CTAB_SLOT(id));
+}
+
+/*===============================================================
+[Function Name] : TakeOver(const char *path)
+[Description]   :
+    - path에서 실행 중인 서버에 접속하여 서버 소켓과 클라이언트들을 넘겨받는다.
+    - 두 서버가 같은 버스를 쓰면 넘겨준 서버의 버스 위치를 이어받는다.
+[Input]         :
+    const char *path - handoff 소켓 경로
+[Output]        : 넘겨받은 결과
+[Call By]       : main()
+[Calls]         : hoConnect(), hoRecv(), RestoreClient()
+[Given]         : Global 변수 Sockfd, BusName, Bus (버스를 먼저 연 상태)
+[Returns]       : int; 넘겨받은 클라이언트 수, -1: 넘겨줄 서버가 없음
+==================================================================*/
+int TakeOver(const char *path)
+{
+	char	*body;
+	int		sock, type, fd, len, n = 0;
+
+	if ((sock = hoConnect(path)) < 0)
+		return -1;
+	while ((len = hoRecv(sock, &type, &fd, &body)) >= 0 && type != HO_END)  {
+		if (type == HO_LISTEN && fd >= 0)
+			Sockfd = fd;
+		else if (type == HO_CLIENT && fd >= 0)  {
+			RestoreClient(fd, body, len);
+			n++;
+		}
+		else if (fd >= 0)
+			close(fd);
+		free(body);
+	}
+	if (len == sizeof(HandoffBus) && BusName)  {
+		Bus.cursor = ((HandoffBus *)body)->cursor;
+		Bus.self = ((HandoffBus *)body)->self;
+	}
+	free(body);
+	close(sock);
+	if (len < 0)
+		fprintf(stderr, "handoff: connection closed early\n");
+	if (Sockfd < 0)  {
+		fprintf(stderr, "handoff: no listening socket from %s\n", path);
 		exit(1);
 	}
+	printf("Took over from %s: %d clients.....\n", path, n);
+
+	return n;
+}
+
+/*===============================================================
+[Function Name] : CloseServer(int signo)
+[Description]   :
+    - SIGINT(Ctrl+C)/SIGTERM 시그널을 받았을 때, 서버를 안전하게 종료
+    - 시그널 핸들러가 아니라 main 루프에서 signalfd로 받은 뒤 부르므로
+      printf()나 로그의 lock을 써도 된다.
+    - 작업자 스레드는 epoll_wait()에서 대기할 뿐 연결별 자원을 가지지
+      않으므로 취소하지 않고 프로세스와 함께 끝낸다.
+    - 채팅 로그에 남은 레코드는 기록(fdatasync)하고 끝낸다.
+[Input]         :
+    int signo    - 시그널 번호
+[Output]        : 서버 종료 메시지, 스레드별 통계 및 대기열 통계
+[Call By]       : main()
+[Calls]         : close(), StopBus(), sbClose(), stPrint(), stClose(), unlink(), bpSum(), bpPrint(),
+                  lgClose(), lgPrint()
+[Given]         : Global 변수 Sockfd, Stats, HandoffPath, Bp, BpStat, Workers, NWorker, BusWorker,
+                  LogDir, Log, BusName, Bus
+[Returns]       : 없음(프로그램 종료)
+==================================================================*/
+void CloseServer(int signo)
+{
+	BpStats	bp;
+	int		i;
+
+	close(Sockfd);
 
 	printf("\nChat server terminated.....\n");
+	if (BusName)  {
+		StopBus();
+		printf("Bus %s: %ld messages lost (overrun)\n", BusName, Bus.lost);
+		sbClose(&Bus);
+	}
+	stPrint(&Stats);
+	stClose(&Stats);
+	if (HandoffPath)
+		unlink(HandoffPath);
+	// 스레드별 송신 대기열 통계를 합쳐서 출력
+	memset(&bp, 0, sizeof(bp));
+	bpSum(&bp, &BpStat);
+	for (i = 0 ; i < NWorker ; i++)
+		bpSum(&bp, &Workers[i].bp);
+	bpSum(&bp, &BusWorker.bp);
+	bpPrint(&Bp, &bp);
+	if (LogDir)  {
+		lgClose(&Log);
+		lgPrint(&Log);
+	}
 	exit(0);
 }
 
 /*===============================================================
 [Function Name] : main(int argc, char *argv[])
-[Description]   : 
-    - 서버 소켓 생성 및 초기화
-    - 클라이언트 접속을 accept하고, 각 접속마다 스레드를 생성
-    - SIGINT 시그널 처리 설정
-[Input]         : 
-    int argc, char *argv[]  - 프로그램 실행 인자(사용하지 않음)
+[Description]   :
+    - -H 경로에 실행 중인 서버가 있으면 서버 소켓과 접속자를 넘겨받고,
+      없으면 서버 소켓을 새로 만든다.
+    - 채팅 로그가 있으면 읽어 방별 기록을 되살리고 새 세그먼트를 연다.
+    - 작업자 스레드를 nworker개 만들고, 클라이언트 접속을 accept하여
+      epoll에 등록한다. (접속마다 스레드를 만들지 않음)
+    - SIGINT/SIGTERM은 모든 스레드에서 막고 signalfd로 받는다.
+    - 통계 관리 스레드를 먼저 시작하여 모든 스레드가 SIGUSR1을 막도록 한다.
+    - -B가 있으면 버스를 열고 버스 스레드를 만든다. (넘겨받는 경우 버스 위치를
+      이어받아야 하므로 TakeOver() 전에 연다)
+    - main 루프는 서버 소켓, 시그널, handoff 소켓을 poll()로 기다린다.
+[Input]         :
+    int argc, char *argv[]  - -l logdir, -g window, -s path, -H path, -B name, -P port,
+                              backpressure 옵션
+                              (-q, -p, -d; BP_USAGE 참조)과 작업자 수
 [Output]        : 서버 시작 메시지
 [Call By]       : OS
-[Calls]         : GetID(), pthread_create(), ProcessClient(), ...
-[Given]         : Global 변수 Sockfd, Mutex, Client[]
+[Calls]         : sbOpen(), TakeOver(), lgReplay(), lgOpen(), stInit(), stSlot(), stStart(),
+                  hoListen(), BusThread(), signalfd(), poll(), AcceptClients(), HandOff(),
+                  CloseServer(), pthread_sigmask(), pthread_create(), ...
+[Given]         : Global 변수 Sockfd, Epfd, Workers, NWorker, Mutex, Clients, Rooms, Lobby,
+                  LogDir, Log, Stats, HandoffPath, HandoffFd, Port, BusName, Bus, BusWorker
 [Returns]       : int (프로그램 종료 상태)
 ==================================================================*/
 int main(int argc, char *argv[])
 {
-	int					newSockfd, cliAddrLen, id, one = 1;
-	struct sockaddr_in	cliAddr, servAddr;
+	int						i, opt, one = 1, window = LG_WINDOW, sigFd;
+	struct sockaddr_in		servAddr;
+	struct pollfd			pfd[3];
+	struct signalfd_siginfo	si;
+	sigset_t				intr;
+	long					n;
+	char					*statPath = NULL, name[ST_NAME + 16];	// stSlot()이 ST_NAME으로 자름
 
-	signal(SIGINT, CloseServer);
-	if (pthread_mutex_init(&Mutex, NULL) < 0)  {
-		perror("pthread_mutex_init");
+	bpInit(&Bp);
+	while ((opt = getopt(argc, argv, "l:g:s:H:B:P:" BP_OPTS)) != -1)  {
+		if (opt == 'l')
+			LogDir = optarg;
+		else if (opt == 's')
+			statPath = optarg;
+		else if (opt == 'H')
+			HandoffPath = optarg;
+		else if (opt == 'B')
+			BusName = optarg;
+		else if (opt == 'P')  {
+			if ((Port = atoi(optarg)) <= 0 || Port > 65535)
+				break;
+		}
+		else if (opt == 'g')  {
+			if ((window = atoi(optarg)) < 0)
+				break;
+		}
+		else if (bpParseOpt(&Bp, opt, optarg) < 0)
+			break;
+	}
+	NWorker = (optind < argc) ? atoi(argv[optind]) : sysconf(_SC_NPROCESSORS_ONLN);
+	if (opt != -1 || NWorker < 1 || NWorker > MAX_WORKER)  {
+		fprintf(stderr, "Usage: %s [-l logdir] [-g window_ms] [-s admin_socket] [-H handoff_socket] [-B bus_name] [-P port] %s [nworker (1..%d)]\n",
+				argv[0], BP_USAGE, MAX_WORKER);
 		exit(1);
 	}
 
-	if ((Sockfd = socket(PF_INET, SOCK_STREAM, 0)) < 0)  {
-		perror("socket");
+	signal(SIGPIPE, SIG_IGN);
+	if (pthread_mutex_init(&Mutex, NULL) < 0)  {
+		perror("pthread_mutex_init");
 		exit(1);
 	}
-
-	if (setsockopt(Sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)  {
-		perror("setsockopt");
+	if (pthread_mutex_init(&SnapLock, NULL) < 0)  {
+		perror("pthread_mutex_init");
 		exit(1);
 	}
+	ctabInit(&Clients, sizeof(ClientType));
 
-	bzero((char *)&servAddr, sizeof(servAddr));
-	servAddr.sin_family      = PF_INET;
-	servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-	servAddr.sin_port        = htons(SERV_TCP_PORT);
+	// 방 인덱스와 빈 로비
+	rtInit(&Rooms);
+	if ((Lobby = NewRoom(LOBBY)) == NULL)
+		exit(1);
 
-	if (bind(Sockfd, (struct sockaddr *) &servAddr, sizeof(servAddr)) < 0)  {
-		perror("bind");
+	// 작업자 풀: 준비된 클라이언트 소켓은 모두 Epfd 하나로 모인다
+	if ((Epfd = epoll_create1(0)) < 0)  {
+		perror("epoll_create1");
+		exit(1);
+	}
+	// 작업자별 송신 대기열 통계가 cache line을 나눠 쓰지 않도록 정렬
+	if (posix_memalign((void **)&Workers, CACHE_LINE, NWorker * sizeof(Worker)))  {
+		perror("posix_memalign");
 		exit(1);
 	}
+	memset(Workers, 0, NWorker * sizeof(Worker));
+	// 통계 슬롯: 0은 accept하는 main, 1부터 작업자, 마지막은 버스 스레드
+	if (stInit(&Stats, NWorker + 1 + (BusName != NULL)) < 0)
+		exit(1);
+	St = stSlot(&Stats, 0, "main");
+	BpSt = &BpStat;
+	for (i = 0 ; i < NWorker ; i++)  {
+		snprintf(name, sizeof(name), "worker%d", i);
+		Workers[i].st = stSlot(&Stats, i + 1, name);
+	}
+	if (BusName)  {
+		BusWorker.st = stSlot(&Stats, NWorker + 1, "bus");
+		if (sbOpen(&Bus, BusName) < 0)
+			exit(1);
+	}
 
-	listen(Sockfd, 5);
+	// hot restart: 실행 중인 서버의 소켓과 접속자를 넘겨받는다
+	// (넘겨주는 서버가 로그를 닫은 뒤이므로 로그는 그 다음에 읽음)
+	Sockfd = -1;
+	if (HandoffPath)
+		TakeOver(HandoffPath);
 
-	printf("Chat server started.....\n");
+	// 채팅 로그: 지난 기록을 되살리고 새 세그먼트에 이어 쓴다
+	if (LogDir)  {
+		if ((n = lgReplay(LogDir, RestoreRecord, NULL)) < 0)  {
+			perror(LogDir);
+			exit(1);
+		}
+		printf("Restored %ld records from %s, %d rooms.....\n", n, LogDir, Rooms.nRooms);
+	}
 
-	cliAddrLen = sizeof(cliAddr);
-	while (1)  {
-		newSockfd = accept(Sockfd, (struct sockaddr *) &cliAddr, (socklen_t *)&cliAddrLen);
-		if (newSockfd < 0)  {
-			perror("accept");
+	if (Sockfd < 0)  {
+		if ((Sockfd = socket(PF_INET, SOCK_STREAM, 0)) < 0)  {
+			perror("socket");
 			exit(1);
 		}
 
-		id = GetID();
-		if (id < 0) {
-			// 더 이상 클라이언트를 받을 수 없음
-			fprintf(stderr, "Maximum number of clients reached.\n");
-			close(newSockfd);
-			continue;
+		if (setsockopt(Sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)  {
+			perror("setsockopt");
+			exit(1);
 		}
-		Client[id].sockfd = newSockfd;
-		
-		if (pthread_create(&Client[id].tid, NULL, (void *)ProcessClient, (void *)(long)id) < 0)  {
+
+		bzero((char *)&servAddr, sizeof(servAddr));
+		servAddr.sin_family      = PF_INET;
+		servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+		servAddr.sin_port        = htons(Port);
+
+		if (bind(Sockfd, (struct sockaddr *) &servAddr, sizeof(servAddr)) < 0)  {
+			perror("bind");
+			exit(1);
+		}
+
+		listen(Sockfd, SOMAXCONN);
+	}
+	// poll()로 기다리므로 accept()가 블록되지 않게 (넘겨준 서버와 공유되는 플래그)
+	if (SetNonBlocking(Sockfd) < 0)  {
+		perror("fcntl");
+		exit(1);
+	}
+	if (HandoffPath && (HandoffFd = hoListen(HandoffPath)) < 0)
+		exit(1);
+
+	// SIGINT/SIGTERM은 모든 스레드에서 막고 main 루프가 signalfd로 받는다
+	// (이후 만드는 스레드는 막은 상태를 물려받음)
+	sigemptyset(&intr);
+	sigaddset(&intr, SIGINT);
+	sigaddset(&intr, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &intr, NULL);
+	if ((sigFd = signalfd(-1, &intr, SFD_CLOEXEC)) < 0)  {
+		perror("signalfd");
+		exit(1);
+	}
+	if (stStart(&Stats, statPath) < 0)
+		exit(1);
+	if (LogDir && lgOpen(&Log, LogDir, window) < 0)
+		exit(1);
+	for (i = 0 ; i < NWorker ; i++)  {
+		if (pthread_create(&Workers[i].tid, NULL, WorkerThread, &Workers[i]))  {
 			perror("pthread_create");
 			exit(1);
 		}
 	}
+	if (BusName && pthread_create(&BusWorker.tid, NULL, BusThread, &BusWorker))  {
+		perror("pthread_create");
+		exit(1);
+	}
+
+	if (BusName)
+		printf("Chat server started (%d workers, port %d, bus %s).....\n", NWorker, Port, BusName);
+	else
+		printf("Chat server started (%d workers).....\n", NWorker);
+	fflush(stdout);
+
+	pfd[0].fd = Sockfd;
+	pfd[1].fd = sigFd;
+	pfd[2].fd = HandoffFd;		// -1이면 poll()이 무시
+	for (i = 0 ; i < 3 ; i++)
+		pfd[i].events = POLLIN;
+	while (1)  {
+		if (poll(pfd, 3, -1) < 0)  {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			exit(1);
+		}
+		if ((pfd[1].revents & POLLIN) && read(sigFd, &si, sizeof(si)) == sizeof(si))
+			CloseServer(si.ssi_signo);
+		if (pfd[2].revents & POLLIN)
+			HandOff();
+		if ((pfd[0].revents & POLLIN) && AcceptClients() < 0)
+			exit(1);
+	}
 
 	return 0;
 }
-
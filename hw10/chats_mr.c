@@ -0,0 +1,819 @@
+/*===============================================================
+[Program Name] : chats_mr.c (Multi-Reactor Chat Server)
+[Description]  :
+    - N개의 reactor 스레드가 각자 SO_REUSEPORT로 bind한 서버 소켓과
+      epoll 인스턴스를 가지고 클라이언트를 나누어 처리한다.
+      (커널이 새 연결을 reactor들의 서버 소켓에 분산)
+    - 한 reactor에서 받은 메시지는 자기 클라이언트에게 바로 보내고,
+      다른 reactor에는 lock-free mailbox(reactor 쌍마다 SPSC 원형 큐)로
+      MsgBuf를 전달한다. 받는 reactor는 eventfd로 깨어나 mailbox를 비운다.
+[Input]        :
+    [-q hwm] [-p drop-new|drop-oldest|disconnect] [-d deadline_ms] : 송신 대기열 정책
+    [-s path]: 통계를 내보낼 UNIX 도메인 관리 소켓 (SIGUSR1은 항상 stdout에 보고)
+    nreactor : reactor 수 (생략 시 온라인 CPU 수)
+[Output]       :
+    - 각 클라이언트 로그인/로그아웃
+    - 채팅 메시지 송수신
+[Calls]        :
+    int  main(int argc, char *argv[])
+    void *ReactorThread(void *arg)
+    int  OpenListener(void)
+    void AcceptClients(Reactor *r)
+    void ReadClient(Reactor *r, int id)
+    void Broadcast(Reactor *r, int sender, char *msg, int len)
+    void DeliverLocal(Reactor *r, int sender, MsgBuf *mb)
+    void MarkDirty(Reactor *r, int id)
+    int  FlushClient(Reactor *r, int id)
+    void FlushDirty(Reactor *r)
+    int  MboxPush(Mailbox *mbox, MsgBuf *mb)
+    MsgBuf *MboxPop(Mailbox *mbox)
+    void DrainMailboxes(Reactor *r)
+    void CloseClient(Reactor *r, int id)
+    void CloseServer(int signo)
+[특기사항]     :
+    - reactor 하나는 스레드 하나이므로 자기 클라이언트 테이블은 lock 없이 사용
+    - reactor 사이에는 공유 lock이 없고, MsgBuf 참조 카운트만 atomic
+    - 프로토콜은 chats.c/chats_select.c와 같은 길이 접두 프레임
+    - 클라이언트에게 보낼 메시지는 연결별 대기열에 모았다가 tick이
+      끝날 때 연결마다 sendmsg() 한 번으로 보낸다 (chats_select.c와 같음)
+    - 송신 대기열이 high-water mark에 닿으면 backpressure 정책을 적용한다.
+      통계는 reactor마다 따로 센다.
+    - 메시지/바이트/연결 통계는 reactor마다 캐시 라인을 따로 쓰는 슬롯
+      (stats.h)에 세고, SIGUSR1이나 관리 소켓(-s)으로 요청하면 더해서 보고한다.
+==================================================================*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <netinet/in.h>
+#include "chat.h"
+#include "clienttab.h"
+#include "outq.h"
+#include "msgbuf.h"
+#include "backpressure.h"
+#include "frame.h"
+#include "stats.h"
+
+#define MAX_ID           32
+#define MAX_BUF          256
+#define MAX_EVENTS       64
+#define MAX_REACTOR      64
+#define MBOX_SIZE        1024           // reactor 쌍마다의 mailbox 크기 (2의 거듭제곱)
+
+#define LISTEN_KEY       0xffffffffU    // epoll data.u32: 서버 소켓
+#define MBOX_KEY         0xfffffffeU    // epoll data.u32: mailbox eventfd
+
+/*===============================================================
+[Structure]     : Mailbox
+[Description]   :
+    - 한 reactor(생산자)에서 다른 reactor(소비자)로 가는 SPSC 원형 큐
+    - 생산자는 tail만, 소비자는 head만 쓰므로 lock이 필요 없다.
+      head/tail은 서로 다른 캐시 라인에 둔다.
+==================================================================*/
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_uint head;     // 소비자가 다음에 꺼낼 위치
+    _Alignas(CACHE_LINE) atomic_uint tail;     // 생산자가 다음에 넣을 위치
+    _Alignas(CACHE_LINE) MsgBuf     *slot[MBOX_SIZE];
+} Mailbox;
+
+/*===============================================================
+[Structure]     : ClientType
+[Fields]        :
+    int  sockfd     : 클라이언트 소켓 디스크립터
+    int  loggedIn   : 첫 프레임(uid)을 받았는지 여부
+    char uid[MAX_ID]: 클라이언트 ID(문자열)
+    FrameReader fr  : 수신 프레임 재조립 버퍼
+    OutQueue q      : 보낼 MsgBuf 대기열
+    int  off        : 대기열 맨 앞 메시지에서 이미 보낸 바이트 수
+    int  dirty      : 이번 tick에 dirty 목록에 올라가 있는지 여부
+    long stallSince : 대기열이 가득 찬 채로 처음 발견된 시각 (ms)
+    int  blocked    : 송신 버퍼가 가득 참(EAGAIN), 쓰기 가능해질 때까지 보내지 않음
+==================================================================*/
+typedef struct {
+    int         sockfd;
+    int         loggedIn;
+    char        uid[MAX_ID];
+    FrameReader fr;
+    OutQueue    q;
+    int         off;
+    int         dirty;
+    long        stallSince;
+    int         blocked;
+} ClientType;
+
+/*===============================================================
+[Structure]     : Reactor
+[Description]   :
+    - reactor 스레드 하나의 상태. inbox[src]는 src reactor가 이
+      reactor로 보내는 mailbox이다.
+==================================================================*/
+typedef struct {
+    int         idx;
+    pthread_t   tid;
+    int         listenfd;
+    int         epfd;
+    int         evfd;                   // mailbox 도착 알림용 eventfd
+    CTab        clients;
+    Mailbox     *inbox[MAX_REACTOR];
+    int         notify[MAX_REACTOR];    // 이번 tick에 깨워야 할 reactor 표시
+    int         *dirty;                 // 이번 tick에 보낼 메시지가 생긴 클라이언트 id
+    int         nDirty, dirtySize;
+    long        dropped;                // mailbox가 가득 차 버린 메시지 수
+    BpStats     bp;                     // 송신 대기열 깊이/버림 통계
+    StSlot      *st;                    // 이 reactor의 통계 슬롯
+} Reactor;
+
+Reactor *Reactors;
+int      NReactor;
+BpConfig Bp;        // 송신 대기열 정책 (-q, -p, -d)
+StTable  Stats;     // reactor별 통계 (-s, SIGUSR1)
+
+#define CLIENT(r, id)  ((ClientType *)ctabGet(&(r)->clients, (id)))
+
+/*===============================================================
+[Function Name] : MboxPush(Mailbox *mbox, MsgBuf *mb)
+[Description]   :
+    - mailbox에 메시지를 넣는다 (생산자 reactor만 호출)
+[Input]         :
+    Mailbox *mbox - mailbox
+    MsgBuf *mb    - 메시지 (참조가 mailbox로 넘어감)
+[Output]        : 없음
+[Call By]       : Broadcast()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : int (성공 0, 가득 찬 경우 -1)
+==================================================================*/
+int MboxPush(Mailbox *mbox, MsgBuf *mb)
+{
+    unsigned tail = atomic_load_explicit(&mbox->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&mbox->head, memory_order_acquire);
+
+    if (tail - head == MBOX_SIZE)
+        return -1;
+    mbox->slot[tail & (MBOX_SIZE - 1)] = mb;
+    atomic_store_explicit(&mbox->tail, tail + 1, memory_order_release);
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : MboxPop(Mailbox *mbox)
+[Description]   :
+    - mailbox에서 메시지를 꺼낸다 (소비자 reactor만 호출)
+[Input]         :
+    Mailbox *mbox - mailbox
+[Output]        : 없음
+[Call By]       : DrainMailboxes()
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : MsgBuf * (비어 있으면 NULL)
+==================================================================*/
+MsgBuf *MboxPop(Mailbox *mbox)
+{
+    unsigned head = atomic_load_explicit(&mbox->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&mbox->tail, memory_order_acquire);
+    MsgBuf  *mb;
+
+    if (head == tail)
+        return NULL;
+    mb = mbox->slot[head & (MBOX_SIZE - 1)];
+    atomic_store_explicit(&mbox->head, head + 1, memory_order_release);
+    return mb;
+}
+
+/*===============================================================
+[Function Name] : CloseClient(Reactor *r, int id)
+[Description]   :
+    - 클라이언트 소켓을 닫고, 보내지 못한 메시지의 참조를 반납한 뒤
+      테이블 슬롯을 반납
+[Input]         :
+    Reactor *r   - 클라이언트가 속한 reactor
+    int id       - 클라이언트 id
+[Output]        : 로그아웃 메시지
+[Call By]       : ReadClient(), FlushClient(), DeliverLocal(), AcceptClients()
+[Calls]         : epoll_ctl(), close(), frDestroy(), oqPop(), mbUnref(), ctabFree()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void CloseClient(Reactor *r, int id)
+{
+    ClientType *c = CLIENT(r, id);
+    MsgBuf     *mb;
+
+    if (c->loggedIn)
+        printf("[R%d] Client %d (ID: %s) disconnected.\n", r->idx, CTAB_SLOT(id), c->uid);
+    stAdd(r->st, ST_CLOSES, 1);
+    stAdd(r->st, ST_QUEUED, -oqCount(&c->q));
+    epoll_ctl(r->epfd, EPOLL_CTL_DEL, c->sockfd, NULL);
+    close(c->sockfd);
+    frDestroy(&c->fr);
+    while ((mb = oqPop(&c->q)) != NULL)
+        mbUnref(mb);
+    oqDestroy(&c->q);
+    ctabFree(&r->clients, id);
+}
+
+/*===============================================================
+[Function Name] : MarkDirty(Reactor *r, int id)
+[Description]   :
+    - id 클라이언트를 이번 tick이 끝날 때 보낼 목록에 올린다.
+[Input]         :
+    Reactor *r   - reactor
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : DeliverLocal(), ReactorThread()
+[Calls]         : realloc()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void MarkDirty(Reactor *r, int id)
+{
+    ClientType *c = CLIENT(r, id);
+    int        *p;
+
+    if (c->dirty)
+        return;
+    if (r->nDirty == r->dirtySize) {
+        if ((p = realloc(r->dirty, (r->dirtySize ? r->dirtySize * 2 : 256) * sizeof(int))) == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+        r->dirty = p;
+        r->dirtySize = r->dirtySize ? r->dirtySize * 2 : 256;
+    }
+    r->dirty[r->nDirty++] = id;
+    c->dirty = 1;
+}
+
+/*===============================================================
+[Function Name] : FlushClient(Reactor *r, int id)
+[Description]   :
+    - id 클라이언트의 송신 대기열을 sendmsg()로 모아 보낸다.
+    - EAGAIN이면 남은 메시지는 대기열에 두고 EPOLLOUT 때 다시 보내고,
+      그 외 오류는 연결을 끊는다.
+[Input]         :
+    Reactor *r   - reactor
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : FlushDirty(), DeliverLocal()
+[Calls]         : mbSendQueue(), CloseClient()
+[Given]         : 없음
+[Returns]       : int (0: 계속, -1: 연결을 끊음)
+==================================================================*/
+int FlushClient(Reactor *r, int id)
+{
+    ClientType *c = CLIENT(r, id);
+    int         sent;
+    ssize_t     n;
+
+    while (! oqIsEmpty(&c->q)) {
+        sent = oqCount(&c->q);
+        stAdd(r->st, ST_SENDS, 1);
+        if ((n = mbSendQueue(c->sockfd, &c->q, &c->off)) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                c->blocked = 1;
+                break;
+            }
+            CloseClient(r, id);
+            return -1;
+        }
+        sent -= oqCount(&c->q);
+        stAdd(r->st, ST_MSG_OUT, sent);
+        stAdd(r->st, ST_BYTES_OUT, n);
+        stAdd(r->st, ST_QUEUED, -sent);
+    }
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : FlushDirty(Reactor *r)
+[Description]   :
+    - tick이 끝날 때 dirty 목록의 클라이언트들을 한 번씩 보낸다.
+[Input]         :
+    Reactor *r   - reactor
+[Output]        : 없음
+[Call By]       : ReactorThread()
+[Calls]         : FlushClient()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void FlushDirty(Reactor *r)
+{
+    ClientType *c;
+    int         i;
+
+    for (i = 0; i < r->nDirty; i++) {
+        if ((c = CLIENT(r, r->dirty[i])) == NULL)   // 이번 tick에 닫힌 연결
+            continue;
+        c->dirty = 0;
+        FlushClient(r, r->dirty[i]);
+    }
+    r->nDirty = 0;
+}
+
+/*===============================================================
+[Function Name] : DeliverLocal(Reactor *r, int sender, MsgBuf *mb)
+[Description]   :
+    - reactor r에 붙은 클라이언트들(sender 제외)의 송신 대기열에 프레임을
+      넣는다. tick 도중에 대기열이 차면 먼저 보내 보고, 그래도 가득 찬
+      클라이언트는 backpressure 정책에 따라
+      메시지를 버리거나, deadline이 지나면 연결을 끊는다.
+[Input]         :
+    Reactor *r   - reactor
+    int sender   - 보낸 클라이언트 id (다른 reactor에서 온 경우 -1)
+    MsgBuf *mb   - 프레임
+[Output]        : 없음
+[Call By]       : Broadcast(), DrainMailboxes()
+[Calls]         : FlushClient(), mbRef(), bpEnqueue(), MarkDirty(), CloseClient()
+[Given]         : 전역변수 Bp
+[Returns]       : 없음
+==================================================================*/
+void DeliverLocal(Reactor *r, int sender, MsgBuf *mb)
+{
+    ClientType *c;
+    int         i, ret, before;
+
+    CTAB_FOREACH(&r->clients, i) {
+        c = CLIENT(r, i);
+        if (i == sender || ! c->loggedIn)
+            continue;
+        // 한 tick에 메시지가 많이 들어와 대기열이 찼으면 먼저 보내 본다
+        if (oqIsFull(&c->q) && ! c->blocked && FlushClient(r, i) < 0)
+            continue;
+        mbRef(mb);
+        before = oqCount(&c->q);
+        ret = bpEnqueue(&Bp, &r->bp, &c->q, c->off > 0, &c->stallSince, mb);
+        // 넣었는데 깊이가 그대로면 drop-oldest로 하나를 버린 것
+        if (ret != BP_QUEUED || oqCount(&c->q) == before)
+            stAdd(r->st, ST_DROPS, 1);
+        stAdd(r->st, ST_QUEUED, oqCount(&c->q) - before);
+        if (ret == BP_QUEUED) {
+            MarkDirty(r, i);
+        }
+        else if (ret == BP_EVICT) {
+            printf("[R%d] Client %d (ID: %s) evicted: send queue full for %d ms\n",
+                   r->idx, CTAB_SLOT(i), c->uid, Bp.deadlineMs);
+            CloseClient(r, i);
+        }
+    }
+}
+
+/*===============================================================
+[Function Name] : Broadcast(Reactor *r, int sender, char *msg, int len)
+[Description]   :
+    - "uid> msg" 프레임을 MsgBuf에 한 번 만들어 자기 클라이언트에게
+      보내고, 다른 모든 reactor의 mailbox에 같은 버퍼를 넣는다.
+[Input]         :
+    Reactor *r   - 메시지를 받은 reactor
+    int sender   - 보낸 클라이언트 id
+    char *msg    - payload
+    int len      - payload 길이
+[Output]        : 없음
+[Call By]       : ReadClient()
+[Calls]         : mbAlloc(), mbRef(), mbUnref(), DeliverLocal(), MboxPush()
+[Given]         : 전역변수 Reactors, NReactor
+[Returns]       : 없음
+==================================================================*/
+void Broadcast(Reactor *r, int sender, char *msg, int len)
+{
+    MsgBuf *mb;
+    int     i, plen;
+
+    if ((mb = mbAlloc()) == NULL)
+        return;
+    if (len > MAX_BUF)
+        len = MAX_BUF;
+    plen = snprintf(mb->data + FRAME_HDR, MB_DATA_SIZE - FRAME_HDR, "%s> %.*s",
+                    CLIENT(r, sender)->uid, len, msg);
+    if (plen > MB_DATA_SIZE - FRAME_HDR - 1)
+        plen = MB_DATA_SIZE - FRAME_HDR - 1;
+    FRAME_PUT_LEN(mb->data, plen);
+    mb->len = FRAME_HDR + plen;
+    stAdd(r->st, ST_BROADCASTS, 1);
+
+    DeliverLocal(r, sender, mb);
+
+    for (i = 0; i < NReactor; i++) {
+        if (i == r->idx)
+            continue;
+        mbRef(mb);
+        if (MboxPush(Reactors[i].inbox[r->idx], mb) < 0) {
+            mbUnref(mb);
+            r->dropped++;
+            stAdd(r->st, ST_DROPS, 1);
+            continue;
+        }
+        r->notify[i] = 1;
+    }
+    mbUnref(mb);
+}
+
+/*===============================================================
+[Function Name] : DrainMailboxes(Reactor *r)
+[Description]   :
+    - eventfd 카운터를 비우고 모든 inbox의 메시지를 자기 클라이언트에게 전달
+[Input]         :
+    Reactor *r   - reactor
+[Output]        : 없음
+[Call By]       : ReactorThread()
+[Calls]         : read(), MboxPop(), DeliverLocal(), mbUnref()
+[Given]         : 전역변수 NReactor
+[Returns]       : 없음
+==================================================================*/
+void DrainMailboxes(Reactor *r)
+{
+    uint64_t cnt;
+    MsgBuf  *mb;
+    int      i;
+
+    while (read(r->evfd, &cnt, sizeof(cnt)) > 0)
+        ;
+    for (i = 0; i < NReactor; i++) {
+        if (i == r->idx)
+            continue;
+        while ((mb = MboxPop(r->inbox[i])) != NULL) {
+            DeliverLocal(r, -1, mb);
+            mbUnref(mb);
+        }
+    }
+}
+
+/*===============================================================
+[Function Name] : OpenListener(void)
+[Description]   :
+    - SO_REUSEADDR, SO_REUSEPORT를 설정한 non-blocking 서버 소켓을 만든다.
+      reactor마다 하나씩 같은 포트에 bind한다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : main()
+[Calls]         : socket(), setsockopt(), bind(), listen(), fcntl()
+[Given]         : 없음
+[Returns]       : int (서버 소켓)
+==================================================================*/
+int OpenListener(void)
+{
+    struct sockaddr_in servAddr;
+    int                fd, one = 1;
+
+    if ((fd = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0) {
+        perror("socket");
+        exit(1);
+    }
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        perror("setsockopt");
+        exit(1);
+    }
+
+    bzero((char *)&servAddr, sizeof(servAddr));
+    servAddr.sin_family      = PF_INET;
+    servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    servAddr.sin_port        = htons(SERV_TCP_PORT);
+
+    if (bind(fd, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0) {
+        perror("bind");
+        exit(1);
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        perror("listen");
+        exit(1);
+    }
+    return fd;
+}
+
+/*===============================================================
+[Function Name] : AcceptClients(Reactor *r)
+[Description]   :
+    - 서버 소켓에 대기 중인 연결을 EAGAIN까지 모두 accept하여
+      non-blocking으로 epoll에 등록 (uid는 첫 프레임이 오면 처리)
+[Input]         :
+    Reactor *r   - reactor
+[Output]        : 없음
+[Call By]       : ReactorThread()
+[Calls]         : accept4(), ctabAlloc(), frInit(), oqInit(), epoll_ctl()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void AcceptClients(Reactor *r)
+{
+    struct epoll_event ev;
+    ClientType        *c;
+    int                fd, id;
+
+    while (1) {
+        if ((fd = accept4(r->listenfd, NULL, NULL, SOCK_NONBLOCK)) < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("accept4");
+            return;
+        }
+        stAdd(r->st, ST_ACCEPTS, 1);
+        if ((id = ctabAlloc(&r->clients)) < 0) {
+            close(fd);
+            continue;
+        }
+        c = CLIENT(r, id);
+        c->sockfd = fd;
+        if (frInit(&c->fr, FRAME_BUF) < 0) {
+            close(fd);
+            ctabFree(&r->clients, id);
+            continue;
+        }
+        if (oqInit(&c->q, Bp.hwm) < 0) {
+            close(fd);
+            frDestroy(&c->fr);
+            ctabFree(&r->clients, id);
+            continue;
+        }
+        ev.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u32 = id;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            CloseClient(r, id);
+        }
+    }
+}
+
+/*===============================================================
+[Function Name] : ReadClient(Reactor *r, int id)
+[Description]   :
+    - EAGAIN까지 읽으면서 완성된 프레임을 처리. 첫 프레임은 uid,
+      그 다음부터는 브로드캐스트할 메시지.
+[Input]         :
+    Reactor *r   - reactor
+    int id       - 클라이언트 id
+[Output]        : 로그인 메시지
+[Call By]       : ReactorThread()
+[Calls]         : frRead(), frNext(), Broadcast(), CloseClient()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void ReadClient(Reactor *r, int id)
+{
+    ClientType *c = CLIENT(r, id);
+    char       *p;
+    int         n, len;
+
+    while (1) {
+        stAdd(r->st, ST_RECVS, 1);
+        n = frRead(&c->fr, c->sockfd);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (n <= 0) {
+            CloseClient(r, id);
+            return;
+        }
+        stAdd(r->st, ST_BYTES_IN, n);
+
+        while ((n = frNext(&c->fr, &p, &len)) > 0) {
+            stAdd(r->st, ST_MSG_IN, 1);
+            if (! c->loggedIn) {
+                if (len > MAX_ID - 1)
+                    len = MAX_ID - 1;
+                memcpy(c->uid, p, len);
+                c->uid[len] = '\0';
+                c->loggedIn = 1;
+                printf("[R%d] Client %d connected with ID: %s\n", r->idx, CTAB_SLOT(id), c->uid);
+                continue;
+            }
+            Broadcast(r, id, p, len);
+        }
+        if (n < 0) {
+            CloseClient(r, id);
+            return;
+        }
+    }
+}
+
+/*===============================================================
+[Function Name] : *ReactorThread(void *arg)
+[Description]   :
+    - reactor 하나의 이벤트 루프. 한 tick(epoll_wait 한 번) 동안
+      mailbox에 넣은 reactor들은 tick이 끝날 때 한 번씩만 eventfd로 깨우고,
+      자기 클라이언트의 송신 대기열도 tick이 끝날 때 한 번에 보낸다.
+[Input]         :
+    void *arg    - Reactor *
+[Output]        : 없음
+[Call By]       : pthread_create() in main()
+[Calls]         : epoll_wait(), AcceptClients(), ReadClient(), DrainMailboxes(),
+                  MarkDirty(), FlushDirty(), write()
+[Given]         : 전역변수 Reactors, NReactor
+[Returns]       : 없음(무한 루프)
+==================================================================*/
+void *ReactorThread(void *arg)
+{
+    Reactor           *r = arg;
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t           one = 1;
+    cpu_set_t          cpus;
+    ClientType        *c;
+    int                nev, e, i;
+
+    // reactor i를 CPU (i % CPU 수)에 고정
+    CPU_ZERO(&cpus);
+    CPU_SET(r->idx % sysconf(_SC_NPROCESSORS_ONLN), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+    while (1) {
+        if ((nev = epoll_wait(r->epfd, events, MAX_EVENTS, -1)) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            exit(1);
+        }
+
+        for (e = 0; e < nev; e++) {
+            if (events[e].data.u32 == LISTEN_KEY)
+                AcceptClients(r);
+            else if (events[e].data.u32 == MBOX_KEY)
+                DrainMailboxes(r);
+            else if ((c = CLIENT(r, events[e].data.u32)) != NULL) {
+                if (events[e].events & EPOLLOUT) {
+                    c->blocked = 0;
+                    if (! oqIsEmpty(&c->q))
+                        MarkDirty(r, events[e].data.u32);
+                }
+                if (events[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                    ReadClient(r, events[e].data.u32);
+            }
+        }
+
+        FlushDirty(r);
+
+        for (i = 0; i < NReactor; i++) {
+            if (r->notify[i]) {
+                r->notify[i] = 0;
+                write(Reactors[i].evfd, &one, sizeof(one));
+            }
+        }
+    }
+    return NULL;
+}
+
+/*===============================================================
+[Function Name] : CloseServer(int signo)
+[Description]   :
+    - SIGINT(Ctrl + C)/SIGTERM 발생 시 reactor별 통계와 mailbox/대기열 통계를 출력하고 종료
+    - 시그널 핸들러가 아니라 main이 signalfd로 받은 뒤 부르므로 stPrint()의
+      lock이나 printf()를 써도 된다. (핸들러에서 부르면 통계 스레드가 잡은
+      슬롯 lock과 교착될 수 있음)
+[Input]         :
+    int signo    - 시그널 번호
+[Output]        : 서버 종료 메시지
+[Call By]       : main()
+[Calls]         : stPrint(), stClose(), bpPrint(), exit()
+[Given]         : 전역변수 Reactors, NReactor, Bp, Stats
+[Returns]       : 없음(프로그램 종료)
+==================================================================*/
+void CloseServer(int signo)
+{
+    int i;
+
+    printf("\nTerminating server...\n");
+    stPrint(&Stats);
+    stClose(&Stats);
+    for (i = 0; i < NReactor; i++) {
+        printf("  reactor %d: %ld mailbox drops\n", i, Reactors[i].dropped);
+        bpPrint(&Bp, &Reactors[i].bp);
+    }
+    exit(0);
+}
+
+/*===============================================================
+[Function Name] : main(int argc, char *argv[])
+[Description]   :
+    - reactor 수만큼 서버 소켓/epoll/eventfd/mailbox를 만들고
+      reactor 스레드를 시작
+[Input]         :
+    int argc, char *argv[] - -s path, backpressure 옵션 (BP_USAGE), 그 뒤에 reactor 수 (선택)
+[Output]        : 서버 시작 메시지
+[Call By]       : OS
+[Calls]         : bpParseOpt(), stInit(), stSlot(), stStart(), OpenListener(),
+                  epoll_create1(), eventfd(), pthread_sigmask(), signalfd(), pthread_create(),
+                  CloseServer()
+[Given]         : 전역변수 Reactors, NReactor, Bp, Stats
+[Returns]       : int (프로그램 종료 상태)
+==================================================================*/
+int main(int argc, char *argv[])
+{
+    struct epoll_event ev;
+    struct signalfd_siginfo si;
+    sigset_t           intr;
+    Reactor           *r;
+    void              *p;
+    char              *statPath = NULL, name[ST_NAME + 16];  // stSlot()이 ST_NAME으로 자름
+    int                i, j, opt, sigFd;
+
+    bpInit(&Bp);
+    while ((opt = getopt(argc, argv, "s:" BP_OPTS)) != -1) {
+        if (opt == 's')
+            statPath = optarg;
+        else if (bpParseOpt(&Bp, opt, optarg) < 0)
+            break;
+    }
+    NReactor = (optind < argc) ? atoi(argv[optind]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (opt != -1 || NReactor < 1 || NReactor > MAX_REACTOR) {
+        fprintf(stderr, "Usage: %s [-s admin_socket] %s [nreactor (1..%d)]\n",
+                argv[0], BP_USAGE, MAX_REACTOR);
+        exit(1);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    // SIGINT/SIGTERM은 모든 스레드에서 막고 main이 signalfd로 받는다
+    // (이후 만드는 통계/reactor 스레드는 막은 상태를 물려받음)
+    sigemptyset(&intr);
+    sigaddset(&intr, SIGINT);
+    sigaddset(&intr, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &intr, NULL);
+    if ((sigFd = signalfd(-1, &intr, SFD_CLOEXEC)) < 0) {
+        perror("signalfd");
+        exit(1);
+    }
+
+    if ((Reactors = calloc(NReactor, sizeof(Reactor))) == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    // reactor 스레드를 만들기 전에 시작해야 모두 SIGUSR1을 막은 상태가 됨
+    if (stInit(&Stats, NReactor) < 0)
+        exit(1);
+    for (i = 0; i < NReactor; i++) {
+        snprintf(name, sizeof(name), "reactor%d", i);
+        Reactors[i].st = stSlot(&Stats, i, name);
+    }
+    if (stStart(&Stats, statPath) < 0)
+        exit(1);
+
+    for (i = 0; i < NReactor; i++) {
+        r = &Reactors[i];
+        r->idx = i;
+        ctabInit(&r->clients, sizeof(ClientType));
+        r->listenfd = OpenListener();
+        if ((r->epfd = epoll_create1(0)) < 0 ||
+            (r->evfd = eventfd(0, EFD_NONBLOCK)) < 0) {
+            perror("epoll_create1/eventfd");
+            exit(1);
+        }
+        for (j = 0; j < NReactor; j++) {
+            if (j == i)
+                continue;
+            if (posix_memalign(&p, CACHE_LINE, sizeof(Mailbox))) {
+                perror("posix_memalign");
+                exit(1);
+            }
+            memset(p, 0, sizeof(Mailbox));
+            r->inbox[j] = p;
+        }
+
+        ev.events   = EPOLLIN | EPOLLET;
+        ev.data.u32 = LISTEN_KEY;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->listenfd, &ev) < 0) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+        ev.events   = EPOLLIN | EPOLLET;
+        ev.data.u32 = MBOX_KEY;
+        if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, r->evfd, &ev) < 0) {
+            perror("epoll_ctl");
+            exit(1);
+        }
+    }
+
+    printf("Multi-reactor Chat Server started (%d reactors)...\n", NReactor);
+    fflush(stdout);
+
+    for (i = 0; i < NReactor; i++) {
+        if (pthread_create(&Reactors[i].tid, NULL, ReactorThread, &Reactors[i])) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+    // reactor는 끝나지 않으므로 main은 종료 시그널만 기다림
+    while (read(sigFd, &si, sizeof(si)) != sizeof(si)) {
+        if (errno != EINTR) {
+            perror("read");
+            exit(1);
+        }
+    }
+    CloseServer(si.ssi_signo);
+
+    return 0;
+}
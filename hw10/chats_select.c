@@ -1,19 +1,53 @@
 /*===============================================================
 [Program Name] : chats_select.c
-[Description]  : 
-    - 다중 클라이언트 연결을 select()를 통해 하나의 프로세스/스레드에서 처리.
+[Description]  :
+    - 다중 클라이언트 연결을 하나의 프로세스/스레드에서 처리.
+    - 기본 빌드는 epoll(edge-triggered, non-blocking 소켓) 이벤트 루프를 사용하고,
+      -DUSE_SELECT로 빌드하면 기존 select() 루프를 사용한다.
     - 클라이언트에게서 받은 메시지를 다른 클라이언트들에게 브로드캐스트.
 [Input]        :
-    (코드 내 SERV_TCP_PORT 사용 / 별도 인자 없음)
+    (코드 내 SERV_TCP_PORT 사용)
+    -q hwm, -p drop-new|drop-oldest|disconnect, -d deadline_ms : 송신 대기열 정책
+    -u : io_uring 엔진 사용 (커널이 지원하지 않으면 epoll로 대체)
+    -t login_ms : 접속 후 uid 프레임을 보내야 하는 시간 (기본 LOGIN_MS)
+    -i idle_ms  : 로그인 후 이 시간 동안 아무것도 보내지 않으면 끊음 (기본 0: 끄기)
 [Output]       :
     - 각 클라이언트 로그인/로그아웃
     - 채팅 메시지 송수신
-[Calls]        : 
+[Calls]        :
     int main(int argc, char *argv[])
-    void BroadcastMessage(int sender, char *msg)
+    void BroadcastMessage(int sender, char *msg, int len)
+    void MarkDirty(int id)
+    int  FlushClient(int id)
+    void FlushDirty(void)
     void CloseServer(int signo)
+    int  AcceptClient(int newSockfd)
+    void Login(int id, char *p, int len)
+    int  HandleFrames(int id)
+    void ClientTimeout(TwTimer *t, void *arg)
+    void CloseClient(int id)
+    void SelectLoop(void)            (USE_SELECT)
+    void EpollLoop(void)             (default)
+    int  UringLoop(void)             (default, -u)
 [특기사항]     :
-    - 스레드 사용 없이 select()로 I/O multiplexing
+    - 스레드 사용 없이 select()/epoll로 I/O multiplexing
+    - 메시지는 길이 접두 프레임(frame.h)으로 주고받으며, 연결마다
+      재조립 버퍼를 두어 한 번 읽은 데이터의 프레임을 모두 처리한다.
+    - 연결은 상태(CS_HANDSHAKE → CS_LOGGEDIN → CS_CLOSING)를 가지고,
+      uid 프레임도 이벤트 루프에서 받으므로 accept 후에 기다리지 않는다.
+      login_ms 안에 uid를 보내지 않은 연결과 idle_ms 동안 조용한 연결은
+      계층형 타이머 휠(timerwheel.h)이 끊는다. 이벤트 루프는 다음 만료
+      시각까지만 기다린다.
+    - epoll 루프는 깨어날 때마다 준비된 fd만 처리하므로 비용이 O(ready fds)
+    - 브로드캐스트는 메시지를 연결별 송신 대기열에 넣기만 하고, 한 tick
+      (select/epoll_wait 한 번) 동안 쌓인 메시지는 tick이 끝날 때 연결마다
+      sendmsg() 한 번으로 모아 보낸다. 시스템 콜 수는 Stats에 센다.
+    - 송신 대기열이 high-water mark에 닿으면 backpressure 정책(backpressure.h)을
+      적용하므로 읽지 않는 클라이언트 하나가 메모리를 계속 늘리지 못한다.
+    - -u로 실행하면 io_uring(uring.h)으로 accept/recv/send를 처리한다.
+      multishot accept, provided buffer ring을 쓰는 multishot recv,
+      IOSQE_IO_LINK로 묶은 sendmsg를 사용하므로 tick마다 시스템 콜은
+      io_uring_enter() 한 번이다.
     - SIGINT(Ctrl + C)로 서버 종료
 ==================================================================*/
 
@@ -23,173 +57,947 @@
 #include <strings.h>
 #include <unistd.h>
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <stdint.h>
+#ifndef USE_SELECT
+#include <sys/epoll.h>
+#endif
 #include "chat.h"
+#include "clienttab.h"
+#include "frame.h"
+#include "outq.h"
+#include "msgbuf.h"
+#include "backpressure.h"
+#include "timerwheel.h"
+#ifndef USE_SELECT
+#include "uring.h"
+#endif
 
 
-#define MAX_CLIENT       5
 #define MAX_ID           32
 #define MAX_BUF          256
+#define LOGIN_MS         5000          // 기본 로그인 제한 시간
+
+// 연결 상태
+#define CS_HANDSHAKE     0             // 접속함, uid 프레임을 기다리는 중 (ctabAlloc()이 0으로 채움)
+#define CS_LOGGEDIN      1             // 채팅 중
+#define CS_CLOSING       2             // 끊는 중 (io_uring 작업이 끝나기를 기다림)
+#define TICK_MS          10            // 타이머 휠 tick (만료 시각의 정밀도)
+
+#ifndef USE_SELECT
+#define MAX_EVENTS       64
+#define LISTEN_KEY       0xffffffffU   // epoll data.u32: 서버 소켓 표시
+
+#define UR_ENTRIES       256           // SQ 크기
+#define UR_NBUFS         256           // provided buffer 개수 (2의 거듭제곱)
+#define UR_BUF_SIZE      4096          // provided buffer 하나의 크기
+#define UR_BGID          0             // recv가 쓰는 버퍼 그룹
+#define UR_LINK          4             // 한 번에 링크로 묶는 sendmsg 수
+
+// user_data 상위 32비트: 작업 종류, 하위 32비트: 클라이언트 id
+#define UR_ACCEPT        1
+#define UR_RECV          2
+#define UR_SEND          3
+#define UR_TIMER         4
+#define UR_PROBE         5
+#define UR_TIMER_UPD     6
+#define UR_DATA(op, id)  (((uint64_t)(op) << 32) | (uint32_t)(id))
+
+/*===============================================================
+[Structure]     : UrTx
+[Description]   :
+    - io_uring으로 보내는 중인 sendmsg들의 msghdr/iovec
+      (완료될 때까지 커널이 참조하므로 연결마다 따로 둔다)
+==================================================================*/
+typedef struct {
+    struct msghdr msg[UR_LINK];
+    struct iovec  iov[UR_LINK][MB_IOV_MAX];
+} UrTx;
+
+/*===============================================================
+[Structure]     : UrEvent
+[Description]   :
+    - tick 도중에 거둔 뒤 나중에 처리할 완료 (cqe의 사본)
+==================================================================*/
+typedef struct {
+    uint64_t    data;
+    int         res;
+    unsigned    flags;
+} UrEvent;
+#endif
 
 /*===============================================================
 [Structure]     : ClientType
-[Description]   : 
+[Description]   :
     - 클라이언트 상태 정보를 저장하기 위한 구조체
+    - 사용 여부는 클라이언트 테이블(CTab)이 관리
 [Fields]        :
     int  sockfd     : 클라이언트 소켓 디스크립터
-    int  inUse      : 사용 여부(0: 미사용, 1: 사용)
     char uid[MAX_ID]: 클라이언트 ID(문자열)
+    FrameReader fr  : 수신 프레임 재조립 버퍼
+    OutQueue q      : 보낼 MsgBuf 대기열
+    int  off        : 대기열 맨 앞 메시지에서 이미 보낸 바이트 수
+    int  dirty      : 이번 tick에 Dirty 목록에 올라가 있는지 여부
+    long stallSince : 대기열이 가득 찬 채로 처음 발견된 시각 (ms)
+    int  blocked    : 송신 버퍼가 가득 참(EAGAIN), 쓰기 가능해질 때까지 보내지 않음
+    int  state      : 연결 상태 (CS_HANDSHAKE, CS_LOGGEDIN, CS_CLOSING)
+    TwTimer timer   : 로그인 제한 시간 / idle 타이머 (상태에 따라)
+    (io_uring 엔진)
+    int  ops        : 완료되지 않은 io_uring 작업 수 (multishot recv + sendmsg)
+    int  sending    : 완료되지 않은 sendmsg 수 (링크 하나)
+    int  inflight   : 대기열 앞에서 커널에 넘긴 메시지 수
+    UrTx *tx        : 보내는 중인 msghdr/iovec (처음 보낼 때 할당)
 ==================================================================*/
 typedef struct {
-    int  sockfd;    
-    int  inUse;     
-    char uid[MAX_ID];
+    int         sockfd;
+    char        uid[MAX_ID];
+    FrameReader fr;
+    OutQueue    q;
+    int         off;
+    int         dirty;
+    long        stallSince;
+    int         blocked;
+    int         state;
+    TwTimer     timer;
+#ifndef USE_SELECT
+    int         ops;
+    int         sending;
+    int         inflight;
+    UrTx       *tx;
+#endif
 } ClientType;
 
-ClientType Client[MAX_CLIENT];
+/*===============================================================
+[Structure]     : Stats
+[Description]   :
+    - 송수신 시스템 콜 및 메시지 수 (서버 종료 시 출력)
+==================================================================*/
+typedef struct {
+    long        reads;      // recv() 호출 수
+    long        sends;      // sendmsg() 호출 수
+    long        delivered;  // 보낸 메시지 수
+    long        enters;     // io_uring_enter() 호출 수 (io_uring 엔진)
+} Stats;
+
+CTab       Clients; // 클라이언트 테이블 (세대 태그 id로 접근)
 int        Sockfd;  // 서버 소켓 식별자
+#ifndef USE_SELECT
+int        Epfd;    // epoll 인스턴스 식별자
+int        UringOn; // io_uring 엔진 사용 중 (-u)
+Uring      Ur;      // io_uring 인스턴스
+UrBufRing  RecvBufs;// multishot recv용 provided buffer ring
+UrEvent   *Stash;   // UrReap()이 거둔 뒤 아직 처리하지 않은 완료
+struct __kernel_timespec UrTs;  // 걸려 있는 IORING_OP_TIMEOUT의 시간
+int        UrTimerOn;           // IORING_OP_TIMEOUT이 걸려 있는지 여부
+long       UrTimerAt;           // 걸려 있는 IORING_OP_TIMEOUT의 만료 시각 (twNow())
+int        NStash, StashHead, StashSize;
+#endif
+int       *Dirty;   // 이번 tick에 보낼 메시지가 생긴 클라이언트 id 목록
+int        NDirty, DirtySize;
+Stats      Stat;
+BpConfig   Bp;      // 송신 대기열 정책 (-q, -p, -d)
+BpStats    BpStat;  // 송신 대기열 깊이/버림 통계
+TimerWheel Timers;  // 연결별 타이머 (로그인 제한 시간, idle)
+int        LoginMs = LOGIN_MS;
+int        IdleMs;  // 0이면 idle 연결을 끊지 않음
+
+#define CLIENT(id)  ((ClientType *)ctabGet(&Clients, (id)))
+
+/*===============================================================
+[Function Name] : CloseClient(int id)
+[Description]   :
+    - id 클라이언트의 소켓을 닫고 테이블 슬롯을 free list로 반납
+    - epoll 빌드에서는 관심 목록에서도 제거
+    - 보내지 못한 메시지의 참조를 반납 (Dirty 목록에 남은 id는
+      세대 태그 때문에 FlushDirty()에서 걸러진다)
+    - 걸려 있는 타이머를 취소한다.
+    - io_uring 엔진에서 커널에 넘긴 작업이 남아 있으면 CS_CLOSING으로
+      바꾸고 shutdown()으로 작업들을 끝내기만 하며, 마지막 완료에서
+      다시 호출되어 닫는다.
+      (그 전에 슬롯을 반납하면 커널이 아직 쓰는 버퍼를 재사용하게 됨)
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : FlushClient(), HandleFrames(), SelectLoop(), EpollLoop(), UringLoop()
+[Calls]         : twDel(), epoll_ctl(), shutdown(), close(), frDestroy(), oqPop(),
+                  mbUnref(), ctabFree()
+[Given]         : 전역변수 Clients, Timers, Epfd, UringOn
+[Returns]       : 없음
+==================================================================*/
+void CloseClient(int id)
+{
+    ClientType *c = CLIENT(id);
+    MsgBuf     *mb;
+
+    twDel(&Timers, &c->timer);
+#ifndef USE_SELECT
+    if (UringOn && c->ops > 0) {
+        if (c->state != CS_CLOSING) {
+            c->state = CS_CLOSING;
+            shutdown(c->sockfd, SHUT_RDWR);
+        }
+        return;
+    }
+    if (! UringOn)
+        epoll_ctl(Epfd, EPOLL_CTL_DEL, c->sockfd, NULL);
+    free(c->tx);
+#endif
+    close(c->sockfd);
+    frDestroy(&c->fr);
+    while ((mb = oqPop(&c->q)) != NULL)
+        mbUnref(mb);
+    oqDestroy(&c->q);
+    ctabFree(&Clients, id);
+}
+
+/*===============================================================
+[Function Name] : MarkDirty(int id)
+[Description]   :
+    - id 클라이언트를 이번 tick이 끝날 때 보낼 목록(Dirty)에 올린다.
+      이미 올라가 있으면 아무것도 하지 않는다.
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : BroadcastMessage(), SelectLoop(), EpollLoop()
+[Calls]         : realloc()
+[Given]         : 전역변수 Dirty, NDirty, DirtySize
+[Returns]       : 없음
+==================================================================*/
+void MarkDirty(int id)
+{
+    ClientType *c = CLIENT(id);
+    int        *p;
+
+    if (c->dirty)
+        return;
+    if (NDirty == DirtySize) {
+        if ((p = realloc(Dirty, (DirtySize ? DirtySize * 2 : 256) * sizeof(int))) == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+        Dirty = p;
+        DirtySize = DirtySize ? DirtySize * 2 : 256;
+    }
+    Dirty[NDirty++] = id;
+    c->dirty = 1;
+}
+
+#ifndef USE_SELECT
+/*===============================================================
+[Function Name] : UrSqe(void)
+[Description]   :
+    - 빈 SQE를 하나 얻는다. SQ가 가득 차 있으면 채운 SQE를 먼저
+      제출하여 자리를 만든다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : UrArmAccept(), UrArmRecv(), UrFlush()
+[Calls]         : urGetSqe(), urSubmit()
+[Given]         : 전역변수 Ur, Stat
+[Returns]       : struct io_uring_sqe * (0으로 채워짐)
+==================================================================*/
+struct io_uring_sqe *UrSqe(void)
+{
+    struct io_uring_sqe *sqe;
+
+    while ((sqe = urGetSqe(&Ur)) == NULL) {
+        Stat.enters++;
+        if (urSubmit(&Ur, 0) < 0 && errno != EINTR) {
+            perror("io_uring_enter");
+            exit(1);
+        }
+    }
+    return sqe;
+}
+
+/*===============================================================
+[Function Name] : UrArmTimer(int ms)
+[Description]   :
+    - ms 뒤에 완료되는 IORING_OP_TIMEOUT을 건다. 타이머가 있는
+      동안 io_uring_enter()가 다음 만료 시각에 돌아오게 하는 용도.
+[Input]         :
+    int ms       - 기다릴 시간 (ms)
+[Output]        : 없음
+[Call By]       : UringLoop()
+[Calls]         : UrSqe(), twNow()
+[Given]         : 전역변수 UrTs, UrTimerOn, UrTimerAt
+[Returns]       : 없음
+==================================================================*/
+void UrArmTimer(int ms)
+{
+    struct io_uring_sqe *sqe = UrSqe();
+
+    UrTs.tv_sec  = ms / 1000;
+    UrTs.tv_nsec = (ms % 1000) * 1000000L;
+    sqe->opcode    = IORING_OP_TIMEOUT;
+    sqe->addr      = (unsigned long)&UrTs;
+    sqe->len       = 1;
+    sqe->user_data = UR_DATA(UR_TIMER, 0);
+    UrTimerOn = 1;
+    UrTimerAt = twNow() + ms;
+}
+
+/*===============================================================
+[Function Name] : UrUpdateTimer(int ms)
+[Description]   :
+    - 걸려 있는 IORING_OP_TIMEOUT을 ms 뒤로 당긴다. (IORING_TIMEOUT_UPDATE)
+      더 이른 타이머(예: 로그인 제한 시간)가 나중에 추가되었을 때,
+      조용한 서버에서 먼저 걸린 긴 timeout이 끝날 때까지 만료가
+      늦어지지 않도록 하는 용도.
+    - 이미 완료된 timeout이면 -ENOENT로 끝나며, 그 완료를 처리한 뒤
+      UringLoop()이 새로 건다.
+[Input]         :
+    int ms       - 기다릴 시간 (ms)
+[Output]        : 없음
+[Call By]       : UringLoop()
+[Calls]         : UrSqe(), twNow()
+[Given]         : 전역변수 UrTs, UrTimerAt
+[Returns]       : 없음
+==================================================================*/
+void UrUpdateTimer(int ms)
+{
+    struct io_uring_sqe *sqe = UrSqe();
+
+    UrTs.tv_sec  = ms / 1000;
+    UrTs.tv_nsec = (ms % 1000) * 1000000L;
+    sqe->opcode        = IORING_OP_TIMEOUT_REMOVE;
+    sqe->addr          = UR_DATA(UR_TIMER, 0);     // 바꿀 timeout의 user_data
+    sqe->addr2         = (unsigned long)&UrTs;
+    sqe->timeout_flags = IORING_TIMEOUT_UPDATE;
+    sqe->user_data     = UR_DATA(UR_TIMER_UPD, 0);
+    UrTimerAt = twNow() + ms;
+}
+
+/*===============================================================
+[Function Name] : UrOpDone(int id)
+[Description]   :
+    - id 클라이언트의 io_uring 작업 하나가 끝났음을 기록하고,
+      끊는 중이던 연결의 마지막 작업이면 연결을 닫는다.
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : UrRecvDone(), UrSendDone()
+[Calls]         : CloseClient()
+[Given]         : 전역변수 Clients
+[Returns]       : 없음
+==================================================================*/
+void UrOpDone(int id)
+{
+    ClientType *c = CLIENT(id);
+
+    if (--c->ops == 0 && c->state == CS_CLOSING)
+        CloseClient(id);
+}
+
+/*===============================================================
+[Function Name] : UrSendDone(int id, int res)
+[Description]   :
+    - 링크된 sendmsg 하나의 완료 처리. 보낸 바이트만큼 대기열에서
+      메시지를 꺼내고, 링크가 모두 끝나면 남은 메시지를 다시 Dirty에 올린다.
+    - 앞의 sendmsg가 실패해서 취소된 것(-ECANCELED)은 무시하고,
+      그 외 오류는 연결을 끊는다.
+[Input]         :
+    int id       - 클라이언트 id
+    int res      - cqe->res (보낸 바이트 수 또는 -errno)
+[Output]        : 없음
+[Call By]       : UringLoop()
+[Calls]         : oqPeek(), oqPop(), mbUnref(), MarkDirty(), CloseClient(), UrOpDone()
+[Given]         : 전역변수 Clients, Stat
+[Returns]       : 없음
+==================================================================*/
+void UrSendDone(int id, int res)
+{
+    ClientType *c = CLIENT(id);
+    MsgBuf     *mb;
+    long        left;
+
+    if (res >= 0) {
+        // 다 보낸 메시지를 꺼낸다 (off는 첫 메시지의 시작부터 센다)
+        left = res + c->off;
+        while ((mb = oqPeek(&c->q, 0)) != NULL && left >= mb->len) {
+            left -= mb->len;
+            mbUnref(oqPop(&c->q));
+            c->inflight--;
+            Stat.delivered++;
+        }
+        c->off = left;
+    }
+    else if (res != -ECANCELED && c->state != CS_CLOSING) {
+        errno = -res;
+        perror("sendmsg");
+        CloseClient(id);
+    }
+
+    if (--c->sending == 0) {
+        c->inflight = 0;
+        c->blocked  = 0;
+        if (c->state != CS_CLOSING && ! oqIsEmpty(&c->q))
+            MarkDirty(id);
+    }
+    UrOpDone(id);
+}
+
+/*===============================================================
+[Function Name] : UrReap(void)
+[Description]   :
+    - tick 도중에 채운 SQE를 제출하고 이미 올라온 완료를 거둔다.
+      (기다리지 않음) sendmsg 완료는 바로 처리하여 대기열 자리를
+      만들고, 나머지 완료는 Stash에 순서대로 두었다가 UringLoop()가
+      링보다 먼저 처리한다. (같은 연결의 recv 순서가 바뀌지 않도록)
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : UrFlush()
+[Calls]         : urSubmit(), urPeekCqe(), urCqeSeen(), realloc(), UrSendDone()
+[Given]         : 전역변수 Ur, Stash, NStash, StashSize, Stat
+[Returns]       : 없음
+==================================================================*/
+void UrReap(void)
+{
+    struct io_uring_cqe *cqe;
+    UrEvent             *p, e;
+
+    Stat.enters++;
+    if (urSubmit(&Ur, 0) < 0 && errno != EINTR) {
+        perror("io_uring_enter");
+        exit(1);
+    }
+    while ((cqe = urPeekCqe(&Ur)) != NULL) {
+        e.data  = cqe->user_data;
+        e.res   = cqe->res;
+        e.flags = cqe->flags;
+        urCqeSeen(&Ur);
+
+        if ((e.data >> 32) == UR_SEND) {
+            UrSendDone((uint32_t)e.data, e.res);
+            continue;
+        }
+        if (NStash == StashSize) {
+            if ((p = realloc(Stash, (StashSize ? StashSize * 2 : 64) * sizeof(UrEvent))) == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+            Stash = p;
+            StashSize = StashSize ? StashSize * 2 : 64;
+        }
+        Stash[NStash++] = e;
+    }
+}
 
 /*===============================================================
-[Function Name] : BroadcastMessage(int sender, char *msg)
-[Description]   : 
-    - sender 클라이언트가 보낸 메시지를 모든 다른 클라이언트에게 전송
-[Input]         : 
-    int sender   - 메시지를 보낸 클라이언트 인덱스
-    char *msg    - 전송할 메시지
-[Output]        : 해당 메시지를 다른 클라이언트에게 send
-[Call By]       : main() 루프 내에서 recv() 후 호출
-[Calls]         : send()
-[Given]         : 전역변수 Client[]
+[Function Name] : UrSendQueue(int id)
+[Description]   :
+    - UrFlush()의 본체. 보내는 중인 링크가 없을 때 대기열 앞에서부터
+      링크된 sendmsg SQE들을 만든다.
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : UrFlush()
+[Calls]         : malloc(), oqPeek(), urSqSpace(), urSubmit(), UrSqe(), CloseClient()
+[Given]         : 전역변수 Ur, Stat
+[Returns]       : int (0: 계속, -1: 연결을 끊음)
+==================================================================*/
+int UrSendQueue(int id)
+{
+    ClientType          *c = CLIENT(id);
+    struct io_uring_sqe *sqe;
+    MsgBuf              *mb;
+    int                  k, cnt, idx, nlink;
+
+    if ((nlink = (oqCount(&c->q) + MB_IOV_MAX - 1) / MB_IOV_MAX) == 0)
+        return 0;
+    if (nlink > UR_LINK)
+        nlink = UR_LINK;
+    if (c->tx == NULL && (c->tx = malloc(sizeof(UrTx))) == NULL) {
+        perror("malloc");
+        CloseClient(id);
+        return -1;
+    }
+
+    // 링크 중간에 SQ가 모자라 따로 제출되면 안 되므로 먼저 자리를 확인
+    if (urSqSpace(&Ur) < (unsigned)nlink) {
+        Stat.enters++;
+        if (urSubmit(&Ur, 0) < 0 && errno != EINTR) {
+            perror("io_uring_enter");
+            exit(1);
+        }
+    }
+
+    idx = 0;
+    for (k = 0; k < nlink; k++) {
+        for (cnt = 0; cnt < MB_IOV_MAX && (mb = oqPeek(&c->q, idx)) != NULL; cnt++, idx++) {
+            c->tx->iov[k][cnt].iov_base = mb->data;
+            c->tx->iov[k][cnt].iov_len  = mb->len;
+        }
+        memset(&c->tx->msg[k], 0, sizeof(struct msghdr));
+        c->tx->msg[k].msg_iov    = c->tx->iov[k];
+        c->tx->msg[k].msg_iovlen = cnt;
+
+        sqe = UrSqe();
+        sqe->opcode     = IORING_OP_SENDMSG;
+        sqe->fd         = c->sockfd;
+        sqe->addr       = (unsigned long)&c->tx->msg[k];
+        sqe->msg_flags  = MSG_NOSIGNAL | MSG_WAITALL;
+        sqe->user_data  = UR_DATA(UR_SEND, id);
+        if (k < nlink - 1)
+            sqe->flags  = IOSQE_IO_LINK;
+        Stat.sends++;
+    }
+    // 첫 메시지에서 이미 보낸 부분은 건너뜀
+    c->tx->iov[0][0].iov_base = (char *)c->tx->iov[0][0].iov_base + c->off;
+    c->tx->iov[0][0].iov_len -= c->off;
+
+    c->inflight = idx;
+    c->sending  = nlink;
+    c->ops     += nlink;
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : UrFlush(int id)
+[Description]   :
+    - io_uring 엔진의 FlushClient(). 송신 대기열을 MB_IOV_MAX개씩
+      sendmsg SQE로 만들어 최대 UR_LINK개를 IOSQE_IO_LINK로 묶는다.
+      링크된 sendmsg는 순서대로 실행되므로 바이트 순서가 섞이지 않고,
+      하나가 실패하면 뒤의 것들은 -ECANCELED로 끝난다.
+    - MSG_WAITALL이므로 커널이 송신 버퍼가 빌 때마다 나머지를 보내고,
+      완료는 다 보냈거나 실패했을 때 온다. (EAGAIN 처리 없음)
+    - 앞의 링크가 끝나지 않았으면 아무것도 하지 않는다. 남은 메시지는
+      UrSendDone()이 마지막 완료에서 다시 Dirty에 올린다.
+    - 보낸 메시지는 완료될 때까지 대기열에 남겨 두고 inflight로 센다.
+      그래서 tick 도중에 대기열이 가득 차면(BroadcastMessage()) tick이
+      끝날 때까지 기다리지 않고 UrReap()으로 바로 제출하고 완료를 거둔다.
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : FlushClient()
+[Calls]         : UrSendQueue(), UrReap()
+[Given]         : 전역변수 Clients
+[Returns]       : int (0: 계속, -1: 연결을 끊음)
+==================================================================*/
+int UrFlush(int id)
+{
+    ClientType *c = CLIENT(id);
+    int         tries;
+
+    if (c->state == CS_CLOSING)
+        return 0;
+    if (oqIsFull(&c->q)) {
+        // 보내는 중인 링크를 제출해 완료를 거두고, 끝났으면 다음 링크도
+        for (tries = 0; tries < 2; tries++) {
+            if (c->sending == 0 && UrSendQueue(id) < 0)
+                return -1;
+            UrReap();
+            if ((c = CLIENT(id)) == NULL || c->state == CS_CLOSING)
+                return -1;
+            if (c->sending > 0) {
+                c->blocked = 1;     // 송신 버퍼가 가득 참: 링크가 끝날 때까지 다시 거두지 않음
+                break;
+            }
+        }
+        return 0;
+    }
+    if (c->sending > 0)
+        return 0;
+    return UrSendQueue(id);
+}
+#endif
+
+/*===============================================================
+[Function Name] : FlushClient(int id)
+[Description]   :
+    - id 클라이언트의 송신 대기열을 sendmsg()로 모아 보낸다.
+    - 송신 버퍼가 가득 차면(EAGAIN) 남은 메시지는 대기열에 두고
+      쓰기 가능해질 때 다시 보낸다. 그 외 오류는 연결을 끊는다.
+    - io_uring 엔진에서는 UrFlush()로 넘긴다.
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : FlushDirty(), BroadcastMessage(), SelectLoop()
+[Calls]         : mbSendQueue(), CloseClient(), UrFlush()
+[Given]         : 전역변수 Stat, UringOn
+[Returns]       : int (0: 계속, -1: 연결을 끊음)
+==================================================================*/
+int FlushClient(int id)
+{
+    ClientType *c = CLIENT(id);
+    int         before;
+
+#ifndef USE_SELECT
+    if (UringOn)
+        return UrFlush(id);
+#endif
+    while (! oqIsEmpty(&c->q)) {
+        before = oqCount(&c->q);
+        Stat.sends++;
+        if (mbSendQueue(c->sockfd, &c->q, &c->off) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                c->blocked = 1;
+                break;
+            }
+            perror("sendmsg");
+            CloseClient(id);
+            return -1;
+        }
+        Stat.delivered += before - oqCount(&c->q);
+    }
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : FlushDirty(void)
+[Description]   :
+    - tick이 끝날 때 Dirty 목록의 클라이언트들을 한 번씩 보낸다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : SelectLoop(), EpollLoop()
+[Calls]         : FlushClient()
+[Given]         : 전역변수 Dirty, NDirty
 [Returns]       : 없음
 ==================================================================*/
-void BroadcastMessage(int sender, char *msg)
+void FlushDirty(void)
 {
-    char buf[MAX_BUF + MAX_ID];
+    ClientType *c;
+    int         i;
 
-    // "ID> 메시지" 형태로 만들기
-    sprintf(buf, "%s> %s", Client[sender].uid, msg);
+    for (i = 0; i < NDirty; i++) {
+        if ((c = CLIENT(Dirty[i])) == NULL || c->state == CS_CLOSING)  // 이번 tick에 닫힌 연결
+            continue;
+        c->dirty = 0;
+        FlushClient(Dirty[i]);
+    }
+    NDirty = 0;
+}
+
+/*===============================================================
+[Function Name] : BroadcastMessage(int sender, char *msg, int len)
+[Description]   :
+    - sender 클라이언트가 보낸 메시지를 로그인한 다른 클라이언트의 송신
+      대기열에 넣는다. 실제 전송은 tick이 끝날 때 FlushDirty()가 한다.
+    - tick 도중에 대기열이 가득 차면 tick이 끝나기 전에 먼저 보내 보고,
+      그래도 가득 찬(느린) 클라이언트는 backpressure 정책에 따라
+      메시지를 버리거나, deadline이 지나면 연결을 끊는다.
+[Input]         :
+    int sender   - 메시지를 보낸 클라이언트 id
+    char *msg    - 전송할 메시지 payload
+    int len      - payload 길이
+[Output]        : 없음
+[Call By]       : HandleFrames()
+[Calls]         : mbAlloc(), mbRef(), mbUnref(), FlushClient(), bpEnqueue(), MarkDirty(),
+                  CloseClient()
+[Given]         : 전역변수 Clients, Bp, BpStat
+[Returns]       : 없음
+==================================================================*/
+void BroadcastMessage(int sender, char *msg, int len)
+{
+    ClientType *c;
+    MsgBuf     *mb;
+    int         i, r, plen;
 
-    for (int i = 0; i < MAX_CLIENT; i++) {
-        if (Client[i].inUse && (i != sender)) {
-            if (send(Client[i].sockfd, buf, strlen(buf)+1, 0) < 0) {
-                perror("send");
-                close(Client[i].sockfd);
-                Client[i].inUse = 0;
+    // "ID> 메시지" 프레임을 한 번만 만들고 길이도 한 번만 계산
+    if ((mb = mbAlloc()) == NULL)
+        return;
+    if (len > MAX_BUF)
+        len = MAX_BUF;
+    plen = snprintf(mb->data + FRAME_HDR, MB_DATA_SIZE - FRAME_HDR, "%s> %.*s", CLIENT(sender)->uid, len, msg);
+    if (plen > MB_DATA_SIZE - FRAME_HDR - 1)
+        plen = MB_DATA_SIZE - FRAME_HDR - 1;
+    FRAME_PUT_LEN(mb->data, plen);
+    mb->len = FRAME_HDR + plen;
+
+    CTAB_FOREACH(&Clients, i) {
+        if (i != sender) {
+            c = CLIENT(i);
+            if (c->state != CS_LOGGEDIN)            // 로그인 전이거나 끊는 중
+                continue;
+            // 한 tick에 메시지가 많이 들어와 대기열이 찼으면 먼저 보내 본다
+            if (oqIsFull(&c->q) && ! c->blocked && FlushClient(i) < 0)
+                continue;
+            mbRef(mb);
+            // 보내는 중인 맨 앞 메시지(off > 0)와 커널에 넘긴 메시지는 버리지 않는다
+#ifndef USE_SELECT
+            r = bpEnqueue(&Bp, &BpStat, &c->q, c->inflight ? c->inflight : c->off > 0,
+                          &c->stallSince, mb);
+#else
+            r = bpEnqueue(&Bp, &BpStat, &c->q, c->off > 0, &c->stallSince, mb);
+#endif
+            if (r == BP_QUEUED) {
+                MarkDirty(i);
+            }
+            else if (r == BP_EVICT) {
+                printf("Client %d (ID: %s) evicted: send queue full for %d ms\n",
+                       CTAB_SLOT(i), c->uid, Bp.deadlineMs);
+                CloseClient(i);
             }
         }
     }
+    mbUnref(mb);
 }
 
 /*===============================================================
 [Function Name] : CloseServer(int signo)
-[Description]   : 
-    - SIGINT(Ctrl + C) 발생 시 서버 소켓 및 모든 클라이언트 소켓을 닫고 종료
-[Input]         : 
+[Description]   :
+    - SIGINT(Ctrl + C) 발생 시 송수신 통계를 출력하고
+      서버 소켓 및 모든 클라이언트 소켓을 닫고 종료
+[Input]         :
     int signo    - 시그널 번호
-[Output]        : 서버 종료 메시지
+[Output]        : 서버 종료 메시지, 시스템 콜 통계
 [Call By]       : signal(SIGINT, CloseServer)
 [Calls]         : close()
-[Given]         : 전역변수 Sockfd, Client[]
+[Given]         : 전역변수 Sockfd, Clients, Stat, Bp, BpStat
 [Returns]       : 없음(프로그램 종료)
 ==================================================================*/
 void CloseServer(int signo)
 {
+    int i;
+
     printf("\nTerminating server...\n");
+    printf("  recv calls: %ld, sendmsg calls: %ld, delivered: %ld (%.1f msgs/sendmsg)\n",
+           Stat.reads, Stat.sends, Stat.delivered,
+           Stat.sends ? (double)Stat.delivered / Stat.sends : 0.0);
+#ifndef USE_SELECT
+    if (UringOn)
+        printf("  io_uring_enter calls: %ld\n", Stat.enters);
+#endif
+    bpPrint(&Bp, &BpStat);
     close(Sockfd);
 
-    for (int i = 0; i < MAX_CLIENT; i++) {
-        if (Client[i].inUse) {
-            close(Client[i].sockfd);
-        }
+    CTAB_FOREACH(&Clients, i) {
+        close(CLIENT(i)->sockfd);
     }
+#ifndef USE_SELECT
+    close(Epfd);
+#endif
     exit(0);
 }
 
 /*===============================================================
-[Function Name] : main(int argc, char *argv[])
-[Description]   : 
-    - 서버 소켓 생성, bind, listen 후 select()를 사용해 
-      여러 클라이언트를 동시에 처리.
-    - 새 클라이언트 접속 시 uid를 수신해 Client 배열에 저장.
-    - 메시지 수신 시 BroadcastMessage() 통해 다른 클라이언트에게 전송.
-[Input]         : 
-    int argc, char *argv[] - (사용 안 함)
-[Output]        : 
-    - 서버 시작/종료 메시지, 클라이언트 연결/메시지
-[Call By]       : OS
-[Calls]         : 
-    CloseServer(), BroadcastMessage(), select(), accept(), recv(), send()
-[Given]         : 전역변수 Sockfd, Client[]
-[Returns]       : int (프로그램 종료 상태)
+[Function Name] : ClientTimeout(TwTimer *t, void *arg)
+[Description]   :
+    - 연결 타이머가 만료되었을 때 타이머 휠이 부르는 콜백.
+      CS_HANDSHAKE이면 로그인 제한 시간, CS_LOGGEDIN이면 idle 시간이
+      지난 것이므로 연결을 끊는다.
+[Input]         :
+    TwTimer *t   - 만료된 타이머 (ClientType.timer)
+    void *arg    - 클라이언트 id
+[Output]        : 시간 초과 메시지
+[Call By]       : twAdvance()
+[Calls]         : CloseClient()
+[Given]         : 전역변수 Clients, LoginMs, IdleMs
+[Returns]       : 없음
 ==================================================================*/
-int main(int argc, char *argv[])
+void ClientTimeout(TwTimer *t, void *arg)
 {
-    struct sockaddr_in servAddr, cliAddr;
-    socklen_t          cliAddrLen;
-    int                newSockfd, maxFd, n;
-    fd_set             readFds;
-    char               buf[MAX_BUF];
+    int         id = (int)(intptr_t)arg;
+    ClientType *c = CLIENT(id);
 
-    signal(SIGINT, CloseServer);
+    if (c->state == CS_HANDSHAKE)
+        printf("Client %d: no login within %d ms, closing\n", CTAB_SLOT(id), LoginMs);
+    else
+        printf("Client %d (ID: %s): idle for %d ms, closing\n", CTAB_SLOT(id), c->uid, IdleMs);
+    CloseClient(id);
+}
 
-    // 서버 소켓 생성
-    if ((Sockfd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
-        perror("socket");
-        exit(1);
-    }
+/*===============================================================
+[Function Name] : AcceptClient(int newSockfd)
+[Description]   :
+    - 새로 접속한 클라이언트에게 free list에서 빈 슬롯을 O(1)에 할당하고
+      CS_HANDSHAKE 상태로 로그인 제한 시간 타이머를 건다.
+    - uid는 여기서 기다리지 않고 이벤트 루프가 첫 프레임으로 받는다.
+      (uid를 보내지 않는 클라이언트가 서버를 멈추지 못함)
+    - 테이블을 더 늘릴 수 없으면 "Server is full" 메시지를 보내고 연결을 끊는다.
+      select 빌드에서는 fd가 FD_SETSIZE 이상이어도 fd_set에 넣을 수 없으므로
+      같이 끊는다.
+[Input]         :
+    int newSockfd - accept()로 얻은 클라이언트 소켓
+[Output]        : 없음
+[Call By]       : SelectLoop(), EpollLoop(), UringLoop()
+[Calls]         : ctabAlloc(), ctabFree(), frInit(), frDestroy(), oqInit(), twSet(), twAdd(),
+                  frameWrite(), close()
+[Given]         : 전역변수 Clients, Bp, Timers, LoginMs
+[Returns]       : int (할당된 id, 실패 시 -1)
+==================================================================*/
+int AcceptClient(int newSockfd)
+{
+    ClientType *c;
+    int         id = -1;
 
-    int one = 1;
-    if (setsockopt(Sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) {
-        perror("setsockopt");
-        exit(1);
+#ifdef USE_SELECT
+    // FD_SET()은 FD_SETSIZE 이상의 fd를 fd_set 밖에 씀
+    if (newSockfd < FD_SETSIZE)
+#endif
+        id = ctabAlloc(&Clients);
+    if (id >= 0) {
+        c = CLIENT(id);
+        c->sockfd = newSockfd;
+        if (frInit(&c->fr, FRAME_BUF) < 0) {
+            close(newSockfd);
+            ctabFree(&Clients, id);
+            return -1;
+        }
+        if (oqInit(&c->q, Bp.hwm) < 0) {
+            close(newSockfd);
+            frDestroy(&c->fr);
+            ctabFree(&Clients, id);
+            return -1;
+        }
+        c->state = CS_HANDSHAKE;
+        twSet(&c->timer, ClientTimeout, (void *)(intptr_t)id);
+        twAdd(&Timers, &c->timer, LoginMs);
+        return id;
     }
 
-    bzero((char *)&servAddr, sizeof(servAddr));
-    servAddr.sin_family      = PF_INET;
-    servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servAddr.sin_port        = htons(SERV_TCP_PORT);
+    // 자리가 없는 경우
+    char *msg = "Server is full\n";
+    frameWrite(newSockfd, msg, strlen(msg));
+    close(newSockfd);
+    return -1;
+}
 
-    if (bind(Sockfd, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0) {
-        perror("bind");
-        exit(1);
-    }
+/*===============================================================
+[Function Name] : Login(int id, char *p, int len)
+[Description]   :
+    - CS_HANDSHAKE 상태에서 받은 첫 프레임을 uid로 저장하고
+      로그인 타이머를 취소한 뒤 CS_LOGGEDIN으로 바꾼다.
+      (idle 타이머는 HandleFrames()가 건다)
+[Input]         :
+    int id       - 클라이언트 id
+    char *p      - uid 프레임 payload
+    int len      - payload 길이
+[Output]        : 접속 메시지
+[Call By]       : HandleFrames()
+[Calls]         : twDel()
+[Given]         : 전역변수 Clients, Timers
+[Returns]       : 없음
+==================================================================*/
+void Login(int id, char *p, int len)
+{
+    ClientType *c = CLIENT(id);
 
-    if (listen(Sockfd, 5) < 0) {
-        perror("listen");
-        exit(1);
-    }
+    if (len > MAX_ID - 1)
+        len = MAX_ID - 1;
+    memcpy(c->uid, p, len);
+    c->uid[len] = '\0';
+    twDel(&Timers, &c->timer);
+    c->state = CS_LOGGEDIN;
+    printf("Client %d connected with ID: %s\n", CTAB_SLOT(id), c->uid);
+}
 
-    printf("Select-based Chat Server started...\n");
+/*===============================================================
+[Function Name] : HandleFrames(int id)
+[Description]   :
+    - id 클라이언트의 재조립 버퍼에 들어 있는 완성된 프레임을 모두
+      꺼내 브로드캐스트. 잘못된 프레임(FRAME_MAX 초과)이면 연결을 끊는다.
+    - CS_HANDSHAKE 상태의 첫 프레임은 uid이므로 Login()으로 넘긴다.
+    - -i가 있으면 로그인한 연결의 idle 타이머를 다시 건다. (O(1))
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 수신 메시지(디버그)
+[Call By]       : SelectLoop(), EpollLoop(), UrRecvDone()
+[Calls]         : frNext(), Login(), BroadcastMessage(), CloseClient(), twAdd()
+[Given]         : 전역변수 Clients, Timers, IdleMs
+[Returns]       : int (0: 계속, -1: 연결을 끊음)
+==================================================================*/
+int HandleFrames(int id)
+{
+    ClientType *c = CLIENT(id);
+    char       *p;
+    int         r, len;
+
+    while ((r = frNext(&c->fr, &p, &len)) > 0) {
+        if (c->state == CS_HANDSHAKE) {
+            Login(id, p, len);
+            continue;
+        }
 
-    // Client[] 배열 초기화
-    for(int i = 0; i < MAX_CLIENT; i++) {
-        Client[i].sockfd = -1;
-        Client[i].inUse  = 0;
-        memset(Client[i].uid, 0, MAX_ID);
+        // 디버그: 서버가 받은 내용을 확인
+        printf("[DEBUG] Received from client %d (%s): %.*s\n", CTAB_SLOT(id), c->uid, len, p);
+
+        // 받은 메시지 브로드캐스트
+        BroadcastMessage(id, p, len);
+    }
+    if (r < 0) {
+        fprintf(stderr, "Client %d (ID: %s): invalid frame\n", CTAB_SLOT(id), c->uid);
+        CloseClient(id);
+        return -1;
     }
+    if (IdleMs > 0 && c->state == CS_LOGGEDIN)
+        twAdd(&Timers, &c->timer, IdleMs);
+    return 0;
+}
+
+/*===============================================================
+[Function Name] : SetNonBlocking(int fd)
+[Description]   :
+    - fd에 O_NONBLOCK 플래그를 설정 (edge-triggered epoll, 그리고 송신
+      대기열을 보내다 느린 클라이언트에게 블록되지 않기 위해 필요)
+[Input]         :
+    int fd       - 파일 디스크립터
+[Output]        : 없음
+[Call By]       : main(), SelectLoop(), EpollLoop()
+[Calls]         : fcntl()
+[Given]         : 없음
+[Returns]       : int (성공 0, 실패 -1)
+==================================================================*/
+int SetNonBlocking(int fd)
+{
+    int flags;
+
+    if ((flags = fcntl(fd, F_GETFL, 0)) < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+#ifdef USE_SELECT
+/*===============================================================
+[Function Name] : SelectLoop(void)
+[Description]   :
+    - 매 반복마다 fd_set을 다시 만들고 select()로 대기하는 기존 루프
+    - 송신 대기열에 남은 메시지가 있는 연결은 쓰기 가능도 기다린다.
+    - 타이머가 걸려 있으면 다음 만료 시각까지만 기다린다.
+    - epoll 루프와 비교하기 위한 빌드 옵션(-DUSE_SELECT)
+[Input]         : 없음
+[Output]        : 클라이언트 연결/메시지
+[Call By]       : main()
+[Calls]         : select(), accept(), frRead(), AcceptClient(), SetNonBlocking(),
+                  HandleFrames(), FlushClient(), FlushDirty(), twTimeout(&Timers), twAdvance(&Timers)
+[Given]         : 전역변수 Sockfd, Clients, Stat
+[Returns]       : 없음(무한 루프)
+==================================================================*/
+void SelectLoop(void)
+{
+    struct sockaddr_in cliAddr;
+    socklen_t          cliAddrLen;
+    int                newSockfd, maxFd, n, i, wait;
+    fd_set             readFds, writeFds;
+    struct timeval     tv;
 
-    // 메인 루프
     while (1) {
         FD_ZERO(&readFds);
+        FD_ZERO(&writeFds);
         FD_SET(Sockfd, &readFds);
 
         // 가장 큰 파일 디스크립터 번호 찾기
         maxFd = Sockfd;
 
         // 사용 중인 클라이언트 소켓을 readFds에 추가 & maxFd 갱신
-        for(int i = 0; i < MAX_CLIENT; i++) {
-            if (Client[i].inUse) {
-                FD_SET(Client[i].sockfd, &readFds);
-                if (Client[i].sockfd > maxFd)
-                    maxFd = Client[i].sockfd;
-            }
+        CTAB_FOREACH(&Clients, i) {
+            FD_SET(CLIENT(i)->sockfd, &readFds);
+            if (! oqIsEmpty(&CLIENT(i)->q))
+                FD_SET(CLIENT(i)->sockfd, &writeFds);
+            if (CLIENT(i)->sockfd > maxFd)
+                maxFd = CLIENT(i)->sockfd;
         }
 
-        // select() 대기
-        int sel = select(maxFd + 1, &readFds, NULL, NULL, NULL);
+        // select() 대기 (타이머가 있으면 다음 만료 시각까지)
+        if ((wait = twTimeout(&Timers)) >= 0) {
+            tv.tv_sec  = wait / 1000;
+            tv.tv_usec = (wait % 1000) * 1000;
+        }
+        int sel = select(maxFd + 1, &readFds, &writeFds, NULL, wait >= 0 ? &tv : NULL);
         if (sel < 0) {
             perror("select");
             exit(1);
@@ -203,57 +1011,546 @@ int main(int argc, char *argv[])
                 perror("accept");
                 continue;
             }
+            if ((i = AcceptClient(newSockfd)) >= 0 && SetNonBlocking(newSockfd) < 0) {
+                perror("fcntl");
+                CloseClient(i);
+            }
+        }
+
+        // 2) 기존 클라이언트 소켓에서의 데이터 수신
+        CTAB_FOREACH(&Clients, i) {
+            if (FD_ISSET(CLIENT(i)->sockfd, &writeFds)) {
+                // 지난 tick에 다 못 보낸 메시지
+                CLIENT(i)->blocked = 0;
+                if (FlushClient(i) < 0)
+                    continue;
+            }
+            if (FD_ISSET(CLIENT(i)->sockfd, &readFds)) {
+                // 재조립 버퍼로 데이터 수신
+                Stat.reads++;
+                n = frRead(&CLIENT(i)->fr, CLIENT(i)->sockfd);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                    continue;
+                if (n <= 0) {
+                    // 연결 종료
+                    printf("Client %d (ID: %s) disconnected.\n", CTAB_SLOT(i), CLIENT(i)->uid);
+                    CloseClient(i);
+                }
+                else {
+                    // 완성된 프레임을 모두 브로드캐스트
+                    HandleFrames(i);
+                }
+            }
+        }
+
+        // 3) 이번 tick에 쌓인 메시지를 연결마다 한 번에 보냄
+        FlushDirty();
+
+        // 4) 로그인/idle 시간이 지난 연결을 끊음
+        twAdvance(&Timers);
+    }
+}
+#else
+/*===============================================================
+[Function Name] : EpollLoop(void)
+[Description]   :
+    - 서버 소켓과 클라이언트 소켓을 edge-triggered로 epoll에 등록하고
+      준비된 fd만 처리하는 이벤트 루프
+    - edge-triggered이므로 accept()/recv()는 EAGAIN이 날 때까지 반복하고,
+      recv() 한 번마다 재조립 버퍼의 완성된 프레임을 모두 처리
+    - epoll_event.data.u32에는 세대 태그가 붙은 클라이언트 id
+      (서버 소켓은 LISTEN_KEY)를 저장하므로, 이미 닫힌 연결의 이벤트는
+      ctabGet()이 NULL을 리턴하여 걸러진다
+    - 클라이언트 소켓은 EPOLLOUT도 edge-triggered로 등록해 두어, 송신
+      버퍼가 비워지면 남은 대기열을 이번 tick의 FlushDirty()에서 보낸다
+    - 타이머가 걸려 있으면 epoll_wait()는 다음 만료 시각까지만 기다린다.
+[Input]         : 없음
+[Output]        : 클라이언트 연결/메시지
+[Call By]       : main()
+[Calls]         : epoll_wait(), epoll_ctl(), accept(), frRead(),
+                  AcceptClient(), HandleFrames(), CloseClient(),
+                  MarkDirty(), FlushDirty(), twTimeout(&Timers), twAdvance(&Timers)
+[Given]         : 전역변수 Sockfd, Epfd, Clients, Stat
+[Returns]       : 없음(무한 루프)
+==================================================================*/
+void EpollLoop(void)
+{
+    struct epoll_event ev, events[MAX_EVENTS];
+    struct sockaddr_in cliAddr;
+    socklen_t          cliAddrLen;
+    int                newSockfd, nev, i, n;
+
+    if ((Epfd = epoll_create1(0)) < 0) {
+        perror("epoll_create1");
+        exit(1);
+    }
+
+    ev.events   = EPOLLIN | EPOLLET;
+    ev.data.u32 = LISTEN_KEY;
+    if (epoll_ctl(Epfd, EPOLL_CTL_ADD, Sockfd, &ev) < 0) {
+        perror("epoll_ctl");
+        exit(1);
+    }
+
+    while (1) {
+        if ((nev = epoll_wait(Epfd, events, MAX_EVENTS, twTimeout(&Timers))) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            exit(1);
+        }
+
+        for (int e = 0; e < nev; e++) {
+            // 1) 새로운 클라이언트 연결: 대기 중인 연결을 모두 accept
+            if (events[e].data.u32 == LISTEN_KEY) {
+                while (1) {
+                    cliAddrLen = sizeof(cliAddr);
+                    newSockfd  = accept(Sockfd, (struct sockaddr *)&cliAddr, &cliAddrLen);
+                    if (newSockfd < 0) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                            perror("accept");
+                        if (errno == EINTR)
+                            continue;
+                        break;
+                    }
+                    if ((i = AcceptClient(newSockfd)) < 0)
+                        continue;
 
-            // 빈 자리 찾기
-            int i;
-            for (i = 0; i < MAX_CLIENT; i++) {
-                if (!Client[i].inUse) {
-                    Client[i].sockfd = newSockfd;
-                    Client[i].inUse  = 1;
-
-                    // 클라이언트 uid 수신
-                    if ((n = recv(newSockfd, Client[i].uid, MAX_ID, 0)) <= 0) {
-                        // 수신 실패(즉시 끊어짐)
-                        close(newSockfd);
-                        Client[i].inUse = 0;
-                    } else {
-                        printf("Client %d connected with ID: %s\n", i, Client[i].uid);
+                    if (SetNonBlocking(newSockfd) < 0) {
+                        perror("fcntl");
+                        CloseClient(i);
+                        continue;
                     }
+                    ev.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    ev.data.u32 = i;
+                    // 이미 도착한 uid 프레임은 등록할 때 바로 이벤트로 올라온다
+                    if (epoll_ctl(Epfd, EPOLL_CTL_ADD, newSockfd, &ev) < 0) {
+                        perror("epoll_ctl");
+                        CloseClient(i);
+                    }
+                }
+                continue;
+            }
+
+            // 2) 기존 클라이언트 소켓: EAGAIN까지 읽어 각 메시지를 브로드캐스트
+            i = events[e].data.u32;
+            if (CLIENT(i) == NULL)
+                continue;
+            if (events[e].events & EPOLLOUT) {
+                CLIENT(i)->blocked = 0;
+                if (! oqIsEmpty(&CLIENT(i)->q))
+                    MarkDirty(i);
+            }
+            if (! (events[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+                continue;
+            while (1) {
+                Stat.reads++;
+                n = frRead(&CLIENT(i)->fr, CLIENT(i)->sockfd);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                if (n <= 0) {
+                    // 연결 종료
+                    printf("Client %d (ID: %s) disconnected.\n", CTAB_SLOT(i), CLIENT(i)->uid);
+                    CloseClient(i);
                     break;
                 }
+                if (HandleFrames(i) < 0)
+                    break;
             }
+        }
+
+        // 이번 tick에 쌓인 메시지를 연결마다 한 번에 보냄
+        FlushDirty();
+        twAdvance(&Timers);
+    }
+}
+
+/*===============================================================
+[Function Name] : UrArmAccept(void)
+[Description]   :
+    - 서버 소켓에 multishot accept를 건다. 연결이 들어올 때마다
+      완료가 하나씩 오고, IORING_CQE_F_MORE가 빠지면 다시 걸어야 한다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : UringLoop()
+[Calls]         : UrSqe()
+[Given]         : 전역변수 Sockfd
+[Returns]       : 없음
+==================================================================*/
+void UrArmAccept(void)
+{
+    struct io_uring_sqe *sqe = UrSqe();
+
+    sqe->opcode    = IORING_OP_ACCEPT;
+    sqe->fd        = Sockfd;
+    sqe->ioprio    = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = UR_DATA(UR_ACCEPT, 0);
+}
 
-            if (i == MAX_CLIENT) {
-                // 자리가 없는 경우
-                char *msg = "Server is full\n";
-                send(newSockfd, msg, strlen(msg)+1, 0);
-                close(newSockfd);
+/*===============================================================
+[Function Name] : UrArmRecv(int id)
+[Description]   :
+    - id 클라이언트 소켓에 multishot recv를 건다. 데이터가 올 때마다
+      커널이 RecvBufs에서 버퍼를 하나 골라 채우고 완료를 올린다.
+[Input]         :
+    int id       - 클라이언트 id
+[Output]        : 없음
+[Call By]       : UringLoop()
+[Calls]         : UrSqe()
+[Given]         : 전역변수 Clients
+[Returns]       : 없음
+==================================================================*/
+void UrArmRecv(int id)
+{
+    struct io_uring_sqe *sqe = UrSqe();
+
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = CLIENT(id)->sockfd;
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = UR_BGID;
+    sqe->user_data = UR_DATA(UR_RECV, id);
+}
+
+/*===============================================================
+[Function Name] : UrRecvDone(int id, int res, unsigned flags)
+[Description]   :
+    - multishot recv 완료 처리. provided buffer의 데이터를 재조립
+      버퍼로 옮겨 완성된 프레임을 브로드캐스트하고 버퍼를 돌려준다.
+    - 버퍼가 모자랐으면(-ENOBUFS) 다시 걸고, 0이나 오류면 연결을 끊는다.
+[Input]         :
+    int id          - 클라이언트 id
+    int res         - cqe->res (받은 바이트 수 또는 -errno)
+    unsigned flags  - cqe->flags
+[Output]        : 접속 종료 메시지
+[Call By]       : UringLoop()
+[Calls]         : frPut(), HandleFrames(), urBuf(), urBufRecycle(), UrArmRecv(),
+                  CloseClient(), UrOpDone()
+[Given]         : 전역변수 Clients, RecvBufs, Stat
+[Returns]       : 없음
+==================================================================*/
+void UrRecvDone(int id, int res, unsigned flags)
+{
+    ClientType *c = CLIENT(id);
+    int         bid;
+
+    if (flags & IORING_CQE_F_BUFFER) {
+        bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (res > 0 && c->state != CS_CLOSING) {
+            Stat.reads++;
+            if (frPut(&c->fr, urBuf(&RecvBufs, bid), res) < 0) {
+                fprintf(stderr, "Client %d (ID: %s): invalid frame\n", CTAB_SLOT(id), c->uid);
+                CloseClient(id);
             }
+            else
+                HandleFrames(id);
         }
+        urBufRecycle(&RecvBufs, bid);
+    }
 
-        // 2) 기존 클라이언트 소켓에서의 데이터 수신
-        for(int i = 0; i < MAX_CLIENT; i++) {
-            if (Client[i].inUse && FD_ISSET(Client[i].sockfd, &readFds)) {
-                // recv()로 데이터 수신
-                n = recv(Client[i].sockfd, buf, MAX_BUF, 0);
-                if (n <= 0) {
-                    // 연결 종료
-                    printf("Client %d (ID: %s) disconnected.\n", i, Client[i].uid);
-                    close(Client[i].sockfd);
-                    Client[i].inUse = 0;
+    if (flags & IORING_CQE_F_MORE)
+        return;
+    if (c->state != CS_CLOSING && (res > 0 || res == -ENOBUFS)) {
+        UrArmRecv(id);      // ops는 그대로
+        return;
+    }
+    if (c->state != CS_CLOSING) {
+        // 연결 종료
+        printf("Client %d (ID: %s) disconnected.\n", CTAB_SLOT(id), c->uid);
+        CloseClient(id);
+    }
+    UrOpDone(id);
+}
+
+/*===============================================================
+[Function Name] : UrProbeRecv(void)
+[Description]   :
+    - 커널이 provided buffer를 쓰는 multishot recv(6.0 이후)를 지원하는지
+      socketpair에 실제로 걸어서 확인한다. 5.19에서는 io_uring_setup,
+      buffer ring, multishot accept가 모두 되지만 multishot recv만
+      -EINVAL로 끝나므로, 확인하지 않으면 모든 연결이 접속하자마자 끊긴다.
+    - 1바이트를 쓰고 쓰는 쪽을 닫아 두므로, 지원하면 1바이트를 받은 뒤
+      0(EOF)으로 끝나고, 지원하지 않으면 -EINVAL 하나로 끝난다.
+      마지막 완료(IORING_CQE_F_MORE 없음)까지 거둔 뒤 돌아온다.
+[Input]         : 없음
+[Output]        : 없음
+[Call By]       : UringLoop()
+[Calls]         : socketpair(), write(), shutdown(), UrSqe(),
+                  urSubmit(), urPeekCqe(), urCqeSeen(), urBufRecycle(), close()
+[Given]         : 전역변수 Ur, RecvBufs (다른 작업이 걸려 있지 않은 상태)
+[Returns]       : int (0: 지원, -1: 미지원)
+==================================================================*/
+int UrProbeRecv(void)
+{
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    int                  sv[2], res = -EINVAL, first = 1, done = 0;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        perror("socketpair");
+        return -1;
+    }
+    if (write(sv[1], "x", 1) != 1 || shutdown(sv[1], SHUT_WR) < 0) {
+        perror("write");
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+
+    sqe = UrSqe();
+    sqe->opcode    = IORING_OP_RECV;
+    sqe->fd        = sv[0];
+    sqe->ioprio    = IORING_RECV_MULTISHOT;
+    sqe->flags     = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = UR_BGID;
+    sqe->user_data = UR_DATA(UR_PROBE, 0);
+
+    while (! done) {
+        Stat.enters++;
+        if (urSubmit(&Ur, 1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("io_uring_enter");
+            break;
+        }
+        while (! done && (cqe = urPeekCqe(&Ur)) != NULL) {
+            if (first)
+                res = cqe->res;
+            first = 0;
+            if (cqe->flags & IORING_CQE_F_BUFFER)
+                urBufRecycle(&RecvBufs, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            if (! (cqe->flags & IORING_CQE_F_MORE))
+                done = 1;
+            urCqeSeen(&Ur);
+        }
+    }
+    close(sv[0]);
+    close(sv[1]);
+
+    return (done && res == 1) ? 0 : -1;
+}
+
+/*===============================================================
+[Function Name] : UringLoop(void)
+[Description]   :
+    - io_uring 이벤트 루프. 한 tick은 io_uring_enter() 한 번으로
+      이번 tick에 만든 SQE들을 제출하면서 완료를 기다리고,
+      완료를 모두 처리한 뒤 FlushDirty()로 다음 tick의 sendmsg를 만든다.
+    - 소켓은 blocking으로 둔다. (O_NONBLOCK이면 io_uring이 poll로
+      기다리지 않고 -EAGAIN을 돌려줌)
+    - user_data에 세대 태그가 붙은 id를 넣지만, 연결은 작업이 모두
+      끝난 뒤에야 닫히므로 완료가 올 때 슬롯은 항상 유효하다.
+[Input]         : 없음
+[Output]        : 클라이언트 연결/메시지
+[Call By]       : main()
+[Calls]         : urInit(), urBufRingInit(), urExit(), urSubmit(), urPeekCqe(), urCqeSeen(),
+                  UrProbeRecv(), UrArmAccept(), UrArmRecv(), UrArmTimer(), UrUpdateTimer(),
+                  AcceptClient(),
+                  UrRecvDone(), UrSendDone(), FlushDirty(), twTimeout(&Timers), twAdvance(&Timers)
+[Given]         : 전역변수 Ur, RecvBufs, UringOn, UrTimerOn, UrTimerAt, Stash, NStash, StashHead, Stat
+[Returns]       : int (-1: 커널이 지원하지 않음 → epoll로 대체, 그 외에는 리턴하지 않음)
+==================================================================*/
+int UringLoop(void)
+{
+    struct io_uring_cqe *cqe;
+    uint64_t             data;
+    unsigned             flags;
+    int                  res, id, wait, accepted = 0;
+
+    if (urInit(&Ur, UR_ENTRIES) < 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+    if (urBufRingInit(&Ur, &RecvBufs, UR_BGID, UR_NBUFS, UR_BUF_SIZE) < 0) {
+        perror("io_uring_register");
+        urExit(&Ur);
+        return -1;
+    }
+    if (UrProbeRecv() < 0) {
+        fprintf(stderr, "io_uring: multishot recv not supported\n");
+        urExit(&Ur);
+        return -1;
+    }
+    UringOn = 1;
+    printf("io_uring-based Chat Server started...\n");
+    UrArmAccept();
+
+    while (1) {
+        // 타이머가 있으면 다음 만료 시각에 깨어나도록 timeout을 하나 걸어 둔다.
+        // 걸려 있는 것보다 이른 타이머가 생겼으면 timeout을 당긴다.
+        if ((wait = twTimeout(&Timers)) >= 0) {
+            if (! UrTimerOn)
+                UrArmTimer(wait);
+            else if (twNow() + wait < UrTimerAt)
+                UrUpdateTimer(wait);
+        }
+        Stat.enters++;
+        if (urSubmit(&Ur, 1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("io_uring_enter");
+            exit(1);
+        }
+
+        while (1) {
+            // UrReap()이 먼저 거둬 둔 완료가 링에 남은 것보다 앞선다
+            if (StashHead < NStash) {
+                data  = Stash[StashHead].data;
+                res   = Stash[StashHead].res;
+                flags = Stash[StashHead].flags;
+                StashHead++;
+            }
+            else {
+                NStash = StashHead = 0;
+                if ((cqe = urPeekCqe(&Ur)) == NULL)
+                    break;
+                // 처리 중에 SQE를 만들며 다시 제출할 수 있으므로 먼저 꺼내 둔다
+                data  = cqe->user_data;
+                res   = cqe->res;
+                flags = cqe->flags;
+                urCqeSeen(&Ur);
+            }
+            id = (uint32_t)data;
+
+            switch (data >> 32) {
+            case UR_ACCEPT:
+                if (res >= 0) {
+                    accepted = 1;
+                    if ((id = AcceptClient(res)) >= 0) {
+                        UrArmRecv(id);
+                        CLIENT(id)->ops = 1;
+                    }
+                }
+                else if (res == -EINVAL && ! accepted) {
+                    // multishot accept를 모르는 커널 (5.19 이전)
+                    fprintf(stderr, "io_uring: multishot accept not supported\n");
+                    urExit(&Ur);
+                    UringOn = 0;
+                    return -1;
                 }
                 else {
-                    // 디버그: 서버가 받은 내용을 확인
-                    // (이 줄을 통해 서버가 정말 메시지를 받는지 확인 가능)
-                    printf("[DEBUG] Received from client %d (%s): %s\n", i, Client[i].uid, buf);
-
-                    // 받은 메시지 브로드캐스트
-                    BroadcastMessage(i, buf);
+                    errno = -res;
+                    perror("accept");
                 }
+                if (! (flags & IORING_CQE_F_MORE))
+                    UrArmAccept();
+                break;
+            case UR_RECV:
+                UrRecvDone(id, res, flags);
+                break;
+            case UR_SEND:
+                UrSendDone(id, res);
+                break;
+            case UR_TIMER:
+                UrTimerOn = 0;
+                break;
+            case UR_TIMER_UPD:
+                // -ENOENT: 이미 완료됨 (UR_TIMER 완료에서 다시 걸림)
+                break;
             }
         }
+
+        // 이번 tick에 쌓인 메시지를 연결마다 링크된 sendmsg로 만듦
+        FlushDirty();
+        twAdvance(&Timers);
+    }
+}
+#endif
+
+/*===============================================================
+[Function Name] : main(int argc, char *argv[])
+[Description]   :
+    - 서버 소켓 생성, bind, listen 후 이벤트 루프에서
+      여러 클라이언트를 동시에 처리.
+    - 새 클라이언트 접속 시 uid는 이벤트 루프가 첫 프레임으로 받아 저장.
+    - 메시지 수신 시 BroadcastMessage() 통해 다른 클라이언트에게 전송.
+[Input]         :
+    int argc, char *argv[] - -u (io_uring 엔진), -t (로그인 제한 시간), -i (idle 시간),
+                             backpressure 옵션 (-q, -p, -d; BP_USAGE 참조)
+[Output]        :
+    - 서버 시작/종료 메시지, 클라이언트 연결/메시지
+[Call By]       : OS
+[Calls]         :
+    CloseServer(), SelectLoop(), UringLoop() 또는 EpollLoop()
+[Given]         : 전역변수 Sockfd, Clients
+[Returns]       : int (프로그램 종료 상태)
+==================================================================*/
+int main(int argc, char *argv[])
+{
+    struct sockaddr_in servAddr;
+    int                opt;
+
+    bpInit(&Bp);
+    while ((opt = getopt(argc, argv, "ut:i:" BP_OPTS)) != -1) {
+#ifndef USE_SELECT
+        if (opt == 'u') {
+            UringOn = 1;
+            continue;
+        }
+#endif
+        if (opt == 't' && (LoginMs = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'i' && (IdleMs = atoi(optarg)) >= 0)
+            continue;
+        if (opt == 't' || opt == 'i' || bpParseOpt(&Bp, opt, optarg) < 0) {
+            fprintf(stderr, "Usage: %s [-u] [-t login_ms] [-i idle_ms] %s\n", argv[0], BP_USAGE);
+            exit(1);
+        }
+    }
+    twInit(&Timers, TICK_MS);
+
+    signal(SIGINT, CloseServer);
+    signal(SIGPIPE, SIG_IGN);
+
+    // 서버 소켓 생성
+    if ((Sockfd = socket(PF_INET, SOCK_STREAM, 0)) < 0) {
+        perror("socket");
+        exit(1);
+    }
+
+    int one = 1;
+    if (setsockopt(Sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) {
+        perror("setsockopt");
+        exit(1);
+    }
+
+    bzero((char *)&servAddr, sizeof(servAddr));
+    servAddr.sin_family      = PF_INET;
+    servAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    servAddr.sin_port        = htons(SERV_TCP_PORT);
+
+    if (bind(Sockfd, (struct sockaddr *)&servAddr, sizeof(servAddr)) < 0) {
+        perror("bind");
+        exit(1);
     }
 
+    if (listen(Sockfd, SOMAXCONN) < 0) {
+        perror("listen");
+        exit(1);
+    }
+
+    // 클라이언트 테이블 초기화 (필요할 때마다 청크 단위로 늘어남)
+    ctabInit(&Clients, sizeof(ClientType));
+
+#ifdef USE_SELECT
+    printf("Select-based Chat Server started...\n");
+    SelectLoop();
+#else
+    if (UringOn) {
+        // 실패하면 (커널 미지원, io_uring_disabled 등) epoll로 대체
+        UringOn = 0;
+        if (UringLoop() < 0)
+            printf("io_uring unavailable, falling back to epoll\n");
+    }
+    if (SetNonBlocking(Sockfd) < 0) {
+        perror("fcntl");
+        exit(1);
+    }
+    printf("Epoll-based Chat Server started...\n");
+    EpollLoop();
+#endif
+
     return 0;  // 일반적으로 도달 X
 }
-
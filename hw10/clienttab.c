@@ -0,0 +1,228 @@
+/*===============================================================
+[Program Name] : clienttab.c
+[Description]  :
+    - 채팅 서버용 동적 클라이언트 테이블 구현.
+    - 슬롯이 부족하면 CTAB_CHUNK개짜리 청크를 하나 더 붙여 테이블을 늘린다.
+      청크는 한번 만들어지면 옮겨지지 않으므로 원소 포인터는 항상 유효하다.
+    - 반납된 슬롯은 free list(LIFO)에 연결되어 ctabAlloc()이 O(1)에 재사용.
+[Input]        :
+    CTab *t;          // 클라이언트 테이블
+    int id;           // 세대 태그가 붙은 클라이언트 id
+[Output]       :
+    함수 성공 시 id 또는 0, 실패 시 -1 (ctabGet()은 NULL)
+[Calls]        :
+    posix_memalign(), calloc(), free(), memset()
+[특기사항]     :
+    - 테이블 자체는 lock을 잡지 않는다. 여러 스레드가 할당/반납하는
+      경우에는 호출하는 쪽에서 mutex로 보호해야 한다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "clienttab.h"
+
+/*===============================================================
+[Function Name] : int ctabInit(CTab *t, size_t elemSize)
+[Description]   :
+    - 빈 테이블을 초기화. 원소 크기는 CACHE_LINE의 배수로 올림하여
+      이웃 클라이언트끼리 캐시 라인을 공유하지 않도록 한다.
+[Input]         :
+    CTab *t;          // 초기화할 테이블
+    size_t elemSize;  // 원소(클라이언트 구조체) 크기
+[Output]        : 없음
+[Calls]         : memset()
+[Given]         : 없음
+[Returns]       : int; 0
+==================================================================*/
+int ctabInit(CTab *t, size_t elemSize)
+{
+	memset(t, 0, sizeof(CTab));
+	t->elemSize = (elemSize + CACHE_LINE - 1) & ~((size_t)CACHE_LINE - 1);
+	t->freeHead = -1;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : static int ctabGrow(CTab *t)
+[Description]   :
+    - 청크 하나(CTAB_CHUNK개 슬롯)를 테이블에 추가
+[Input]         :
+    CTab *t;          // 테이블
+[Output]        : 없음
+[Calls]         : posix_memalign(), calloc()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+static int ctabGrow(CTab *t)
+{
+	void	*p;
+
+	if (t->nChunks == CTAB_MAX_CHUNKS)  {
+		fprintf(stderr, "ctabGrow: table is full (%d slots)\n", CTAB_MAX_SLOTS);
+		return -1;
+	}
+	if (posix_memalign(&p, CACHE_LINE, t->elemSize * CTAB_CHUNK))  {
+		perror("posix_memalign");
+		return -1;
+	}
+	if ((t->meta[t->nChunks] = calloc(CTAB_CHUNK, sizeof(CTabMeta))) == NULL)  {
+		perror("calloc");
+		free(p);
+		return -1;
+	}
+	t->chunk[t->nChunks++] = p;
+
+	return 0;
+}
+
+#define	META(t, slot)	(&(t)->meta[(slot) >> CTAB_CHUNK_BITS][(slot) & (CTAB_CHUNK - 1)])
+#define	ELEM(t, slot)	((t)->chunk[(slot) >> CTAB_CHUNK_BITS] + \
+							(size_t)((slot) & (CTAB_CHUNK - 1)) * (t)->elemSize)
+
+/*===============================================================
+[Function Name] : int ctabAlloc(CTab *t)
+[Description]   :
+    - 빈 슬롯 하나를 할당. free list에 슬롯이 있으면 꺼내 쓰고,
+      없으면 새 슬롯을 만든다(필요 시 청크 추가). 원소는 0으로 초기화.
+[Input]         :
+    CTab *t;          // 테이블
+[Output]        : 없음
+[Calls]         : ctabGrow(), memset()
+[Given]         : 없음
+[Returns]       : int; 세대 태그가 붙은 id, 실패 시 -1
+==================================================================*/
+int ctabAlloc(CTab *t)
+{
+	int			slot;
+	CTabMeta	*m;
+
+	if (t->freeHead >= 0)  {
+		slot = t->freeHead;
+		m = META(t, slot);
+		t->freeHead = m->nextFree;
+	}
+	else  {
+		if (t->nSlots == t->nChunks * CTAB_CHUNK && ctabGrow(t) < 0)
+			return -1;
+		slot = t->nSlots++;
+		m = META(t, slot);
+	}
+	m->inUse = 1;
+	m->nextFree = -1;
+	t->nUsed++;
+	memset(ELEM(t, slot), 0, t->elemSize);
+
+	return CTAB_MKID(m->gen, slot);
+}
+
+/*===============================================================
+[Function Name] : int ctabFree(CTab *t, int id)
+[Description]   :
+    - id의 슬롯을 반납하고 free list에 연결. 세대 번호를 올려
+      이전 id로는 더 이상 접근할 수 없게 한다.
+[Input]         :
+    CTab *t;          // 테이블
+    int id;           // 반납할 id
+[Output]        : 없음
+[Calls]         : ctabGet()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 이미 반납된 id이면 -1
+==================================================================*/
+int ctabFree(CTab *t, int id)
+{
+	int			slot = CTAB_SLOT(id);
+	CTabMeta	*m;
+
+	if (ctabGet(t, id) == NULL)
+		return -1;
+
+	m = META(t, slot);
+	m->inUse = 0;
+	m->gen = (m->gen + 1) & CTAB_GEN_MASK;
+	m->nextFree = t->freeHead;
+	t->freeHead = slot;
+	t->nUsed--;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : void *ctabGet(CTab *t, int id)
+[Description]   :
+    - id에 해당하는 원소의 포인터를 리턴. 슬롯이 비었거나
+      세대 번호가 다르면(재사용된 슬롯) NULL.
+[Input]         :
+    CTab *t;          // 테이블
+    int id;           // 세대 태그가 붙은 id
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : void *; 원소 포인터 또는 NULL
+==================================================================*/
+void *ctabGet(CTab *t, int id)
+{
+	int			slot;
+	CTabMeta	*m;
+
+	if (id < 0)
+		return NULL;
+	slot = CTAB_SLOT(id);
+	if (slot >= t->nSlots)
+		return NULL;
+
+	m = META(t, slot);
+	if (! m->inUse || m->gen != CTAB_GEN(id))
+		return NULL;
+
+	return ELEM(t, slot);
+}
+
+/*===============================================================
+[Function Name] : int ctabNext(CTab *t, int id)
+[Description]   :
+    - id 다음으로 사용 중인 슬롯의 id를 리턴 (CTAB_FOREACH에서 사용)
+[Input]         :
+    CTab *t;          // 테이블
+    int id;           // 이전 id (처음에는 -1)
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : int; 다음 id, 더 없으면 -1
+==================================================================*/
+int ctabNext(CTab *t, int id)
+{
+	int			slot;
+	CTabMeta	*m;
+
+	for (slot = (id < 0) ? 0 : CTAB_SLOT(id) + 1 ; slot < t->nSlots ; slot++)  {
+		m = META(t, slot);
+		if (m->inUse)
+			return CTAB_MKID(m->gen, slot);
+	}
+
+	return -1;
+}
+
+/*===============================================================
+[Function Name] : void ctabDestroy(CTab *t)
+[Description]   :
+    - 테이블이 할당한 모든 청크를 해제
+[Input]         :
+    CTab *t;          // 테이블
+[Output]        : 없음
+[Calls]         : free()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void ctabDestroy(CTab *t)
+{
+	int		i;
+
+	for (i = 0 ; i < t->nChunks ; i++)  {
+		free(t->chunk[i]);
+		free(t->meta[i]);
+	}
+	ctabInit(t, t->elemSize);
+}
@@ -0,0 +1,59 @@
+/*===============================================================
+[Program Name] : clienttab.h
+[Description]  :
+    - 채팅 서버의 클라이언트 테이블(CTab) 선언.
+    - 청크 단위로 늘어나는 테이블이며 원소는 CACHE_LINE에 맞춰 정렬된다.
+    - 빈 슬롯은 free list로 O(1)에 할당/반납하고, id에는 세대 번호를
+      붙여 반납 후 재사용된 슬롯을 옛 id로 접근하지 못하게 한다.
+[특기사항]     :
+    - 함수 정의는 clienttab.c에 있음.
+    - 동기화는 하지 않으므로 여러 스레드가 쓰는 경우 호출하는 쪽에서 lock.
+==================================================================*/
+
+#ifndef _CLIENTTAB_H_
+#define _CLIENTTAB_H_
+
+#include <stddef.h>
+
+#define	CACHE_LINE		64
+
+#define	CTAB_CHUNK_BITS	8
+#define	CTAB_CHUNK		(1 << CTAB_CHUNK_BITS)		// 청크당 슬롯 수
+#define	CTAB_SLOT_BITS	20
+#define	CTAB_MAX_SLOTS	(1 << CTAB_SLOT_BITS)		// 최대 슬롯 수
+#define	CTAB_MAX_CHUNKS	(CTAB_MAX_SLOTS / CTAB_CHUNK)
+#define	CTAB_GEN_MASK	0x7ff						// id가 양수가 되도록 11비트
+
+// 세대(generation) 태그가 붙은 id <-> 슬롯 번호
+#define	CTAB_SLOT(id)		((id) & (CTAB_MAX_SLOTS - 1))
+#define	CTAB_GEN(id)		(((unsigned)(id) >> CTAB_SLOT_BITS) & CTAB_GEN_MASK)
+#define	CTAB_MKID(gen, slot)	((int)((((gen) & CTAB_GEN_MASK) << CTAB_SLOT_BITS) | (slot)))
+
+typedef struct  {
+	unsigned	gen;		// 슬롯이 재사용될 때마다 증가
+	int			nextFree;	// free list 다음 슬롯 (-1: 끝)
+	int			inUse;
+}
+	CTabMeta;
+
+typedef struct  {
+	size_t		elemSize;	// CACHE_LINE 배수로 올림한 원소 크기
+	int			nChunks;
+	int			nSlots;		// 지금까지 만들어진 슬롯 수 (high-water mark)
+	int			nUsed;
+	int			freeHead;
+	char		*chunk[CTAB_MAX_CHUNKS];
+	CTabMeta	*meta[CTAB_MAX_CHUNKS];
+}
+	CTab;
+
+int		ctabInit(CTab *t, size_t elemSize);
+int		ctabAlloc(CTab *t);
+int		ctabFree(CTab *t, int id);
+void	*ctabGet(CTab *t, int id);
+int		ctabNext(CTab *t, int id);
+void	ctabDestroy(CTab *t);
+
+#define	CTAB_FOREACH(t, id)	for ((id) = ctabNext((t), -1) ; (id) >= 0 ; (id) = ctabNext((t), (id)))
+
+#endif
@@ -0,0 +1,466 @@
+/*===============================================================
+[Program Name] : frame.c
+[Description]  :
+    - 길이 접두 프레임의 인코딩과 스트리밍(점진적) 파서 구현.
+    - frRead()는 재조립 버퍼의 남은 공간으로 한 번 recv()하고,
+      frNext()는 버퍼에 완성된 프레임이 있는 동안 payload를 하나씩
+      꺼낸다. 잘린 프레임은 다음 frRead()까지 버퍼에 남는다.
+    - frRingRead()/frRingFlush()는 클라이언트 수신 경로로, 링의 빈 공간
+      전체에 readv()를 한 번 하고, 완성된 프레임의 payload를 모두
+      iovec으로 모아(링 끝에서 잘린 payload는 둘로) writev() 한 번으로
+      출력한다. 메시지마다 printf()/fflush() 하지 않는다.
+[Input]        :
+    FrameReader *fr;  // 연결별 재조립 버퍼
+    int fd;           // 소켓
+[Output]       :
+    frNext()는 payload 포인터와 길이 (버퍼 안을 가리킴, 복사 없음)
+[Calls]        :
+    malloc(), recv(), readv(), writev(), memmove()
+[특기사항]     :
+    - frNext()가 돌려준 payload 포인터는 다음 frRead() 전까지만 유효하다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "frame.h"
+
+/*===============================================================
+[Function Name] : int frInit(FrameReader *fr, int size)
+[Description]   :
+    - size 바이트짜리 재조립 버퍼를 할당
+[Input]         :
+    FrameReader *fr;  // 초기화할 재조립 버퍼
+    int size;         // 버퍼 크기 (FRAME_HDR + FRAME_MAX 이상)
+[Output]        : 없음
+[Calls]         : malloc()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int frInit(FrameReader *fr, int size)
+{
+	if (size < FRAME_HDR + FRAME_MAX)
+		size = FRAME_HDR + FRAME_MAX;
+	if ((fr->buf = malloc(size)) == NULL)  {
+		perror("malloc");
+		return -1;
+	}
+	fr->size = size;
+	fr->start = fr->end = 0;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : ssize_t frRead(FrameReader *fr, int fd)
+[Description]   :
+    - 이미 처리한 앞부분을 버리고(남은 조각은 앞으로 당김),
+      버퍼의 남은 공간 전체로 recv()를 한 번 호출
+[Input]         :
+    FrameReader *fr;  // 재조립 버퍼
+    int fd;           // 소켓
+[Output]        : 없음
+[Calls]         : memmove(), recv()
+[Given]         : 없음
+[Returns]       : ssize_t; recv()의 리턴값 (0: 연결 종료, -1: errno 참조)
+==================================================================*/
+ssize_t frRead(FrameReader *fr, int fd)
+{
+	ssize_t	n;
+
+	if (fr->start > 0)  {
+		memmove(fr->buf, fr->buf + fr->start, fr->end - fr->start);
+		fr->end -= fr->start;
+		fr->start = 0;
+	}
+
+	if ((n = recv(fd, fr->buf + fr->end, fr->size - fr->end, 0)) > 0)
+		fr->end += n;
+
+	return n;
+}
+
+/*===============================================================
+[Function Name] : int frPut(FrameReader *fr, const char *data, int len)
+[Description]   :
+    - recv()를 직접 하지 않고 이미 받은 데이터를 버퍼 뒤에 붙인다.
+      (io_uring이 provided buffer에 받아 온 데이터를 넘길 때 사용)
+    - frRead()와 같이 처리한 앞부분을 먼저 버린다.
+[Input]         :
+    FrameReader *fr;  // 재조립 버퍼
+    const char *data; // 받은 데이터
+    int len;          // 데이터 길이
+[Output]        : 없음
+[Calls]         : memmove(), memcpy()
+[Given]         : 없음
+[Returns]       : int; 0 성공, -1 버퍼에 공간이 없음
+==================================================================*/
+int frPut(FrameReader *fr, const char *data, int len)
+{
+	if (fr->start > 0)  {
+		memmove(fr->buf, fr->buf + fr->start, fr->end - fr->start);
+		fr->end -= fr->start;
+		fr->start = 0;
+	}
+
+	if (len > fr->size - fr->end)
+		return -1;
+
+	memcpy(fr->buf + fr->end, data, len);
+	fr->end += len;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int frNext(FrameReader *fr, char **payload, int *len)
+[Description]   :
+    - 버퍼에서 완성된 프레임 하나를 꺼낸다.
+[Input]         :
+    FrameReader *fr;  // 재조립 버퍼
+    char **payload;   // payload 시작 위치를 돌려받음
+    int *len;         // payload 길이를 돌려받음
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : int; 1 프레임 있음, 0 데이터가 더 필요, -1 프레임이 FRAME_MAX보다 큼
+==================================================================*/
+int frNext(FrameReader *fr, char **payload, int *len)
+{
+	int		avail = fr->end - fr->start;
+	int		n;
+
+	if (avail < FRAME_HDR)
+		return 0;
+
+	n = FRAME_GET_LEN(fr->buf + fr->start);
+	if (n > FRAME_MAX)
+		return -1;
+	if (avail < FRAME_HDR + n)
+		return 0;
+
+	*payload = fr->buf + fr->start + FRAME_HDR;
+	*len = n;
+	fr->start += FRAME_HDR + n;
+
+	return 1;
+}
+
+/*===============================================================
+[Function Name] : int frRecv(FrameReader *fr, int fd, char **payload, int *len)
+[Description]   :
+    - 완성된 프레임이 하나 생길 때까지 frRead()를 반복 (blocking 소켓용)
+[Input]         :
+    FrameReader *fr;  // 재조립 버퍼
+    int fd;           // 소켓
+    char **payload;   // payload 시작 위치를 돌려받음
+    int *len;         // payload 길이를 돌려받음
+[Output]        : 없음
+[Calls]         : frNext(), frRead()
+[Given]         : 없음
+[Returns]       : int; 1 프레임 있음, 0 연결 종료, -1 오류 또는 잘못된 프레임
+==================================================================*/
+int frRecv(FrameReader *fr, int fd, char **payload, int *len)
+{
+	int		r;
+	ssize_t	n;
+
+	while ((r = frNext(fr, payload, len)) == 0)  {
+		if ((n = frRead(fr, fd)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			return 0;
+	}
+
+	return r;
+}
+
+/*===============================================================
+[Function Name] : void frDestroy(FrameReader *fr)
+[Description]   :
+    - 재조립 버퍼 해제
+[Input]         :
+    FrameReader *fr;  // 재조립 버퍼
+[Output]        : 없음
+[Calls]         : free()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void frDestroy(FrameReader *fr)
+{
+	free(fr->buf);
+	fr->buf = NULL;
+	fr->size = fr->start = fr->end = 0;
+}
+
+/*===============================================================
+[Function Name] : int frRingInit(FrameRing *r, unsigned size)
+[Description]   :
+    - size 바이트짜리 수신 링을 할당. (2의 거듭제곱으로 올림)
+[Input]         :
+    FrameRing *r;     // 초기화할 링
+    unsigned size;    // 링 크기 (FRAME_HDR + FRAME_MAX 이상)
+[Output]        : 없음
+[Calls]         : malloc()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int frRingInit(FrameRing *r, unsigned size)
+{
+	unsigned	n = FRAME_HDR + FRAME_MAX;
+
+	if (size < n)
+		size = n;
+	for (n = 1 ; n < size ; n <<= 1)
+		;
+	if ((r->buf = malloc(n)) == NULL)  {
+		perror("malloc");
+		return -1;
+	}
+	r->size = n;
+	r->head = r->tail = 0;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : ssize_t frRingRead(FrameRing *r, int fd)
+[Description]   :
+    - 링의 빈 공간 전체(끝에서 나뉘면 두 조각)로 readv()를 한 번 호출.
+      남아 있는 잘린 프레임은 옮기지 않는다.
+[Input]         :
+    FrameRing *r;     // 수신 링
+    int fd;           // 소켓
+[Output]        : 없음
+[Calls]         : readv()
+[Given]         : 이전 frRingFlush()로 완성된 프레임은 모두 출력된 상태
+[Returns]       : ssize_t; 받은 바이트 수, 0이면 연결 종료, -1이면 오류
+==================================================================*/
+ssize_t frRingRead(FrameRing *r, int fd)
+{
+	struct iovec	iov[2];
+	unsigned		mask = r->size - 1;
+	unsigned		pos = r->tail & mask;
+	unsigned		room = r->size - (r->tail - r->head);
+	int				iovcnt = 1;
+	ssize_t			n;
+
+	if (room == 0)  {
+		errno = ENOBUFS;
+		return -1;
+	}
+	iov[0].iov_base = r->buf + pos;
+	iov[0].iov_len  = room < r->size - pos ? room : r->size - pos;
+	if (iov[0].iov_len < room)  {
+		iov[1].iov_base = r->buf;
+		iov[1].iov_len  = room - iov[0].iov_len;
+		iovcnt = 2;
+	}
+
+	while ((n = readv(fd, iov, iovcnt)) < 0 && errno == EINTR)
+		;
+	if (n > 0)
+		r->tail += n;
+
+	return n;
+}
+
+/*===============================================================
+[Function Name] : static int frWriteAll(int fd, struct iovec *iov, int iovcnt)
+[Description]   :
+    - iov 전체를 writev()로 출력. 일부만 쓰이면 나머지를 이어서 쓴다.
+[Input]         :
+    int fd;               // 출력 fd
+    struct iovec *iov;    // 출력할 조각들 (일부 쓰기 시 내용이 바뀜)
+    int iovcnt;           // 조각 수
+[Output]        : 없음
+[Calls]         : writev()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+static int frWriteAll(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t	n;
+
+	while (iovcnt > 0)  {
+		if ((n = writev(fd, iov, iovcnt)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		while (iovcnt > 0 && n >= (ssize_t)iov->iov_len)  {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0)  {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int frRingFlush(FrameRing *r, int outFd)
+[Description]   :
+    - 링에 있는 완성된 프레임의 payload를 모두 iovec으로 모아
+      writev()로 outFd에 출력하고 링에서 뺀다. (복사 없음)
+    - 프레임이 FR_IOV_MAX 조각을 넘을 때만 writev()를 더 부른다.
+      잘린 프레임은 다음 frRingRead()까지 남는다.
+[Input]         :
+    FrameRing *r;     // 수신 링
+    int outFd;        // 출력 fd (STDOUT_FILENO)
+[Output]        : payload들을 outFd에 출력
+[Calls]         : frWriteAll()
+[Given]         : 없음
+[Returns]       : int; 출력한 프레임 수, -1: 잘못된 길이(errno EPROTO,
+                  연결을 끊어야 함) 또는 출력 실패
+==================================================================*/
+int frRingFlush(FrameRing *r, int outFd)
+{
+	struct iovec	iov[FR_IOV_MAX];
+	unsigned		mask = r->size - 1;
+	unsigned		pos, first, len;
+	int				iovcnt = 0, frames = 0;
+
+	while (r->tail - r->head >= FRAME_HDR)  {
+		len = ((unsigned char)r->buf[r->head & mask] << 8)
+			| (unsigned char)r->buf[(r->head + 1) & mask];
+		if (len > FRAME_MAX)  {
+			errno = EPROTO;
+			return -1;
+		}
+		if (r->tail - r->head < FRAME_HDR + len)
+			break;
+
+		pos = (r->head + FRAME_HDR) & mask;
+		first = len < r->size - pos ? len : r->size - pos;
+		if (first > 0)  {
+			iov[iovcnt].iov_base = r->buf + pos;
+			iov[iovcnt++].iov_len = first;
+		}
+		if (len > first)  {
+			iov[iovcnt].iov_base = r->buf;
+			iov[iovcnt++].iov_len = len - first;
+		}
+		r->head += FRAME_HDR + len;
+		frames++;
+
+		if (iovcnt >= FR_IOV_MAX - 1)  {
+			if (frWriteAll(outFd, iov, iovcnt) < 0)
+				return -1;
+			iovcnt = 0;
+		}
+	}
+	if (iovcnt > 0 && frWriteAll(outFd, iov, iovcnt) < 0)
+		return -1;
+
+	// 비었으면 처음으로 되돌려 다음 readv()가 한 조각으로 끝나게 함
+	if (r->head == r->tail)
+		r->head = r->tail = 0;
+
+	return frames;
+}
+
+/*===============================================================
+[Function Name] : void frRingDestroy(FrameRing *r)
+[Description]   :
+    - 수신 링 해제
+[Input]         :
+    FrameRing *r;     // 수신 링
+[Output]        : 없음
+[Calls]         : free()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void frRingDestroy(FrameRing *r)
+{
+	free(r->buf);
+	r->buf = NULL;
+	r->size = r->head = r->tail = 0;
+}
+
+/*===============================================================
+[Function Name] : int frameEncode(char *dst, int dstSize, const char *payload, int len)
+[Description]   :
+    - dst에 길이 헤더와 payload를 기록하여 프레임을 만든다.
+      dst에 다 들어가지 않으면 payload를 잘라낸다.
+[Input]         :
+    char *dst;            // 프레임을 만들 버퍼
+    int dstSize;          // dst 크기
+    const char *payload;  // payload
+    int len;              // payload 길이
+[Output]        : 없음
+[Calls]         : memcpy()
+[Given]         : dstSize >= FRAME_HDR
+[Returns]       : int; 프레임 전체 길이 (헤더 포함)
+==================================================================*/
+int frameEncode(char *dst, int dstSize, const char *payload, int len)
+{
+	if (len > dstSize - FRAME_HDR)
+		len = dstSize - FRAME_HDR;
+	if (len > FRAME_MAX)
+		len = FRAME_MAX;
+
+	FRAME_PUT_LEN(dst, len);
+	memcpy(dst + FRAME_HDR, payload, len);
+
+	return FRAME_HDR + len;
+}
+
+/*===============================================================
+[Function Name] : int frameWrite(int fd, const char *payload, int len)
+[Description]   :
+    - 헤더와 payload를 writev()로 한번에 보내고, 일부만 보내진 경우
+      나머지를 이어서 보낸다. (blocking 소켓용)
+[Input]         :
+    int fd;               // 소켓
+    const char *payload;  // payload
+    int len;              // payload 길이 (FRAME_MAX 이하)
+[Output]        : 없음
+[Calls]         : writev()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1 (errno 참조)
+==================================================================*/
+int frameWrite(int fd, const char *payload, int len)
+{
+	char			hdr[FRAME_HDR];
+	struct iovec	iov[2];
+	int				iovcnt = 2;
+	ssize_t			n;
+
+	if (len > FRAME_MAX)
+		len = FRAME_MAX;
+	FRAME_PUT_LEN(hdr, len);
+
+	iov[0].iov_base = hdr;
+	iov[0].iov_len  = FRAME_HDR;
+	iov[1].iov_base = (char *)payload;
+	iov[1].iov_len  = len;
+
+	while (iovcnt > 0)  {
+		if ((n = writev(fd, &iov[2 - iovcnt], iovcnt)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		while (iovcnt > 0 && n >= (ssize_t)iov[2 - iovcnt].iov_len)  {
+			n -= iov[2 - iovcnt].iov_len;
+			iovcnt--;
+		}
+		if (iovcnt > 0)  {
+			iov[2 - iovcnt].iov_base = (char *)iov[2 - iovcnt].iov_base + n;
+			iov[2 - iovcnt].iov_len -= n;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,64 @@
+/*===============================================================
+[Program Name] : frame.h
+[Description]  :
+    - 채팅 프로토콜의 길이 접두(length-prefixed) 프레임 선언.
+    - 프레임 = 2바이트 길이(network byte order) + 길이만큼의 payload.
+      payload는 NUL로 끝나지 않는다.
+    - FrameReader는 연결별 재조립 버퍼로, 한 번의 recv()로 들어온 여러
+      프레임이나 여러 recv()로 나뉘어 들어온 프레임을 모두 처리한다.
+    - FrameRing은 클라이언트 수신용 링 버퍼로, 데이터를 옮기지(memmove)
+      않고 완성된 프레임들의 payload를 writev() 한 번으로 출력한다.
+[특기사항]     :
+    - 함수 정의는 frame.c에 있음.
+==================================================================*/
+
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define	FRAME_HDR		2			// 길이 필드 크기
+#define	FRAME_MAX		4096		// payload 최대 길이
+#define	FRAME_BUF		(2 * (FRAME_HDR + FRAME_MAX))	// 기본 재조립 버퍼 크기
+
+// p에 payload 길이 n을 기록 / p에서 길이를 읽음
+#define	FRAME_PUT_LEN(p, n)	do { ((unsigned char *)(p))[0] = ((n) >> 8) & 0xff; \
+								 ((unsigned char *)(p))[1] = (n) & 0xff; } while (0)
+#define	FRAME_GET_LEN(p)	((((unsigned char *)(p))[0] << 8) | ((unsigned char *)(p))[1])
+
+typedef struct  {
+	char	*buf;
+	int		size;		// 버퍼 크기
+	int		start;		// 아직 처리하지 않은 첫 바이트 위치
+	int		end;		// 받은 데이터의 끝
+}
+	FrameReader;
+
+#define	FR_RING_SIZE	(1 << 20)	// 클라이언트 수신 링 기본 크기 (2의 거듭제곱)
+#define	FR_IOV_MAX		1024		// writev() 한 번에 넘기는 iovec 최대 수
+
+typedef struct  {
+	char		*buf;
+	unsigned	size;		// 링 크기 (2의 거듭제곱)
+	unsigned	head;		// 아직 출력하지 않은 첫 바이트 (계속 증가, size로 나눈 나머지가 위치)
+	unsigned	tail;		// 받은 데이터의 끝 (계속 증가)
+}
+	FrameRing;
+
+int		frInit(FrameReader *fr, int size);
+ssize_t	frRead(FrameReader *fr, int fd);
+int		frPut(FrameReader *fr, const char *data, int len);
+int		frNext(FrameReader *fr, char **payload, int *len);
+int		frRecv(FrameReader *fr, int fd, char **payload, int *len);
+void	frDestroy(FrameReader *fr);
+
+int		frRingInit(FrameRing *r, unsigned size);
+ssize_t	frRingRead(FrameRing *r, int fd);
+int		frRingFlush(FrameRing *r, int outFd);
+void	frRingDestroy(FrameRing *r);
+
+int		frameEncode(char *dst, int dstSize, const char *payload, int len);
+int		frameWrite(int fd, const char *payload, int len);
+
+#endif
@@ -0,0 +1,286 @@
+/*===============================================================
+[Program Name] : handoff.c
+[Description]  :
+    - UNIX 도메인 스트림 소켓으로 fd와 상태를 넘기는 hot restart 구현.
+    - hoSend()는 헤더와 body를 sendmsg() 한 번으로 보내며, fd가 있으면
+      SCM_RIGHTS로 붙인다. hoRecv()는 헤더 크기만큼만 recvmsg()하여
+      그 레코드의 fd를 받고, body는 따로 읽는다. (스트림 소켓에서 fd가
+      붙은 데이터는 앞뒤 데이터와 한 번에 읽히지 않는다.)
+[Input]        :
+    int sock;         // handoff 연결
+[Output]       :
+    넘겨받은 fd (프로세스의 새 fd 번호)
+[Calls]        :
+    socket(), bind(), listen(), connect(), sendmsg(), recvmsg()
+[특기사항]     :
+    - 받는 쪽은 MSG_CMSG_CLOEXEC로 받아, 이어서 exec하는 경우 새지 않게 한다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include "handoff.h"
+
+/*===============================================================
+[Function Name] : static int hoAddr(struct sockaddr_un *addr, const char *path)
+[Description]   :
+    - path로 UNIX 도메인 소켓 주소를 만든다.
+[Input]         :
+    struct sockaddr_un *addr; // 주소
+    const char *path;         // 소켓 파일 경로
+[Output]        : 없음
+[Calls]         : memset(), strcpy()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 경로가 너무 길면 -1
+==================================================================*/
+static int hoAddr(struct sockaddr_un *addr, const char *path)
+{
+	if (strlen(path) >= sizeof(addr->sun_path))  {
+		fprintf(stderr, "%s: handoff socket path too long\n", path);
+		return -1;
+	}
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int hoListen(const char *path)
+[Description]   :
+    - 새 서버의 접속을 기다릴 handoff 소켓을 만든다.
+      지난 서버가 남긴 소켓 파일은 지운다.
+[Input]         :
+    const char *path; // 소켓 파일 경로
+[Output]        : 없음
+[Calls]         : socket(), unlink(), bind(), listen()
+[Given]         : 없음
+[Returns]       : int; 서버 소켓, 실패 -1
+==================================================================*/
+int hoListen(const char *path)
+{
+	struct sockaddr_un	addr;
+	int					fd;
+
+	if (hoAddr(&addr, path) < 0)
+		return -1;
+	if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)  {
+		perror("socket");
+		return -1;
+	}
+	unlink(path);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0)  {
+		perror(path);
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*===============================================================
+[Function Name] : int hoConnect(const char *path)
+[Description]   :
+    - 실행 중인 서버의 handoff 소켓에 접속한다.
+[Input]         :
+    const char *path; // 소켓 파일 경로
+[Output]        : 없음
+[Calls]         : socket(), connect()
+[Given]         : 없음
+[Returns]       : int; 연결, -1: 넘겨줄 서버가 없음 (처음 시작)
+==================================================================*/
+int hoConnect(const char *path)
+{
+	struct sockaddr_un	addr;
+	int					fd;
+
+	if (hoAddr(&addr, path) < 0)
+		return -1;
+	if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)  {
+		perror("socket");
+		return -1;
+	}
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)  {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*===============================================================
+[Function Name] : int hoSend(int sock, int type, int fd, const void *body, int len)
+[Description]   :
+    - 레코드 하나를 보낸다. fd >= 0이면 SCM_RIGHTS로 함께 넘긴다.
+      일부만 보내지면 나머지를 이어서 보낸다. (fd는 첫 sendmsg()에만)
+[Input]         :
+    int sock;         // handoff 연결
+    int type;         // HO_LISTEN, HO_CLIENT, HO_END
+    int fd;           // 넘길 fd (-1: 없음)
+    const void *body; // body (len이 0이면 NULL 가능)
+    int len;          // body 길이
+[Output]        : 없음
+[Calls]         : sendmsg()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int hoSend(int sock, int type, int fd, const void *body, int len)
+{
+	HoHdr			hdr;
+	struct iovec	iov[2];
+	struct msghdr	msg;
+	struct cmsghdr	*cm;
+	char			cbuf[CMSG_SPACE(sizeof(int))];
+	ssize_t			n;
+	int				i = 0;
+
+	hdr.type = type;
+	hdr.len = len;
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len  = sizeof(hdr);
+	iov[1].iov_base = (void *)body;
+	iov[1].iov_len  = len;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov    = iov;
+	msg.msg_iovlen = len > 0 ? 2 : 1;
+	if (fd >= 0)  {
+		memset(cbuf, 0, sizeof(cbuf));
+		msg.msg_control    = cbuf;
+		msg.msg_controllen = sizeof(cbuf);
+		cm = CMSG_FIRSTHDR(&msg);
+		cm->cmsg_level = SOL_SOCKET;
+		cm->cmsg_type  = SCM_RIGHTS;
+		cm->cmsg_len   = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+	}
+
+	while (msg.msg_iovlen > 0)  {
+		if ((n = sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		msg.msg_control    = NULL;		// fd는 이미 넘어감
+		msg.msg_controllen = 0;
+		while (msg.msg_iovlen > 0 && n >= (ssize_t)iov[i].iov_len)  {
+			n -= iov[i].iov_len;
+			i++;
+			msg.msg_iovlen--;
+		}
+		if (msg.msg_iovlen > 0)  {
+			iov[i].iov_base = (char *)iov[i].iov_base + n;
+			iov[i].iov_len -= n;
+		}
+		msg.msg_iov = &iov[i];
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : static int hoReadAll(int sock, char *buf, int len)
+[Description]   :
+    - len 바이트를 다 읽을 때까지 read()
+[Input]         :
+    int sock;         // handoff 연결
+    char *buf;        // 읽을 버퍼
+    int len;          // 읽을 길이
+[Output]        : 없음
+[Calls]         : read()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 연결이 끊기거나 실패하면 -1
+==================================================================*/
+static int hoReadAll(int sock, char *buf, int len)
+{
+	ssize_t	n;
+
+	while (len > 0)  {
+		if ((n = read(sock, buf, len)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (n == 0)
+			return -1;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int hoRecv(int sock, int *type, int *fd, char **body)
+[Description]   :
+    - 레코드 하나를 받는다. 헤더와 함께 온 fd는 *fd에, body는
+      malloc()한 버퍼에 담아 *body로 돌려준다.
+[Input]         :
+    int sock;         // handoff 연결
+    int *type;        // 레코드 종류
+    int *fd;          // 넘겨받은 fd (없으면 -1)
+    char **body;      // body (없으면 NULL, 호출하는 쪽에서 free())
+[Output]        : 없음
+[Calls]         : recvmsg(), malloc(), hoReadAll()
+[Given]         : 없음
+[Returns]       : int; body 길이, 실패 -1
+==================================================================*/
+int hoRecv(int sock, int *type, int *fd, char **body)
+{
+	HoHdr			hdr;
+	struct iovec	iov;
+	struct msghdr	msg;
+	struct cmsghdr	*cm;
+	char			cbuf[CMSG_SPACE(sizeof(int))];
+	ssize_t			n;
+
+	*fd = -1;
+	*body = NULL;
+	iov.iov_base = &hdr;
+	iov.iov_len  = sizeof(hdr);
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1;
+	msg.msg_control    = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+
+	while ((n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+		;
+	if (n <= 0)
+		return -1;
+	for (cm = CMSG_FIRSTHDR(&msg) ; cm != NULL ; cm = CMSG_NXTHDR(&msg, cm))  {
+		if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+			memcpy(fd, CMSG_DATA(cm), sizeof(int));
+	}
+	// 헤더가 나뉘어 온 경우 (fd는 첫 조각에만 붙음)
+	if (n < (ssize_t)sizeof(hdr) && hoReadAll(sock, (char *)&hdr + n, sizeof(hdr) - n) < 0)
+		goto fail;
+	if (hdr.len < 0 || hdr.len > HO_BODY_MAX)
+		goto fail;
+
+	if (hdr.len > 0)  {
+		if ((*body = malloc(hdr.len)) == NULL)  {
+			perror("malloc");
+			goto fail;
+		}
+		if (hoReadAll(sock, *body, hdr.len) < 0)
+			goto fail;
+	}
+	*type = hdr.type;
+
+	return hdr.len;
+
+fail:
+	if (*fd >= 0)
+		close(*fd);
+	*fd = -1;
+	free(*body);
+	*body = NULL;
+	return -1;
+}
@@ -0,0 +1,35 @@
+/*===============================================================
+[Program Name] : handoff.h
+[Description]  :
+    - 서버 hot restart용 소켓 넘겨주기(handoff) 선언.
+    - 실행 중인 서버는 UNIX 도메인 소켓(hoListen())에서 기다리고, 새로
+      뜬 서버가 hoConnect()로 접속하면 서버 소켓과 클라이언트 소켓을
+      SCM_RIGHTS로 넘긴다. 커널의 소켓은 그대로이므로 연결이 끊기지 않는다.
+    - 레코드 = HoHdr(종류, body 길이) + body. 소켓을 넘기는 레코드는
+      헤더와 함께 fd 하나를 ancillary data로 보낸다.
+[특기사항]     :
+    - 함수 정의는 handoff.c에 있음.
+    - body의 내용(클라이언트 상태 등)은 서버가 정한다. 같은 빌드끼리 주고받는다고 가정.
+==================================================================*/
+
+#ifndef _HANDOFF_H_
+#define _HANDOFF_H_
+
+#define	HO_LISTEN		1			// 서버 소켓 (fd)
+#define	HO_CLIENT		2			// 클라이언트 소켓 (fd) + 클라이언트 상태
+#define	HO_END			3			// 넘길 것이 더 없음
+
+#define	HO_BODY_MAX		(64 << 20)	// 받을 body 최대 크기
+
+typedef struct  {
+	int		type;
+	int		len;		// 뒤따르는 body 길이
+}
+	HoHdr;
+
+int		hoListen(const char *path);
+int		hoConnect(const char *path);
+int		hoSend(int sock, int type, int fd, const void *body, int len);
+int		hoRecv(int sock, int *type, int *fd, char **body);
+
+#endif
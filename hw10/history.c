@@ -0,0 +1,140 @@
+/*===============================================================
+[Program Name] : history.c
+[Description]  :
+    - 방별 최근 메시지 ring 구현.
+    - hsPush()는 순번을 atomic으로 하나 얻어 (순번 % HIST_LEN) 칸의
+      버퍼를 바꾸고 이전 버퍼의 참조를 반납한다.
+    - hsRecent()는 최근 n개의 버퍼 참조를 오래된 것부터 얻는다. 읽는 동안
+      덮어쓰인 칸은 건너뛰므로 쓰는 쪽을 기다리지 않는다.
+[Input]        :
+    History *h;       // 방의 메시지 기록
+[Output]       :
+    hsRecent()는 참조를 얻은 MsgBuf 목록
+[Calls]        :
+    mbRef(), mbTryRef(), mbUnref()
+[특기사항]     :
+    - 칸의 버퍼가 반납되어 풀에서 다른 메시지로 재사용되었더라도,
+      mbTryRef()로 참조를 얻은 뒤 칸의 순번과 포인터를 다시 확인하므로
+      다른 메시지를 돌려주지 않는다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "history.h"
+
+/*===============================================================
+[Function Name] : void hsInit(History *h)
+[Description]   :
+    - 빈 기록으로 초기화
+[Input]         :
+    History *h;       // 초기화할 기록
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void hsInit(History *h)
+{
+	int		i;
+
+	atomic_init(&h->head, 0);
+	for (i = 0 ; i < HIST_LEN ; i++)  {
+		atomic_init(&h->slot[i].seq, -1);
+		atomic_init(&h->slot[i].mb, NULL);
+	}
+}
+
+/*===============================================================
+[Function Name] : void hsPush(History *h, MsgBuf *mb)
+[Description]   :
+    - mb의 참조를 하나 늘려 기록에 넣는다. 가장 오래된 메시지가
+      밀려나며 그 참조를 반납한다.
+[Input]         :
+    History *h;       // 방의 기록
+    MsgBuf *mb;       // 브로드캐스트한 메시지 (프레임)
+[Output]        : 없음
+[Calls]         : mbRef(), mbUnref()
+[Given]         : mb의 참조를 가지고 있어야 함
+[Returns]       : 없음
+==================================================================*/
+void hsPush(History *h, MsgBuf *mb)
+{
+	HistSlot	*s;
+	MsgBuf		*old;
+	long		seq;
+
+	seq = atomic_fetch_add(&h->head, 1);
+	s = &h->slot[seq & (HIST_LEN - 1)];
+
+	mbRef(mb);
+	atomic_store(&s->seq, -1);		// 읽는 쪽이 바뀌는 중인 칸을 알 수 있도록
+	old = atomic_exchange(&s->mb, mb);
+	atomic_store(&s->seq, seq);
+	if (old)
+		mbUnref(old);
+}
+
+/*===============================================================
+[Function Name] : int hsRecent(History *h, int n, MsgBuf **out)
+[Description]   :
+    - 최근 n개(HIST_LEN 이하)의 메시지 참조를 오래된 것부터 out에 담는다.
+    - 읽는 사이에 덮어쓰인 칸은 건너뛰므로 n개보다 적을 수 있다.
+[Input]         :
+    History *h;       // 방의 기록
+    int n;            // 원하는 메시지 수
+    MsgBuf **out;     // 결과 (HIST_LEN개 이상 들어가야 함)
+[Output]        : 없음
+[Calls]         : mbTryRef(), mbUnref()
+[Given]         : 없음
+[Returns]       : int; out에 담은 수 (사용 후 각각 mbUnref())
+==================================================================*/
+int hsRecent(History *h, int n, MsgBuf **out)
+{
+	HistSlot	*s;
+	MsgBuf		*mb;
+	long		head, seq;
+	int			cnt = 0;
+
+	if (n > HIST_LEN)
+		n = HIST_LEN;
+	head = atomic_load(&h->head);
+	seq = (head > n) ? head - n : 0;
+
+	for ( ; seq < head ; seq++)  {
+		s = &h->slot[seq & (HIST_LEN - 1)];
+		if (atomic_load(&s->seq) != seq)
+			continue;					// 아직 쓰는 중이거나 이미 덮어쓰임
+		if ((mb = atomic_load(&s->mb)) == NULL || ! mbTryRef(mb))
+			continue;
+		if (atomic_load(&s->seq) != seq || atomic_load(&s->mb) != mb)  {
+			mbUnref(mb);				// 참조를 얻는 사이에 덮어쓰임
+			continue;
+		}
+		out[cnt++] = mb;
+	}
+
+	return cnt;
+}
+
+/*===============================================================
+[Function Name] : void hsDestroy(History *h)
+[Description]   :
+    - 기록에 남은 버퍼들의 참조를 반납 (방을 지울 때)
+[Input]         :
+    History *h;       // 방의 기록
+[Output]        : 없음
+[Calls]         : mbUnref()
+[Given]         : 더 이상 hsPush()/hsRecent()하는 쪽이 없어야 함
+[Returns]       : 없음
+==================================================================*/
+void hsDestroy(History *h)
+{
+	MsgBuf	*mb;
+	int		i;
+
+	for (i = 0 ; i < HIST_LEN ; i++)  {
+		if ((mb = atomic_exchange(&h->slot[i].mb, NULL)) != NULL)
+			mbUnref(mb);
+		atomic_store(&h->slot[i].seq, -1);
+	}
+}
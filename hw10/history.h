@@ -0,0 +1,39 @@
+/*===============================================================
+[Program Name] : history.h
+[Description]  :
+    - 방별 최근 메시지 기록(History) 선언.
+    - 크기가 고정된 ring에 브로드캐스트한 MsgBuf의 참조를 보관하고,
+      늦게 들어온 클라이언트에게 같은 버퍼를 그대로 다시 보낸다
+      (복사 없음, 참조만 늘림).
+    - lock을 쓰지 않는다. 쓰는 쪽은 atomic 순번으로 칸을 정하고,
+      읽는 쪽은 칸의 순번을 전후로 확인하여 덮어쓰인 칸을 건너뛴다.
+[특기사항]     :
+    - 함수 정의는 history.c에 있음.
+==================================================================*/
+
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <stdatomic.h>
+#include "msgbuf.h"
+
+#define	HIST_LEN		64			// 방마다 보관하는 최근 메시지 수 (2의 거듭제곱)
+
+typedef struct  {
+	atomic_long		seq;			// 이 칸에 들어 있는 메시지의 순번 (쓰는 중이면 -1)
+	MsgBuf *_Atomic	mb;
+}
+	HistSlot;
+
+typedef struct  {
+	atomic_long		head;			// 다음에 쓸 순번
+	HistSlot		slot[HIST_LEN];
+}
+	History;
+
+void	hsInit(History *h);
+void	hsPush(History *h, MsgBuf *mb);
+int		hsRecent(History *h, int n, MsgBuf **out);
+void	hsDestroy(History *h);
+
+#endif
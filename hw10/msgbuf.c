@@ -0,0 +1,207 @@
+/*===============================================================
+[Program Name] : msgbuf.c
+[Description]  :
+    - 참조 카운트 메시지 버퍼 풀 구현.
+    - mbAlloc()은 풀의 free list에서 버퍼를 꺼내고 (비었으면 MB_GROW개를
+      한번에 malloc), mbUnref()로 마지막 참조가 반납되면 풀로 돌려준다.
+      메시지마다 malloc()/free()를 하지 않는다.
+[Input]        :
+    MsgBuf *mb;       // 메시지 버퍼
+[Output]       :
+    mbAlloc()은 refcnt가 1인 버퍼, 실패 시 NULL
+[Calls]        :
+    malloc(), pthread_mutex_lock(), pthread_mutex_unlock(), sendmsg()
+[특기사항]     :
+    - refcnt는 atomic 연산으로 바꾸므로 여러 스레드가 같은 버퍼를
+      동시에 참조/반납할 수 있다. free list만 PoolLock으로 보호.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "msgbuf.h"
+
+static pthread_mutex_t	PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static MsgBuf			*FreeList;
+static int				NFree;
+
+/*===============================================================
+[Function Name] : MsgBuf *mbAlloc(void)
+[Description]   :
+    - 풀에서 버퍼를 하나 꺼내 refcnt를 1로 설정
+    - 풀이 비어 있으면 MB_GROW개를 한번에 할당하여 채운다.
+[Input]         : 없음
+[Output]        : 없음
+[Calls]         : malloc()
+[Given]         : 없음
+[Returns]       : MsgBuf *; 실패 시 NULL
+==================================================================*/
+MsgBuf *mbAlloc(void)
+{
+	MsgBuf	*mb;
+	int		i;
+
+	pthread_mutex_lock(&PoolLock);
+	if (FreeList == NULL)  {
+		if ((mb = malloc(MB_GROW * sizeof(MsgBuf))) == NULL)  {
+			pthread_mutex_unlock(&PoolLock);
+			perror("malloc");
+			return NULL;
+		}
+		for (i = 0 ; i < MB_GROW ; i++)  {
+			mb[i].next = FreeList;
+			FreeList = &mb[i];
+		}
+		NFree += MB_GROW;
+	}
+	mb = FreeList;
+	FreeList = mb->next;
+	NFree--;
+	pthread_mutex_unlock(&PoolLock);
+
+	atomic_store_explicit(&mb->refcnt, 1, memory_order_relaxed);	// mbTryRef()와 경쟁할 수 있음
+	mb->len = 0;
+	mb->next = NULL;
+
+	return mb;
+}
+
+/*===============================================================
+[Function Name] : void mbRef(MsgBuf *mb)
+[Description]   :
+    - 버퍼 참조를 하나 늘린다. (수신자 대기열에 넣을 때마다 호출)
+[Input]         :
+    MsgBuf *mb;       // 메시지 버퍼
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : mb의 참조를 이미 가지고 있어야 함
+[Returns]       : 없음
+==================================================================*/
+void mbRef(MsgBuf *mb)
+{
+	atomic_fetch_add_explicit(&mb->refcnt, 1, memory_order_relaxed);
+}
+
+/*===============================================================
+[Function Name] : int mbTryRef(MsgBuf *mb)
+[Description]   :
+    - 버퍼가 아직 사용 중(refcnt > 0)일 때만 참조를 하나 늘린다.
+      이미 풀로 돌아간 버퍼의 refcnt를 되살리지 않는다.
+[Input]         :
+    MsgBuf *mb;       // 메시지 버퍼 (다른 쪽이 반납했을 수도 있음)
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 풀의 버퍼는 free()되지 않으므로 mb를 읽는 것은 안전
+[Returns]       : int; 참조를 얻었으면 1, 이미 반납된 버퍼이면 0
+==================================================================*/
+int mbTryRef(MsgBuf *mb)
+{
+	int		n = atomic_load_explicit(&mb->refcnt, memory_order_relaxed);
+
+	do  {
+		if (n == 0)
+			return 0;
+	} while (! atomic_compare_exchange_weak_explicit(&mb->refcnt, &n, n + 1,
+													  memory_order_acquire, memory_order_relaxed));
+	return 1;
+}
+
+/*===============================================================
+[Function Name] : void mbUnref(MsgBuf *mb)
+[Description]   :
+    - 버퍼 참조를 반납. 마지막 참조이면 풀로 돌려준다.
+[Input]         :
+    MsgBuf *mb;       // 메시지 버퍼
+[Output]        : 없음
+[Calls]         : pthread_mutex_lock(), pthread_mutex_unlock()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void mbUnref(MsgBuf *mb)
+{
+	if (atomic_fetch_sub_explicit(&mb->refcnt, 1, memory_order_acq_rel) != 1)
+		return;
+
+	pthread_mutex_lock(&PoolLock);
+	mb->next = FreeList;
+	FreeList = mb;
+	NFree++;
+	pthread_mutex_unlock(&PoolLock);
+}
+
+/*===============================================================
+[Function Name] : int mbPoolFree(void)
+[Description]   :
+    - 풀에 남아 있는 (사용 중이 아닌) 버퍼 수 (디버깅/통계용)
+[Input]         : 없음
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : int; 풀의 빈 버퍼 수
+==================================================================*/
+int mbPoolFree(void)
+{
+	int		n;
+
+	pthread_mutex_lock(&PoolLock);
+	n = NFree;
+	pthread_mutex_unlock(&PoolLock);
+
+	return n;
+}
+
+/*===============================================================
+[Function Name] : ssize_t mbSendQueue(int fd, OutQueue *q, int *off)
+[Description]   :
+    - 대기열 앞쪽의 버퍼들(최대 MB_IOV_MAX개)을 iovec으로 묶어
+      sendmsg()를 한 번 호출한다. 메시지마다 send()하지 않는다.
+    - 다 보낸 버퍼는 대기열에서 꺼내 참조를 반납하고, 일부만 보낸
+      버퍼는 대기열에 남겨 *off에 보낸 바이트 수를 기록한다.
+[Input]         :
+    int fd;           // 소켓
+    OutQueue *q;      // MsgBuf *를 담은 송신 대기열
+    int *off;         // 맨 앞 버퍼에서 이미 보낸 바이트 수 (갱신됨)
+[Output]        : 없음
+[Calls]         : oqPeek(), oqPop(), sendmsg(), mbUnref()
+[Given]         : 대기열은 호출하는 쪽에서 보호
+[Returns]       : ssize_t; 보낸 바이트 수 (대기열이 비었으면 0), 실패 시 -1 (errno 참조)
+==================================================================*/
+ssize_t mbSendQueue(int fd, OutQueue *q, int *off)
+{
+	struct iovec	iov[MB_IOV_MAX];
+	struct msghdr	msg;
+	MsgBuf			*mb;
+	ssize_t			n, left;
+	int				cnt;
+
+	for (cnt = 0 ; cnt < MB_IOV_MAX && (mb = oqPeek(q, cnt)) != NULL ; cnt++)  {
+		iov[cnt].iov_base = mb->data;
+		iov[cnt].iov_len  = mb->len;
+	}
+	if (cnt == 0)
+		return 0;
+	iov[0].iov_base = (char *)iov[0].iov_base + *off;
+	iov[0].iov_len -= *off;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov    = iov;
+	msg.msg_iovlen = cnt;
+	while ((n = sendmsg(fd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+		;
+	if (n < 0)
+		return -1;
+
+	// 다 보낸 버퍼를 꺼낸다 (*off는 첫 버퍼의 시작부터 센다)
+	left = n + *off;
+	while ((mb = oqPeek(q, 0)) != NULL && left >= mb->len)  {
+		left -= mb->len;
+		mbUnref(oqPop(q));
+	}
+	*off = left;
+
+	return n;
+}
@@ -0,0 +1,40 @@
+/*===============================================================
+[Program Name] : msgbuf.h
+[Description]  :
+    - 참조 카운트를 가진 메시지 버퍼(MsgBuf)와 버퍼 풀 선언.
+    - 브로드캐스트 메시지는 한 번만 만들어 같은 버퍼를 여러 수신자의
+      송신 대기열에 넣고, 마지막 송신이 끝나면 풀로 돌아간다.
+[특기사항]     :
+    - 함수 정의는 msgbuf.c에 있음.
+    - 풀에서 꺼낸 버퍼는 다시 free()되지 않고 풀 안에서만 재사용된다.
+    - mbSendQueue()는 송신 대기열(OutQueue)에 쌓인 버퍼들을 한 번의
+      sendmsg()로 보낸다 (연결별 출력 합치기).
+==================================================================*/
+
+#ifndef _MSGBUF_H_
+#define _MSGBUF_H_
+
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "outq.h"
+
+#define	MB_DATA_SIZE	496			// sizeof(MsgBuf) == 512
+#define	MB_GROW			64			// 풀이 비었을 때 한번에 늘리는 버퍼 수
+#define	MB_IOV_MAX		64			// mbSendQueue() 한 번에 보내는 최대 버퍼 수
+
+typedef struct MsgBuf  {
+	atomic_int		refcnt;
+	int				len;			// data에 들어 있는 바이트 수
+	struct MsgBuf	*next;			// 풀의 free list
+	char			data[MB_DATA_SIZE];
+}
+	MsgBuf;
+
+MsgBuf	*mbAlloc(void);
+void	mbRef(MsgBuf *mb);
+int		mbTryRef(MsgBuf *mb);
+void	mbUnref(MsgBuf *mb);
+int		mbPoolFree(void);
+ssize_t	mbSendQueue(int fd, OutQueue *q, int *off);
+
+#endif
@@ -0,0 +1,160 @@
+/*===============================================================
+[Program Name] : outq.c
+[Description]  :
+    - 클라이언트별 송신 대기열 구현 (크기 제한이 있는 원형 버퍼).
+    - 대기열이 가득 차면 oqPush()가 실패하므로 송신자는 느린
+      수신자 때문에 블록되지 않는다.
+[Input]        :
+    OutQueue *q;      // 송신 대기열
+    void *p;          // 보낼 메시지 포인터
+[Output]       :
+    함수 성공 시 0 또는 메시지 포인터, 실패 시 -1 또는 NULL
+[Calls]        :
+    calloc(), free()
+[특기사항]     :
+    - lock은 호출하는 쪽의 책임 (outq.h 참조)
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "outq.h"
+
+/*===============================================================
+[Function Name] : int oqInit(OutQueue *q, int size)
+[Description]   :
+    - 최대 size개의 메시지를 담는 빈 대기열을 만든다.
+[Input]         :
+    OutQueue *q;      // 초기화할 대기열
+    int size;         // 최대 원소 수
+[Output]        : 없음
+[Calls]         : calloc()
+[Given]         : size > 0
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int oqInit(OutQueue *q, int size)
+{
+	if ((q->item = calloc(size, sizeof(void *))) == NULL)  {
+		perror("calloc");
+		return -1;
+	}
+	q->size = size;
+	q->head = 0;
+	q->count = 0;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int oqPush(OutQueue *q, void *p)
+[Description]   :
+    - 대기열 끝에 메시지를 추가
+[Input]         :
+    OutQueue *q;      // 대기열
+    void *p;          // 메시지 포인터
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : int; 성공 0, 가득 찬 경우 -1
+==================================================================*/
+int oqPush(OutQueue *q, void *p)
+{
+	if (oqIsFull(q))
+		return -1;
+
+	q->item[(q->head + q->count) % q->size] = p;
+	q->count++;
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : void *oqPop(OutQueue *q)
+[Description]   :
+    - 대기열 맨 앞의 메시지를 꺼낸다.
+[Input]         :
+    OutQueue *q;      // 대기열
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : void *; 메시지 포인터, 비어 있으면 NULL
+==================================================================*/
+void *oqPop(OutQueue *q)
+{
+	void	*p;
+
+	if (oqIsEmpty(q))
+		return NULL;
+
+	p = q->item[q->head];
+	q->head = (q->head + 1) % q->size;
+	q->count--;
+
+	return p;
+}
+
+/*===============================================================
+[Function Name] : void *oqRemove(OutQueue *q, int i)
+[Description]   :
+    - 앞에서 i번째 메시지를 빼낸다. 앞쪽 i개를 한 칸씩 뒤로 옮기므로
+      i가 작을 때 (오래된 메시지를 버릴 때) 싸다.
+[Input]         :
+    OutQueue *q;      // 대기열
+    int i;            // 0부터 시작하는 위치
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : void *; 메시지 포인터, 범위를 벗어나면 NULL
+==================================================================*/
+void *oqRemove(OutQueue *q, int i)
+{
+	void	*p;
+
+	if (i < 0 || i >= q->count)
+		return NULL;
+
+	p = q->item[(q->head + i) % q->size];
+	for ( ; i > 0 ; i--)
+		q->item[(q->head + i) % q->size] = q->item[(q->head + i - 1) % q->size];
+	q->head = (q->head + 1) % q->size;
+	q->count--;
+
+	return p;
+}
+
+/*===============================================================
+[Function Name] : void *oqPeek(OutQueue *q, int i)
+[Description]   :
+    - 꺼내지 않고 앞에서 i번째 메시지를 본다.
+[Input]         :
+    OutQueue *q;      // 대기열
+    int i;            // 0부터 시작하는 위치
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : void *; 메시지 포인터, 범위를 벗어나면 NULL
+==================================================================*/
+void *oqPeek(OutQueue *q, int i)
+{
+	if (i < 0 || i >= q->count)
+		return NULL;
+
+	return q->item[(q->head + i) % q->size];
+}
+
+/*===============================================================
+[Function Name] : void oqDestroy(OutQueue *q)
+[Description]   :
+    - 대기열 메모리를 해제 (남은 메시지는 호출하는 쪽에서 먼저 꺼내야 함)
+[Input]         :
+    OutQueue *q;      // 대기열
+[Output]        : 없음
+[Calls]         : free()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void oqDestroy(OutQueue *q)
+{
+	free(q->item);
+	q->item = NULL;
+	q->size = q->count = q->head = 0;
+}
@@ -0,0 +1,34 @@
+/*===============================================================
+[Program Name] : outq.h
+[Description]  :
+    - 클라이언트별 송신 대기열(OutQueue) 선언.
+    - 크기가 정해진 원형 버퍼에 보낼 메시지 포인터를 쌓는다.
+[특기사항]     :
+    - 함수 정의는 outq.c에 있음.
+    - 대기열 자체는 lock을 잡지 않으므로 여러 스레드가 쓰는 경우
+      호출하는 쪽에서 보호해야 한다.
+==================================================================*/
+
+#ifndef _OUTQ_H_
+#define _OUTQ_H_
+
+typedef struct  {
+	void	**item;
+	int		size;		// 최대 원소 수 (high-water mark)
+	int		head;		// 다음에 꺼낼 위치
+	int		count;		// 현재 원소 수
+}
+	OutQueue;
+
+int		oqInit(OutQueue *q, int size);
+int		oqPush(OutQueue *q, void *p);
+void	*oqPop(OutQueue *q);
+void	*oqPeek(OutQueue *q, int i);
+void	*oqRemove(OutQueue *q, int i);
+void	oqDestroy(OutQueue *q);
+
+#define	oqCount(q)		((q)->count)
+#define	oqIsFull(q)		((q)->count == (q)->size)
+#define	oqIsEmpty(q)	((q)->count == 0)
+
+#endif
@@ -0,0 +1,141 @@
+/*===============================================================
+[Program Name] : room.c
+[Description]  :
+    - 채팅방 해시 인덱스 구현. 방 이름의 FNV-1a 해시로 버킷을 고르고
+      같은 버킷의 방들은 단일 연결 리스트로 잇는다.
+    - 수천 개의 방이 있어도 방을 찾는 비용은 버킷 하나의 길이뿐이다.
+[Input]        :
+    RoomTab *rt;      // 방 인덱스
+    const char *name; // 방 이름
+[Output]       :
+    Room 포인터, 없거나 실패 시 NULL
+[Calls]        :
+    calloc(), free(), strncpy(), strcmp()
+[특기사항]     :
+    - lock은 호출하는 쪽의 책임 (room.h 참조)
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "room.h"
+
+/*===============================================================
+[Function Name] : static unsigned rtHash(const char *name)
+[Description]   :
+    - 방 이름의 FNV-1a 해시로 버킷 번호를 계산
+[Input]         :
+    const char *name; // 방 이름
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : unsigned; 버킷 번호 (0 ~ ROOM_HASH-1)
+==================================================================*/
+static unsigned rtHash(const char *name)
+{
+	unsigned	h = 2166136261u;
+
+	while (*name)  {
+		h ^= (unsigned char)*name++;
+		h *= 16777619u;
+	}
+
+	return h & (ROOM_HASH - 1);
+}
+
+/*===============================================================
+[Function Name] : void rtInit(RoomTab *rt)
+[Description]   :
+    - 빈 방 인덱스로 초기화
+[Input]         :
+    RoomTab *rt;      // 방 인덱스
+[Output]        : 없음
+[Calls]         : memset()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void rtInit(RoomTab *rt)
+{
+	memset(rt, 0, sizeof(RoomTab));
+}
+
+/*===============================================================
+[Function Name] : Room *rtFind(RoomTab *rt, const char *name)
+[Description]   :
+    - 이름으로 방을 찾는다.
+[Input]         :
+    RoomTab *rt;      // 방 인덱스
+    const char *name; // 방 이름
+[Output]        : 없음
+[Calls]         : rtHash(), strcmp()
+[Given]         : 없음
+[Returns]       : Room *; 없으면 NULL
+==================================================================*/
+Room *rtFind(RoomTab *rt, const char *name)
+{
+	Room	*room;
+
+	for (room = rt->bucket[rtHash(name)] ; room ; room = room->next)  {
+		if (strcmp(room->name, name) == 0)
+			return room;
+	}
+
+	return NULL;
+}
+
+/*===============================================================
+[Function Name] : Room *rtCreate(RoomTab *rt, const char *name)
+[Description]   :
+    - 새 방을 만들어 인덱스에 넣는다. 이름은 MAX_ROOM-1자로 자른다.
+[Input]         :
+    RoomTab *rt;      // 방 인덱스
+    const char *name; // 방 이름
+[Output]        : 없음
+[Calls]         : calloc(), strncpy(), rtHash()
+[Given]         : 같은 이름의 방이 없어야 함 (rtFind()로 먼저 확인)
+[Returns]       : Room *; 실패 시 NULL
+==================================================================*/
+Room *rtCreate(RoomTab *rt, const char *name)
+{
+	Room		*room;
+	unsigned	h;
+
+	if ((room = calloc(1, sizeof(Room))) == NULL)  {
+		perror("calloc");
+		return NULL;
+	}
+	strncpy(room->name, name, MAX_ROOM - 1);
+
+	h = rtHash(room->name);
+	room->next = rt->bucket[h];
+	rt->bucket[h] = room;
+	rt->nRooms++;
+
+	return room;
+}
+
+/*===============================================================
+[Function Name] : void rtRemove(RoomTab *rt, Room *room)
+[Description]   :
+    - 방을 인덱스에서 빼고 해제한다. (members, history는 호출하는 쪽에서 먼저 정리)
+[Input]         :
+    RoomTab *rt;      // 방 인덱스
+    Room *room;       // 지울 방
+[Output]        : 없음
+[Calls]         : rtHash(), free()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void rtRemove(RoomTab *rt, Room *room)
+{
+	Room	**pp;
+
+	for (pp = &rt->bucket[rtHash(room->name)] ; *pp ; pp = &(*pp)->next)  {
+		if (*pp == room)  {
+			*pp = room->next;
+			rt->nRooms--;
+			free(room);
+			return;
+		}
+	}
+}
@@ -0,0 +1,40 @@
+/*===============================================================
+[Program Name] : room.h
+[Description]  :
+    - 채팅방(Room) 이름 -> 방 구조체 해시 인덱스(RoomTab) 선언.
+    - 방마다 구독자(접속자) 목록과 인원 수를 가지며, 목록의 실제
+      형태(스냅샷)는 서버가 정한다 (members는 서버가 해석).
+      최근 메시지 기록(history)도 같은 방식으로 서버가 붙인다.
+[특기사항]     :
+    - 함수 정의는 room.c에 있음.
+    - 동기화는 하지 않으므로 여러 스레드가 쓰는 경우 호출하는 쪽에서 lock.
+==================================================================*/
+
+#ifndef _ROOM_H_
+#define _ROOM_H_
+
+#define	MAX_ROOM		32			// 방 이름 최대 길이 (NUL 포함)
+#define	ROOM_HASH		4096		// 해시 버킷 수 (2의 거듭제곱)
+#define	LOBBY			"lobby"		// 로그인 직후 들어가는 기본 방
+
+typedef struct Room  {
+	char		name[MAX_ROOM];
+	int			nMembers;
+	void		*members;		// 서버가 관리하는 구독자 목록
+	void		*history;		// 서버가 관리하는 최근 메시지 기록
+	struct Room	*next;			// 같은 버킷의 다음 방
+}
+	Room;
+
+typedef struct  {
+	Room		*bucket[ROOM_HASH];
+	int			nRooms;
+}
+	RoomTab;
+
+void	rtInit(RoomTab *rt);
+Room	*rtFind(RoomTab *rt, const char *name);
+Room	*rtCreate(RoomTab *rt, const char *name);
+void	rtRemove(RoomTab *rt, Room *room);
+
+#endif
@@ -0,0 +1,326 @@
+/*===============================================================
+[Program Name] : shmbus.c
+[Description]  :
+    - POSIX 공유 메모리 MPMC 브로드캐스트 버스 구현.
+    - 처음 여는 프로세스가 O_EXCL로 공유 메모리를 만들고 초기화한 뒤
+      magic을 기록한다. 나중에 여는 프로세스는 magic이 보일 때까지 기다린다.
+    - 메시지 하나는 보낼 때 칸으로 한 번, 받을 때 칸에서 한 번 복사된다.
+[Input]        :
+    ShmBus *bus;      // 프로세스별 버스 핸들
+[Output]       :
+    다른 프로세스가 보낸 메시지 (kind, key, data)
+[Calls]        :
+    shm_open(), ftruncate(), mmap(), munmap(), shm_unlink(),
+    pthread_mutex_lock(), pthread_cond_timedwait(), pthread_cond_broadcast()
+[특기사항]     :
+    - 칸의 데이터는 seqlock으로 보호하므로 생산자와 소비자 사이에 lock이 없다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmbus.h"
+
+#define	SB_MASK		(SB_SLOTS - 1)
+
+/*===============================================================
+[Function Name] : static void sbInitShared(SbShared *sh)
+[Description]   :
+    - 새로 만든 공유 영역의 뮤텍스/조건 변수를 process-shared로 초기화하고
+      magic을 기록한다. 뮤텍스는 robust로 만들어 잡은 채로 죽은
+      프로세스가 있어도 다른 프로세스가 이어서 쓸 수 있게 한다.
+[Input]         :
+    SbShared *sh;     // 0으로 채워진 공유 영역 (ftruncate 직후)
+[Output]        : 없음
+[Calls]         : pthread_mutexattr_setpshared(), pthread_mutexattr_setrobust(),
+                  pthread_condattr_setpshared(), pthread_condattr_setclock()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+static void sbInitShared(SbShared *sh)
+{
+	pthread_mutexattr_t	mutexAttr;
+	pthread_condattr_t	condAttr;
+
+	pthread_mutexattr_init(&mutexAttr);
+	pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&sh->lock, &mutexAttr);
+	pthread_mutexattr_destroy(&mutexAttr);
+
+	pthread_condattr_init(&condAttr);
+	pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+	pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+	pthread_cond_init(&sh->cond, &condAttr);
+	pthread_condattr_destroy(&condAttr);
+
+	sh->nslots = SB_SLOTS;
+	atomic_store_explicit(&sh->magic, SB_MAGIC, memory_order_release);
+}
+
+/*===============================================================
+[Function Name] : int sbOpen(ShmBus *bus, const char *name)
+[Description]   :
+    - name 공유 메모리 버스를 열고(없으면 만들고) mmap한다.
+    - 지금의 head부터 읽으므로 연 뒤에 보내진 메시지만 받는다.
+[Input]         :
+    ShmBus *bus;      // 초기화할 버스 핸들
+    const char *name; // shm 이름 ("/chatbus"처럼 '/'로 시작)
+[Output]        : 없음
+[Calls]         : shm_open(), ftruncate(), fstat(), mmap(), sbInitShared()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int sbOpen(ShmBus *bus, const char *name)
+{
+	struct stat	st;
+	void		*p;
+	int			fd, created = 1, i;
+
+	memset(bus, 0, sizeof(ShmBus));
+	snprintf(bus->name, sizeof(bus->name), "%s", name);
+
+	if ((fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666)) < 0)  {
+		if (errno != EEXIST || (fd = shm_open(name, O_RDWR, 0666)) < 0)  {
+			perror("shm_open");
+			return -1;
+		}
+		created = 0;
+	}
+	if (created && ftruncate(fd, sizeof(SbShared)) < 0)  {
+		perror("ftruncate");
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+	// 다른 프로세스가 막 만든 경우 크기가 잡힐 때까지 기다림
+	for (i = 0 ; ! created && i < 1000 ; i++)  {
+		if (fstat(fd, &st) == 0 && st.st_size == sizeof(SbShared))
+			break;
+		usleep(1000);
+	}
+	if (! created && st.st_size != sizeof(SbShared))  {
+		fprintf(stderr, "%s: shared memory has a different layout\n", name);
+		close(fd);
+		return -1;
+	}
+
+	p = mmap(NULL, sizeof(SbShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)  {
+		perror("mmap");
+		return -1;
+	}
+	bus->sh = p;
+
+	if (created)
+		sbInitShared(bus->sh);
+	for (i = 0 ; atomic_load_explicit(&bus->sh->magic, memory_order_acquire) != SB_MAGIC ; i++)  {
+		if (i == 1000)  {
+			fprintf(stderr, "%s: bus was never initialized\n", name);
+			munmap(p, sizeof(SbShared));
+			return -1;
+		}
+		usleep(1000);
+	}
+
+	atomic_fetch_add(&bus->sh->users, 1);
+	bus->self = getpid();
+	bus->cursor = atomic_load(&bus->sh->head);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int sbPublish(ShmBus *bus, int kind, const char *key,
+                                const void *data, int len)
+[Description]   :
+    - 칸 하나를 얻어 메시지를 복사하고 공개한다. 소비자를 기다리지 않는다.
+    - 잠든 소비자가 있으면 조건 변수로 깨운다.
+[Input]         :
+    ShmBus *bus;      // 버스
+    int kind;         // 종류
+    const char *key;  // key (SB_KEY-1자까지)
+    const void *data; // 데이터
+    int len;          // 데이터 길이 (SB_DATA 이하)
+[Output]        : 없음
+[Calls]         : memcpy(), pthread_mutex_lock(), pthread_cond_broadcast()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 너무 길면 -1
+==================================================================*/
+int sbPublish(ShmBus *bus, int kind, const char *key, const void *data, int len)
+{
+	SbShared		*sh = bus->sh;
+	SbSlot			*s;
+	unsigned long	pos;
+
+	if (len < 0 || len > SB_DATA)
+		return -1;
+
+	pos = atomic_fetch_add(&sh->head, 1);
+	s = &sh->slot[pos & SB_MASK];
+	atomic_store_explicit(&s->seq, 2 * pos + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);	// "쓰는 중"이 데이터보다 먼저 보이도록
+
+	s->src = bus->self;
+	s->kind = kind;
+	s->len = len;
+	snprintf(s->key, SB_KEY, "%s", key);
+	memcpy(s->data, data, len);
+	atomic_store_explicit(&s->seq, 2 * pos + 2, memory_order_release);
+
+	if (atomic_load(&sh->waiters) > 0)  {
+		if (pthread_mutex_lock(&sh->lock) == EOWNERDEAD)
+			pthread_mutex_consistent(&sh->lock);
+		pthread_cond_broadcast(&sh->cond);
+		pthread_mutex_unlock(&sh->lock);
+	}
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : int sbRead(ShmBus *bus, int *kind, char *key, void *data, int size)
+[Description]   :
+    - 다른 프로세스가 보낸 다음 메시지를 data로 복사한다.
+      이 프로세스가 보낸 메시지는 건너뛴다.
+    - SB_SLOTS 이상 뒤처졌거나 읽는 동안 덮어써진 메시지는 lost로 센다.
+    - 다음 칸을 아직 쓰는 중이면 0을 리턴한다. 생산자가 쓰는 도중에 죽어
+      그 칸이 공개되지 않으면, head가 반 바퀴 앞서 갔을 때 건너뛴다.
+[Input]         :
+    ShmBus *bus;      // 버스
+    int *kind;        // 종류
+    char *key;        // key (SB_KEY 바이트 이상)
+    void *data;       // 데이터 버퍼
+    int size;         // data 크기 (더 긴 메시지는 건너뛰고 lost로 셈)
+[Output]        : 없음
+[Calls]         : memcpy()
+[Given]         : 이 프로세스에서 한 스레드만 호출
+[Returns]       : int; 데이터 길이 (> 0), 읽을 것이 없으면 0
+==================================================================*/
+int sbRead(ShmBus *bus, int *kind, char *key, void *data, int size)
+{
+	SbShared		*sh = bus->sh;
+	SbSlot			*s;
+	unsigned long	head, pos, seq;
+	int				len, src;
+
+	while (1)  {
+		pos = bus->cursor;
+		head = atomic_load_explicit(&sh->head, memory_order_acquire);
+		if (pos == head)
+			return 0;
+		if (head - pos > SB_SLOTS)  {
+			// 한 바퀴 넘게 뒤처짐: 남아 있는 가장 오래된 칸부터
+			bus->lost += head - pos - SB_SLOTS;
+			bus->cursor = head - SB_SLOTS;
+			continue;
+		}
+
+		s = &sh->slot[pos & SB_MASK];
+		seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+		if (seq < 2 * pos + 2)  {
+			if (head - pos < SB_SLOTS / 2)
+				return 0;				// 아직 쓰는 중
+			bus->lost++;				// 쓰다가 멈춘 칸
+			bus->cursor++;
+			continue;
+		}
+		if (seq > 2 * pos + 2)  {		// 이미 덮어써짐
+			bus->lost++;
+			bus->cursor++;
+			continue;
+		}
+
+		src = s->src;
+		len = s->len;
+		*kind = s->kind;
+		if (len > 0 && len <= size)  {
+			memcpy(key, s->key, SB_KEY);
+			memcpy(data, s->data, len);
+		}
+		atomic_thread_fence(memory_order_acquire);
+		bus->cursor++;
+		if (atomic_load_explicit(&s->seq, memory_order_relaxed) != seq || len <= 0 || len > size)  {
+			bus->lost++;				// 복사하는 동안 덮어써짐
+			continue;
+		}
+		if (src == bus->self)
+			continue;
+		key[SB_KEY - 1] = '\0';
+
+		return len;
+	}
+}
+
+/*===============================================================
+[Function Name] : void sbWait(ShmBus *bus, int ms)
+[Description]   :
+    - 읽을 메시지가 생길 때까지 최대 ms 동안 잠든다.
+      head가 이미 앞서 있으면(생산자가 쓰는 중) 양보만 하고 돌아온다.
+[Input]         :
+    ShmBus *bus;      // 버스
+    int ms;           // 최대 대기 시간
+[Output]        : 없음
+[Calls]         : sched_yield(), clock_gettime(), pthread_mutex_lock(),
+                  pthread_cond_timedwait(), pthread_mutex_consistent()
+[Given]         : sbRead()와 같은 스레드에서 호출
+[Returns]       : 없음
+==================================================================*/
+void sbWait(ShmBus *bus, int ms)
+{
+	SbShared		*sh = bus->sh;
+	struct timespec	ts;
+
+	if (atomic_load(&sh->head) != bus->cursor)  {
+		sched_yield();
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L)  {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+
+	if (pthread_mutex_lock(&sh->lock) == EOWNERDEAD)
+		pthread_mutex_consistent(&sh->lock);
+	atomic_fetch_add(&sh->waiters, 1);
+	// waiters를 늘린 뒤에 다시 보므로 그 사이에 공개된 메시지를 놓치지 않음
+	while (atomic_load(&sh->head) == bus->cursor)  {
+		if (pthread_cond_timedwait(&sh->cond, &sh->lock, &ts) == ETIMEDOUT)
+			break;
+	}
+	atomic_fetch_sub(&sh->waiters, 1);
+	pthread_mutex_unlock(&sh->lock);
+}
+
+/*===============================================================
+[Function Name] : void sbClose(ShmBus *bus)
+[Description]   :
+    - 버스를 munmap한다. 마지막 프로세스이면 공유 메모리를 지운다.
+[Input]         :
+    ShmBus *bus;      // 버스
+[Output]        : 없음
+[Calls]         : munmap(), shm_unlink()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void sbClose(ShmBus *bus)
+{
+	if (bus->sh == NULL)
+		return;
+	if (atomic_fetch_sub(&bus->sh->users, 1) == 1)
+		shm_unlink(bus->name);
+	munmap(bus->sh, sizeof(SbShared));
+	bus->sh = NULL;
+}
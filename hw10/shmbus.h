@@ -0,0 +1,73 @@
+/*===============================================================
+[Program Name] : shmbus.h
+[Description]  :
+    - 한 호스트의 채팅 서버 프로세스들이 브로드캐스트를 주고받는
+      POSIX 공유 메모리 메시지 버스 선언. (hw08/hw3/sipc1.c와 같이
+      shm_open() + ftruncate() + mmap(MAP_SHARED)으로 만든다.)
+    - 버스는 SB_SLOTS칸 원형 버퍼 하나이다. 생산자(여러 프로세스의 여러
+      스레드)는 head를 atomic하게 늘려 칸을 얻고, 그 칸에 한 번 복사한 뒤
+      칸의 seq로 공개한다. 소비자는 프로세스마다 자기 cursor로 모든
+      메시지를 읽으므로(fan-out) 생산자는 소비자를 기다리지 않는다.
+    - 칸마다 seq를 seqlock으로 쓴다: 쓰는 중 2*pos+1, 다 쓰면 2*pos+2.
+      읽는 쪽은 복사 전후의 seq가 같을 때만 받아들인다.
+    - 소비자가 SB_SLOTS 이상 뒤처지면 덮어써진 메시지는 건너뛰고 lost로 센다.
+    - 읽을 것이 없는 소비자는 공유 영역의 process-shared 뮤텍스/조건 변수로
+      잠든다. 생산자는 잠든 소비자가 있을 때만 깨운다.
+[특기사항]     :
+    - 함수 정의는 shmbus.c에 있음.
+    - 한 프로세스에서 sbRead()/sbWait()는 한 스레드만 부른다. (cursor)
+      sbPublish()는 어느 스레드에서나 부를 수 있다.
+    - 마지막으로 닫는 프로세스가 공유 메모리를 지운다. 비정상 종료로 남은
+      버스는 다음 프로세스가 그대로 다시 쓴다.
+==================================================================*/
+
+#ifndef _SHMBUS_H_
+#define _SHMBUS_H_
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "clienttab.h"
+
+#define	SB_SLOTS		4096		// 원형 버퍼 칸 수 (2의 거듭제곱)
+#define	SB_KEY			32			// 칸의 key (방 이름 등, NUL 포함)
+#define	SB_DATA			512			// 칸 하나의 최대 데이터 크기
+#define	SB_MAGIC		0x43425553	// 초기화가 끝난 버스 표시
+
+typedef struct  {
+	_Alignas(CACHE_LINE) atomic_ulong	seq;	// 2*pos+1: 쓰는 중, 2*pos+2: pos 공개됨
+	int				src;			// 보낸 버스 참여자 id
+	int				kind;			// 사용하는 쪽이 정하는 종류
+	int				len;			// data 길이
+	char			key[SB_KEY];
+	char			data[SB_DATA];
+}
+	SbSlot;
+
+typedef struct  {
+	atomic_uint		magic;			// SB_MAGIC이면 초기화 끝
+	unsigned		nslots;
+	atomic_int		users;			// 버스를 연 프로세스 수
+	pthread_mutex_t	lock;			// 잠들기/깨우기에만 사용 (process-shared, robust)
+	pthread_cond_t	cond;
+	atomic_int		waiters;		// 잠든 소비자 수
+	_Alignas(CACHE_LINE) atomic_ulong	head;	// 다음에 생산자가 얻을 위치
+	SbSlot			slot[SB_SLOTS];
+}
+	SbShared;
+
+typedef struct  {
+	SbShared		*sh;			// mmap한 공유 영역
+	char			name[64];		// shm 이름 ("/chatbus" 등)
+	unsigned long	cursor;			// 이 프로세스가 다음에 읽을 위치
+	int				self;			// 이 프로세스의 참여자 id (자기 메시지는 읽지 않음)
+	long			lost;			// 덮어써져 읽지 못한 메시지 수
+}
+	ShmBus;
+
+int		sbOpen(ShmBus *bus, const char *name);
+int		sbPublish(ShmBus *bus, int kind, const char *key, const void *data, int len);
+int		sbRead(ShmBus *bus, int *kind, char *key, void *data, int size);
+void	sbWait(ShmBus *bus, int ms);
+void	sbClose(ShmBus *bus);
+
+#endif
@@ -0,0 +1,362 @@
+/*===============================================================
+[Program Name] : stats.c
+[Description]  :
+    - 스레드별 통계 카운터와 관리 스레드 구현.
+    - 관리 스레드는 signalfd(SIGUSR1)와 관리 소켓을 poll()로 기다렸다가
+      슬롯을 모두 더한 보고서를 만든다. 카운터를 쓰는 스레드와는
+      아무것도 공유하지 않으므로 보고가 처리 경로를 멈추지 않는다.
+[Input]        :
+    StTable *t;       // 통계 테이블
+[Output]       :
+    스레드별/전체 카운터와 지난 보고 이후의 초당 비율
+[Calls]        :
+    posix_memalign(), signalfd(), socket(), bind(), poll(), accept(), pthread_create()
+[특기사항]     :
+    - SIGUSR1은 stStart()를 부른 스레드와 그 뒤에 만든 스레드에서 막히고,
+      관리 스레드가 signalfd로만 받는다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/signalfd.h>
+#include "stats.h"
+
+static const char	*stNames[ST_NCOUNTER] = {
+	"msg_in", "msg_out", "bytes_in", "bytes_out", "bcast", "recvs",
+	"sends", "drops", "accepts", "closes", "queued"
+};
+
+/*===============================================================
+[Function Name] : static long stNow(void)
+[Description]   :
+    - 단조 증가 시계의 현재 시각 (ms)
+[Input]         : 없음
+[Output]        : 없음
+[Calls]         : clock_gettime()
+[Given]         : 없음
+[Returns]       : long; ms
+==================================================================*/
+static long stNow(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/*===============================================================
+[Function Name] : int stInit(StTable *t, int nslot)
+[Description]   :
+    - CACHE_LINE에 맞춰 정렬된 슬롯 nslot개를 0으로 채워 할당
+[Input]         :
+    StTable *t;       // 초기화할 통계 테이블
+    int nslot;        // 슬롯 수 (카운터를 쓰는 스레드 수)
+[Output]        : 없음
+[Calls]         : posix_memalign(), memset(), pthread_mutex_init()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int stInit(StTable *t, int nslot)
+{
+	void	*p;
+	int		i;
+
+	memset(t, 0, sizeof(StTable));
+	if (posix_memalign(&p, CACHE_LINE, nslot * sizeof(StSlot)))  {
+		perror("posix_memalign");
+		return -1;
+	}
+	memset(p, 0, nslot * sizeof(StSlot));
+	t->slot = p;
+	t->nslot = nslot;
+	for (i = 0 ; i < nslot ; i++)
+		snprintf(t->slot[i].name, ST_NAME, "%d", i);
+	t->sigFd = t->listenFd = -1;
+	t->startMs = t->lastMs = stNow();
+	pthread_mutex_init(&t->lock, NULL);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : StSlot *stSlot(StTable *t, int i, const char *name)
+[Description]   :
+    - i번 슬롯에 이름을 붙이고 돌려준다. (스레드를 만들기 전에 호출)
+[Input]         :
+    StTable *t;       // 통계 테이블
+    int i;            // 슬롯 번호
+    const char *name; // 보고서에 쓸 이름 (예: "worker0")
+[Output]        : 없음
+[Calls]         : snprintf()
+[Given]         : 0 <= i < t->nslot
+[Returns]       : StSlot *; 그 스레드가 stAdd()에 쓸 슬롯
+==================================================================*/
+StSlot *stSlot(StTable *t, int i, const char *name)
+{
+	snprintf(t->slot[i].name, ST_NAME, "%s", name);
+
+	return &t->slot[i];
+}
+
+/*===============================================================
+[Function Name] : long stSum(StTable *t, int k)
+[Description]   :
+    - 카운터 k의 모든 슬롯 합계
+[Input]         :
+    StTable *t;       // 통계 테이블
+    int k;            // StCounter
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : long; 합계
+==================================================================*/
+long stSum(StTable *t, int k)
+{
+	long	sum = 0;
+	int		i;
+
+	for (i = 0 ; i < t->nslot ; i++)
+		sum += atomic_load_explicit(&t->slot[i].c[k], memory_order_relaxed);
+
+	return sum;
+}
+
+/*===============================================================
+[Function Name] : int stFormat(StTable *t, char *buf, int size)
+[Description]   :
+    - 슬롯별 카운터, 합계, 지난 보고 이후의 초당 비율을 buf에 쓴다.
+    - 슬롯은 쓰는 중에도 읽으므로 줄마다 약간의 시차가 있을 수 있다.
+[Input]         :
+    StTable *t;       // 통계 테이블
+    char *buf;        // 보고서 버퍼
+    int size;         // buf 크기
+[Output]        : 없음
+[Calls]         : snprintf(), stSum(), pthread_mutex_lock()
+[Given]         : 없음
+[Returns]       : int; 보고서 길이 (size - 1에서 잘림)
+==================================================================*/
+int stFormat(StTable *t, char *buf, int size)
+{
+	long	now, sum[ST_NCOUNTER];
+	double	sec;
+	int		i, k, n;
+
+#define	ST_PUT(...)		do { if (n < size) n += snprintf(buf + n, size - n, __VA_ARGS__); } while (0)
+
+	pthread_mutex_lock(&t->lock);
+	now = stNow();
+	n = 0;
+	ST_PUT("[stats] uptime %.1f s, %d threads\n", (now - t->startMs) / 1000.0, t->nslot);
+	ST_PUT("  %-10s", "thread");
+	for (k = 0 ; k < ST_NCOUNTER ; k++)
+		ST_PUT(" %10s", stNames[k]);
+	ST_PUT("\n");
+	for (i = 0 ; i < t->nslot ; i++)  {
+		ST_PUT("  %-10s", t->slot[i].name);
+		for (k = 0 ; k < ST_NCOUNTER ; k++)
+			ST_PUT(" %10ld", (long)atomic_load_explicit(&t->slot[i].c[k], memory_order_relaxed));
+		ST_PUT("\n");
+	}
+	ST_PUT("  %-10s", "total");
+	for (k = 0 ; k < ST_NCOUNTER ; k++)  {
+		sum[k] = stSum(t, k);
+		ST_PUT(" %10ld", sum[k]);
+	}
+	ST_PUT("\n");
+
+	sec = (now - t->lastMs) / 1000.0;
+	if (sec > 0)  {
+		ST_PUT("  %-10s", "per sec");
+		for (k = 0 ; k < ST_NCOUNTER ; k++)  {
+			if (k == ST_QUEUED)
+				ST_PUT(" %10s", "-");
+			else
+				ST_PUT(" %10.0f", (sum[k] - t->last[k]) / sec);
+		}
+		ST_PUT("  (last %.1f s)\n", sec);
+	}
+	memcpy(t->last, sum, sizeof(sum));
+	t->lastMs = now;
+	pthread_mutex_unlock(&t->lock);
+
+#undef	ST_PUT
+
+	return n < size ? n : size - 1;
+}
+
+/*===============================================================
+[Function Name] : void stPrint(StTable *t)
+[Description]   :
+    - 보고서를 stdout에 출력
+[Input]         :
+    StTable *t;       // 통계 테이블
+[Output]        : 보고서 (stdout)
+[Calls]         : stFormat(), fputs(), fflush()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void stPrint(StTable *t)
+{
+	char	buf[ST_REPORT];
+
+	stFormat(t, buf, sizeof(buf));
+	fputs(buf, stdout);
+	fflush(stdout);
+}
+
+/*===============================================================
+[Function Name] : static void stServe(StTable *t)
+[Description]   :
+    - 관리 소켓에 들어온 연결 하나에 보고서를 보내고 끊는다.
+[Input]         :
+    StTable *t;       // 통계 테이블
+[Output]        : 보고서 (관리 소켓 연결)
+[Calls]         : accept(), stFormat(), write(), close()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+static void stServe(StTable *t)
+{
+	char	buf[ST_REPORT];
+	int		fd, len, off = 0;
+	ssize_t	n;
+
+	if ((fd = accept(t->listenFd, NULL, NULL)) < 0)
+		return;
+	len = stFormat(t, buf, sizeof(buf));
+	while (off < len)  {
+		if ((n = write(fd, buf + off, len - off)) < 0)  {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		off += n;
+	}
+	close(fd);
+}
+
+/*===============================================================
+[Function Name] : static void *stThread(void *arg)
+[Description]   :
+    - 관리 스레드. SIGUSR1이면 stdout에 보고하고,
+      관리 소켓에 연결이 오면 그 연결에 보고한다.
+[Input]         :
+    void *arg;        // StTable *
+[Output]        : 없음
+[Calls]         : poll(), read(), stPrint(), stServe()
+[Given]         : 없음
+[Returns]       : 없음 (무한 루프)
+==================================================================*/
+static void *stThread(void *arg)
+{
+	StTable					*t = arg;
+	struct pollfd			pfd[2];
+	struct signalfd_siginfo	si;
+
+	pfd[0].fd = t->sigFd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = t->listenFd;		// -1이면 poll()이 무시
+	pfd[1].events = POLLIN;
+
+	while (1)  {
+		if (poll(pfd, 2, -1) < 0)  {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			return NULL;
+		}
+		if ((pfd[0].revents & POLLIN) && read(t->sigFd, &si, sizeof(si)) == sizeof(si))
+			stPrint(t);
+		if (pfd[1].revents & POLLIN)
+			stServe(t);
+	}
+
+	return NULL;
+}
+
+/*===============================================================
+[Function Name] : int stStart(StTable *t, const char *path)
+[Description]   :
+    - SIGUSR1을 막고 signalfd로 받도록 한 뒤, path가 있으면 관리 소켓을
+      만들고 관리 스레드를 시작한다.
+    - 카운터를 쓰는 스레드를 만들기 전에 main 스레드에서 호출해야
+      모든 스레드가 SIGUSR1을 막은 상태를 물려받는다.
+[Input]         :
+    StTable *t;       // 통계 테이블 (stInit() 후)
+    const char *path; // UNIX 도메인 관리 소켓 경로 (NULL: SIGUSR1만)
+[Output]        : 없음
+[Calls]         : pthread_sigmask(), signalfd(), socket(), unlink(), bind(), listen(),
+                  pthread_create(), pthread_detach()
+[Given]         : 없음
+[Returns]       : int; 성공 0, 실패 -1
+==================================================================*/
+int stStart(StTable *t, const char *path)
+{
+	struct sockaddr_un	addr;
+	sigset_t			usr1;
+
+	sigemptyset(&usr1);
+	sigaddset(&usr1, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &usr1, NULL);
+	if ((t->sigFd = signalfd(-1, &usr1, SFD_CLOEXEC)) < 0)  {
+		perror("signalfd");
+		return -1;
+	}
+
+	if (path)  {
+		if (strlen(path) >= sizeof(addr.sun_path))  {
+			fprintf(stderr, "%s: admin socket path too long\n", path);
+			return -1;
+		}
+		if ((t->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)  {
+			perror("socket");
+			return -1;
+		}
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path);
+		unlink(path);		// 지난 실행이 남긴 소켓 파일
+		if (bind(t->listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+			listen(t->listenFd, 8) < 0)  {
+			perror(path);
+			close(t->listenFd);
+			t->listenFd = -1;
+			return -1;
+		}
+		t->path = path;
+	}
+
+	if (pthread_create(&t->tid, NULL, stThread, t))  {
+		perror("pthread_create");
+		return -1;
+	}
+	pthread_detach(t->tid);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : void stClose(StTable *t)
+[Description]   :
+    - 관리 소켓 파일을 지운다. (서버를 끝낼 때)
+[Input]         :
+    StTable *t;       // 통계 테이블
+[Output]        : 없음
+[Calls]         : unlink()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void stClose(StTable *t)
+{
+	if (t->path)
+		unlink(t->path);
+}
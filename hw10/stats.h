@@ -0,0 +1,77 @@
+/*===============================================================
+[Program Name] : stats.h
+[Description]  :
+    - 채팅 서버의 스레드별 통계 카운터 선언.
+    - 스레드마다 CACHE_LINE에 맞춰 정렬된 슬롯(StSlot)을 하나씩 두고,
+      각 스레드는 자기 슬롯에만 쓴다. 쓰는 쪽이 하나이므로 lock도
+      atomic read-modify-write도 없이 relaxed load/store로 더한다.
+    - 합계는 읽을 때(보고할 때) 슬롯들을 더해 만든다.
+    - 보고는 관리 스레드가 한다. SIGUSR1을 받으면 stdout에 출력하고,
+      UNIX 도메인 관리 소켓(-s path)에 접속하면 보고서를 보내고 끊는다.
+        예) kill -USR1 <pid>,  nc -U /tmp/chats.sock
+[특기사항]     :
+    - 함수 정의는 stats.c에 있음.
+    - 게이지(ST_QUEUED)는 여러 스레드가 더하고 빼므로 슬롯 하나는 음수가
+      될 수 있고, 합계만 의미가 있다.
+==================================================================*/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "clienttab.h"
+
+#define	ST_NAME			16			// 슬롯 이름 최대 길이
+#define	ST_REPORT		16384		// 보고서 버퍼 크기
+
+typedef enum  {
+	ST_MSG_IN,			// 받은 프레임 수
+	ST_MSG_OUT,			// 보낸 메시지 수 (수신자마다 하나)
+	ST_BYTES_IN,		// 받은 바이트 수
+	ST_BYTES_OUT,		// 보낸 바이트 수
+	ST_BROADCASTS,		// 브로드캐스트 수
+	ST_RECVS,			// recv() 호출 수
+	ST_SENDS,			// sendmsg() 호출 수
+	ST_DROPS,			// 대기열이 가득 차 버린 메시지 수
+	ST_ACCEPTS,			// 받아들인 연결 수
+	ST_CLOSES,			// 닫은 연결 수
+	ST_QUEUED,			// 송신 대기열에 있는 메시지 수 (게이지)
+	ST_NCOUNTER
+}
+	StCounter;
+
+typedef struct  {
+	_Alignas(CACHE_LINE) atomic_long	c[ST_NCOUNTER];
+	char		name[ST_NAME];
+}
+	StSlot;
+
+typedef struct  {
+	StSlot			*slot;
+	int				nslot;
+	long			startMs;
+	int				sigFd;			// SIGUSR1 signalfd
+	int				listenFd;		// 관리 소켓 (-1: 없음)
+	const char		*path;
+	pthread_t		tid;
+	pthread_mutex_t	lock;			// 아래 보고 상태 보호 (보고하는 쪽만 잡음)
+	long			last[ST_NCOUNTER];	// 지난 보고의 합계 (초당 비율 계산)
+	long			lastMs;
+}
+	StTable;
+
+// s 슬롯의 카운터 k에 n을 더함 (s를 가진 스레드만 호출)
+#define	stAdd(s, k, n)	atomic_store_explicit(&(s)->c[k], \
+							atomic_load_explicit(&(s)->c[k], memory_order_relaxed) + (n), \
+							memory_order_relaxed)
+
+int		stInit(StTable *t, int nslot);
+StSlot	*stSlot(StTable *t, int i, const char *name);
+long	stSum(StTable *t, int k);
+int		stStart(StTable *t, const char *path);
+int		stFormat(StTable *t, char *buf, int size);
+void	stPrint(StTable *t);
+void	stClose(StTable *t);
+
+#endif
@@ -0,0 +1,298 @@
+/*===============================================================
+[Program Name] : timerwheel.c
+[Description]  :
+    - 계층형 타이머 휠 구현.
+    - 타이머는 만료까지 남은 tick 수(delta)로 단계를 고른다.
+      delta < 64는 0단계, < 64^2는 1단계, ... 슬롯 번호는 만료 tick을
+      단계에 맞게 shift한 값의 하위 TW_BITS비트.
+    - twAdvance()는 tick을 하나씩 처리하며, 0단계 번호가 0으로 돌아올
+      때마다 위 단계의 현재 슬롯을 다시 넣어(cascade) 아래로 내린다.
+      연결 수와 관계없이 tick마다 슬롯 하나만 보므로 100k 연결에서도
+      깨어날 때 만료된 것만 처리한다.
+[Input]        :
+    TimerWheel *tw;   // 타이머 휠
+    TwTimer *t;       // 사용하는 쪽 구조체에 들어 있는 타이머
+[Output]       :
+    만료된 타이머의 fn(t, arg) 호출
+[Calls]        :
+    clock_gettime()
+[특기사항]     :
+    - 콜백 안에서 다른 타이머를 추가/취소하거나 자신을 다시 걸어도 된다.
+==================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "timerwheel.h"
+
+#define	TW_MASK		(TW_SLOTS - 1)
+
+/*===============================================================
+[Function Name] : long twNow(void)
+[Description]   :
+    - 단조 증가 시계의 현재 시각 (ms)
+[Input]         : 없음
+[Output]        : 없음
+[Calls]         : clock_gettime()
+[Given]         : 없음
+[Returns]       : long; ms
+==================================================================*/
+long twNow(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/*===============================================================
+[Function Name] : void twInit(TimerWheel *tw, int tickMs)
+[Description]   :
+    - 빈 타이머 휠을 만든다.
+[Input]         :
+    TimerWheel *tw;   // 초기화할 휠
+    int tickMs;       // tick 하나의 길이 (ms, 만료 시각의 정밀도)
+[Output]        : 없음
+[Calls]         : memset(), twNow()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void twInit(TimerWheel *tw, int tickMs)
+{
+	memset(tw, 0, sizeof(TimerWheel));
+	tw->tickMs = tickMs > 0 ? tickMs : 1;
+	tw->now = twNow() / tw->tickMs;
+}
+
+/*===============================================================
+[Function Name] : void twSet(TwTimer *t, TwFunc fn, void *arg)
+[Description]   :
+    - 타이머의 콜백을 정한다. (걸려 있지 않은 타이머에만 호출)
+[Input]         :
+    TwTimer *t;       // 타이머
+    TwFunc fn;        // 만료 시 부를 함수
+    void *arg;        // fn에 넘길 값
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void twSet(TwTimer *t, TwFunc fn, void *arg)
+{
+	t->next = NULL;
+	t->pprev = NULL;
+	t->fn = fn;
+	t->arg = arg;
+}
+
+/*===============================================================
+[Function Name] : static void twPlace(TimerWheel *tw, TwTimer *t)
+[Description]   :
+    - t->expire에 맞는 단계/슬롯의 리스트 앞에 t를 넣는다.
+      이미 지난 타이머는 다음에 처리할 tick의 슬롯에 넣는다.
+[Input]         :
+    TimerWheel *tw;   // 타이머 휠
+    TwTimer *t;       // 넣을 타이머 (걸려 있지 않은 상태)
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+static void twPlace(TimerWheel *tw, TwTimer *t)
+{
+	TwTimer	**head;
+	long	delta = t->expire - tw->now;
+	int		level = 0;
+
+	if (delta < 0)  {
+		t->expire = tw->now;
+		delta = 0;
+	}
+	else if (delta >= TW_MAX_TICKS)  {
+		t->expire = tw->now + TW_MAX_TICKS - 1;
+		delta = TW_MAX_TICKS - 1;
+	}
+	while (delta >= (1L << (TW_BITS * (level + 1))))
+		level++;
+
+	head = &tw->slot[level][(t->expire >> (TW_BITS * level)) & TW_MASK];
+	t->next = *head;
+	if (t->next)
+		t->next->pprev = &t->next;
+	t->pprev = head;
+	*head = t;
+}
+
+/*===============================================================
+[Function Name] : void twAdd(TimerWheel *tw, TwTimer *t, long ms)
+[Description]   :
+    - 타이머를 지금부터 ms 뒤에 만료되도록 건다. (O(1))
+      이미 걸려 있으면 다시 건다. (idle 타이머 연장 등)
+[Input]         :
+    TimerWheel *tw;   // 타이머 휠
+    TwTimer *t;       // 타이머 (twSet()으로 콜백이 정해진 것)
+    long ms;          // 만료까지 남은 시간 (tick 단위로 올림)
+[Output]        : 없음
+[Calls]         : twDel(), twNow(), twPlace()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void twAdd(TimerWheel *tw, TwTimer *t, long ms)
+{
+	long	nowMs = twNow();
+
+	if (twPending(t))
+		twDel(tw, t);
+	if (tw->count == 0 && nowMs / tw->tickMs > tw->now)
+		tw->now = nowMs / tw->tickMs;	// 빈 휠은 지나간 tick을 처리할 필요가 없음
+
+	// 일찍 만료되지 않도록 올림 (tick k는 k * tickMs ms가 되면 처리됨)
+	t->expire = (nowMs + ms + tw->tickMs - 1) / tw->tickMs;
+	twPlace(tw, t);
+	tw->count++;
+}
+
+/*===============================================================
+[Function Name] : void twDel(TimerWheel *tw, TwTimer *t)
+[Description]   :
+    - 타이머를 취소한다. (O(1), 걸려 있지 않으면 무시)
+[Input]         :
+    TimerWheel *tw;   // 타이머 휠
+    TwTimer *t;       // 타이머
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void twDel(TimerWheel *tw, TwTimer *t)
+{
+	if (! twPending(t))
+		return;
+
+	*t->pprev = t->next;
+	if (t->next)
+		t->next->pprev = t->pprev;
+	t->next = NULL;
+	t->pprev = NULL;
+	tw->count--;
+}
+
+/*===============================================================
+[Function Name] : static int twCascade(TimerWheel *tw, int level)
+[Description]   :
+    - level 단계의 현재 슬롯에 있는 타이머들을 다시 넣어
+      남은 시간에 맞는 아래 단계로 내린다.
+[Input]         :
+    TimerWheel *tw;   // 타이머 휠
+    int level;        // 1 이상
+[Output]        : 없음
+[Calls]         : twPlace()
+[Given]         : 없음
+[Returns]       : int; 처리한 슬롯 번호 (0이면 위 단계도 내려야 함)
+==================================================================*/
+static int twCascade(TimerWheel *tw, int level)
+{
+	TwTimer	*t, *next;
+	int		idx = (tw->now >> (TW_BITS * level)) & TW_MASK;
+
+	t = tw->slot[level][idx];
+	tw->slot[level][idx] = NULL;
+	for ( ; t != NULL ; t = next)  {
+		next = t->next;
+		twPlace(tw, t);
+	}
+
+	return idx;
+}
+
+/*===============================================================
+[Function Name] : int twAdvance(TimerWheel *tw)
+[Description]   :
+    - 현재 시각까지의 tick을 처리하며 만료된 타이머를 빼고 콜백을 부른다.
+    - 처리할 슬롯은 지역 리스트로 옮긴 뒤 하나씩 빼므로, 콜백이
+      같은 슬롯의 다른 타이머를 취소하거나 자신을 다시 걸어도 안전하다.
+[Input]         :
+    TimerWheel *tw;   // 타이머 휠
+[Output]        : 없음
+[Calls]         : twNow(), twCascade(), twDel(), 타이머의 fn
+[Given]         : 없음
+[Returns]       : int; 만료된 타이머 수
+==================================================================*/
+int twAdvance(TimerWheel *tw)
+{
+	TwTimer	*pend, *t;
+	long	tick = twNow() / tw->tickMs;
+	int		idx, level, fired = 0;
+
+	while (tw->now <= tick)  {
+		if (tw->count == 0)  {
+			tw->now = tick + 1;
+			break;
+		}
+
+		idx = tw->now & TW_MASK;
+		if (idx == 0)
+			for (level = 1 ; level < TW_LEVELS && twCascade(tw, level) == 0 ; level++)
+				;
+
+		pend = tw->slot[0][idx];
+		tw->slot[0][idx] = NULL;
+		if (pend)
+			pend->pprev = &pend;
+		tw->now++;
+
+		while ((t = pend) != NULL)  {
+			twDel(tw, t);
+			t->fn(t, t->arg);
+			fired++;
+		}
+	}
+
+	return fired;
+}
+
+/*===============================================================
+[Function Name] : int twTimeout(TimerWheel *tw)
+[Description]   :
+    - 다음 만료까지 남은 시간. epoll_wait()/select()의 timeout으로 쓴다.
+    - 0단계는 가장 이른 슬롯의 tick, 위 단계는 다음 cascade 시점
+      (그때 아래로 내려온 타이머를 다시 계산) 중 가장 이른 것.
+[Input]         :
+    TimerWheel *tw;   // 타이머 휠
+[Output]        : 없음
+[Calls]         : twNow()
+[Given]         : 없음
+[Returns]       : int; ms (0: 이미 지남), -1: 타이머 없음
+==================================================================*/
+int twTimeout(TimerWheel *tw)
+{
+	long	next = -1, base, tick, ms;
+	int		i, level, shift;
+
+	if (tw->count == 0)
+		return -1;
+
+	for (i = 0 ; i < TW_SLOTS ; i++)  {
+		if (tw->slot[0][(tw->now + i) & TW_MASK])  {
+			next = tw->now + i;
+			break;
+		}
+	}
+	for (level = 1 ; level < TW_LEVELS ; level++)  {
+		shift = TW_BITS * level;
+		base = tw->now >> shift;
+		// 지금이 경계면 현재 슬롯은 아직 내려오지 않았음
+		for (i = (tw->now & ((1L << shift) - 1)) ? 1 : 0 ; i <= TW_SLOTS ; i++)  {
+			if (tw->slot[level][(base + i) & TW_MASK])  {
+				tick = (base + i) << shift;
+				if (next < 0 || tick < next)
+					next = tick;
+				break;
+			}
+		}
+	}
+
+	ms = next * tw->tickMs - twNow();
+	return ms > 0 ? (int)ms : 0;
+}
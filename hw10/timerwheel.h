@@ -0,0 +1,55 @@
+/*===============================================================
+[Program Name] : timerwheel.h
+[Description]  :
+    - 계층형 타이머 휠(hierarchical timing wheel) 선언.
+    - 휠은 TW_LEVELS 단계, 단계마다 TW_SLOTS개 슬롯이고 L단계 슬롯 하나는
+      TW_SLOTS^L tick을 덮는다. 타이머는 남은 시간에 맞는 단계에 들어가고,
+      아래 단계가 한 바퀴 돌 때마다 위 단계 슬롯 하나를 내려보낸다(cascade).
+    - TwTimer는 사용하는 쪽 구조체(연결 등)에 넣어 쓰는 intrusive 노드이므로
+      추가/취소에 할당이 없고 O(1)이다. 0으로 채워진 TwTimer는 걸려 있지 않은 상태.
+    - 이벤트 루프는 twTimeout()으로 epoll_wait()/select()의 대기 시간을
+      정하고, 깨어날 때마다 twAdvance()로 만료된 타이머의 콜백을 부른다.
+[특기사항]     :
+    - 함수 정의는 timerwheel.c에 있음.
+    - 동기화는 하지 않으므로 한 스레드(이벤트 루프)에서만 사용.
+==================================================================*/
+
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#define	TW_BITS			6
+#define	TW_SLOTS		(1 << TW_BITS)		// 단계당 슬롯 수
+#define	TW_LEVELS		4					// 64^4 tick (10 ms tick이면 약 46시간)
+#define	TW_MAX_TICKS	(1L << (TW_BITS * TW_LEVELS))
+
+struct TwTimer;
+typedef void (*TwFunc)(struct TwTimer *t, void *arg);
+
+typedef struct TwTimer  {
+	struct TwTimer	*next;
+	struct TwTimer	**pprev;		// 앞 노드의 next (또는 슬롯 head) 주소, NULL이면 걸려 있지 않음
+	long			expire;			// 만료 tick
+	TwFunc			fn;				// 만료 시 부를 함수
+	void			*arg;
+}
+	TwTimer;
+
+typedef struct  {
+	TwTimer		*slot[TW_LEVELS][TW_SLOTS];
+	long		now;				// 다음에 처리할 tick
+	int			tickMs;				// tick 하나의 길이 (ms)
+	long		count;				// 걸려 있는 타이머 수
+}
+	TimerWheel;
+
+#define	twPending(t)	((t)->pprev != NULL)
+
+void	twInit(TimerWheel *tw, int tickMs);
+void	twSet(TwTimer *t, TwFunc fn, void *arg);
+void	twAdd(TimerWheel *tw, TwTimer *t, long ms);
+void	twDel(TimerWheel *tw, TwTimer *t);
+int		twAdvance(TimerWheel *tw);
+int		twTimeout(TimerWheel *tw);
+long	twNow(void);
+
+#endif
@@ -0,0 +1,339 @@
+/*===============================================================
+[Program Name] : uring.c
+[Description]  :
+    - io_uring 래퍼 구현. io_uring_setup()으로 링을 만들고 SQ/CQ 링과
+      SQE 배열을 mmap하여, SQE를 채우고 io_uring_enter() 한 번으로
+      제출 + 완료 대기를 같이 한다.
+    - provided buffer ring(IORING_REGISTER_PBUF_RING)은 multishot recv가
+      완료될 때마다 커널이 빈 버퍼를 골라 쓰도록 미리 등록해 두는 버퍼 묶음.
+      사용이 끝난 버퍼는 urBufRecycle()로 다시 링에 넣는다.
+[Input]        :
+    Uring *ur;        // io_uring 상태
+[Output]       :
+    urInit(), urBufRingInit()은 실패 시 -1 (커널이 지원하지 않으면 errno가
+    ENOSYS/EINVAL/EPERM 등) → 호출한 쪽에서 epoll로 대체
+[Calls]        :
+    syscall(), mmap(), munmap(), close()
+[특기사항]     :
+    - 커널 5.19 이상 필요 (multishot recv와 provided buffer ring).
+    - SINGLE_ISSUER|DEFER_TASKRUN을 먼저 시도하고, 커널이 모르면 빼고
+      다시 만든다. DEFER_TASKRUN에서는 GETEVENTS로 enter해야 완료가
+      CQ에 올라오므로 urSubmit()은 항상 GETEVENTS를 준다.
+==================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "uring.h"
+
+/*===============================================================
+[Function Name] : int urInit(Uring *ur, unsigned entries)
+[Description]   :
+    - io_uring을 만들고 SQ/CQ 링과 SQE 배열을 mmap
+[Input]         :
+    Uring *ur;        // 초기화할 io_uring 상태
+    unsigned entries; // SQ 크기 (CQ는 커널이 2배로 잡음)
+[Output]        : 없음
+[Calls]         : syscall(), mmap(), close()
+[Given]         : 없음
+[Returns]       : int; 0 성공, -1 실패 (errno 참조)
+==================================================================*/
+int urInit(Uring *ur, unsigned entries)
+{
+	struct io_uring_params	p;
+	unsigned				i;
+	int						err;
+
+	memset(ur, 0, sizeof(Uring));
+
+	memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	if ((ur->ringFd = syscall(__NR_io_uring_setup, entries, &p)) < 0 && errno == EINVAL)  {
+		memset(&p, 0, sizeof(p));
+		ur->ringFd = syscall(__NR_io_uring_setup, entries, &p);
+	}
+	if (ur->ringFd < 0)
+		return -1;
+
+	ur->entries = p.sq_entries;
+	ur->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ur->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)  {
+		if (ur->cqRingSize > ur->sqRingSize)
+			ur->sqRingSize = ur->cqRingSize;
+		ur->cqRingSize = ur->sqRingSize;
+	}
+
+	ur->sqRing = mmap(NULL, ur->sqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ur->ringFd, IORING_OFF_SQ_RING);
+	if (ur->sqRing == MAP_FAILED)
+		goto fail;
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		ur->cqRing = ur->sqRing;
+	else  {
+		ur->cqRing = mmap(NULL, ur->cqRingSize, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ur->ringFd, IORING_OFF_CQ_RING);
+		if (ur->cqRing == MAP_FAILED)  {
+			ur->cqRing = NULL;
+			goto fail;
+		}
+	}
+	ur->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ur->ringFd, IORING_OFF_SQES);
+	if (ur->sqes == MAP_FAILED)  {
+		ur->sqes = NULL;
+		goto fail;
+	}
+
+	ur->sqHead = (unsigned *)((char *)ur->sqRing + p.sq_off.head);
+	ur->sqTail = (unsigned *)((char *)ur->sqRing + p.sq_off.tail);
+	ur->sqMask = (unsigned *)((char *)ur->sqRing + p.sq_off.ring_mask);
+	ur->sqArray = (unsigned *)((char *)ur->sqRing + p.sq_off.array);
+	ur->cqHead = (unsigned *)((char *)ur->cqRing + p.cq_off.head);
+	ur->cqTail = (unsigned *)((char *)ur->cqRing + p.cq_off.tail);
+	ur->cqMask = (unsigned *)((char *)ur->cqRing + p.cq_off.ring_mask);
+	ur->cqes = (struct io_uring_cqe *)((char *)ur->cqRing + p.cq_off.cqes);
+
+	// SQ array는 항상 SQE 배열과 같은 순서로 쓴다.
+	for (i = 0 ; i < p.sq_entries ; i++)
+		ur->sqArray[i] = i;
+	ur->sqeTail = *ur->sqTail;
+
+	return 0;
+
+fail:
+	err = errno;
+	if (ur->sqRing && ur->sqRing != MAP_FAILED)
+		munmap(ur->sqRing, ur->sqRingSize);
+	if (ur->cqRing && ur->cqRing != ur->sqRing)
+		munmap(ur->cqRing, ur->cqRingSize);
+	close(ur->ringFd);
+	errno = err;
+	return -1;
+}
+
+/*===============================================================
+[Function Name] : void urExit(Uring *ur)
+[Description]   :
+    - mmap한 링을 해제하고 io_uring fd를 닫는다.
+      (등록한 provided buffer ring도 fd가 닫힐 때 같이 해제됨)
+[Input]         :
+    Uring *ur;        // io_uring 상태
+[Output]        : 없음
+[Calls]         : munmap(), close()
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void urExit(Uring *ur)
+{
+	munmap(ur->sqes, ur->entries * sizeof(struct io_uring_sqe));
+	if (ur->cqRing != ur->sqRing)
+		munmap(ur->cqRing, ur->cqRingSize);
+	munmap(ur->sqRing, ur->sqRingSize);
+	close(ur->ringFd);
+}
+
+/*===============================================================
+[Function Name] : unsigned urSqSpace(Uring *ur)
+[Description]   :
+    - 지금 더 채울 수 있는 SQE 개수
+      (링크로 묶을 SQE를 중간에 모자라지 않게 미리 확인할 때 사용)
+[Input]         :
+    Uring *ur;        // io_uring 상태
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : unsigned; 빈 SQE 개수
+==================================================================*/
+unsigned urSqSpace(Uring *ur)
+{
+	return ur->entries - (ur->sqeTail - __atomic_load_n(ur->sqHead, __ATOMIC_ACQUIRE));
+}
+
+/*===============================================================
+[Function Name] : struct io_uring_sqe *urGetSqe(Uring *ur)
+[Description]   :
+    - 빈 SQE 하나를 0으로 채워서 돌려준다.
+      커널에는 다음 urSubmit()에서 한번에 공개된다.
+[Input]         :
+    Uring *ur;        // io_uring 상태
+[Output]        : 없음
+[Calls]         : memset()
+[Given]         : 없음
+[Returns]       : struct io_uring_sqe *; SQ가 가득 차면 NULL
+==================================================================*/
+struct io_uring_sqe *urGetSqe(Uring *ur)
+{
+	struct io_uring_sqe	*sqe;
+
+	if (urSqSpace(ur) == 0)
+		return NULL;
+
+	sqe = &ur->sqes[ur->sqeTail & *ur->sqMask];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	ur->sqeTail++;
+	ur->toSubmit++;
+
+	return sqe;
+}
+
+/*===============================================================
+[Function Name] : int urSubmit(Uring *ur, unsigned waitNr)
+[Description]   :
+    - 채워 둔 SQE를 커널에 넘기고 완료가 waitNr개 이상 생길 때까지 대기
+      (제출과 대기가 io_uring_enter() 한 번)
+[Input]         :
+    Uring *ur;        // io_uring 상태
+    unsigned waitNr;  // 기다릴 완료 개수 (0이면 제출만)
+[Output]        : 없음
+[Calls]         : syscall()
+[Given]         : 없음
+[Returns]       : int; 커널이 가져간 SQE 수, -1 오류 (EINTR 포함)
+==================================================================*/
+int urSubmit(Uring *ur, unsigned waitNr)
+{
+	int		n;
+
+	__atomic_store_n(ur->sqTail, ur->sqeTail, __ATOMIC_RELEASE);
+
+	n = syscall(__NR_io_uring_enter, ur->ringFd, ur->toSubmit, waitNr,
+			IORING_ENTER_GETEVENTS, NULL, 0);
+	if (n < 0)
+		return -1;
+	ur->toSubmit -= n;
+
+	return n;
+}
+
+/*===============================================================
+[Function Name] : struct io_uring_cqe *urPeekCqe(Uring *ur)
+[Description]   :
+    - 처리하지 않은 완료 하나를 돌려준다. (기다리지 않음)
+      처리가 끝나면 urCqeSeen()을 호출해야 다음 완료로 넘어간다.
+[Input]         :
+    Uring *ur;        // io_uring 상태
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : struct io_uring_cqe *; 완료가 없으면 NULL
+==================================================================*/
+struct io_uring_cqe *urPeekCqe(Uring *ur)
+{
+	unsigned	head = *ur->cqHead;
+
+	if (head == __atomic_load_n(ur->cqTail, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	return &ur->cqes[head & *ur->cqMask];
+}
+
+/*===============================================================
+[Function Name] : void urCqeSeen(Uring *ur)
+[Description]   :
+    - urPeekCqe()로 본 완료 하나를 커널에 반납
+[Input]         :
+    Uring *ur;        // io_uring 상태
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void urCqeSeen(Uring *ur)
+{
+	__atomic_store_n(ur->cqHead, *ur->cqHead + 1, __ATOMIC_RELEASE);
+}
+
+/*===============================================================
+[Function Name] : int urBufRingInit(Uring *ur, UrBufRing *br, int bgid, int nbufs, int size)
+[Description]   :
+    - size 바이트 버퍼 nbufs개를 할당하여 버퍼 그룹 bgid로 등록하고
+      모두 링에 넣어 둔다.
+[Input]         :
+    Uring *ur;        // io_uring 상태
+    UrBufRing *br;    // 초기화할 버퍼 링
+    int bgid;         // 버퍼 그룹 id
+    int nbufs;        // 버퍼 개수 (2의 거듭제곱)
+    int size;         // 버퍼 하나의 크기
+[Output]        : 없음
+[Calls]         : mmap(), malloc(), syscall()
+[Given]         : 없음
+[Returns]       : int; 0 성공, -1 실패 (errno 참조)
+==================================================================*/
+int urBufRingInit(Uring *ur, UrBufRing *br, int bgid, int nbufs, int size)
+{
+	struct io_uring_buf_reg	reg;
+	size_t					ringSize = nbufs * sizeof(struct io_uring_buf);
+	int						i;
+
+	// 링 메모리는 페이지 단위로 정렬되어 있어야 한다.
+	br->ring = mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (br->ring == MAP_FAILED)
+		return -1;
+	if ((br->base = malloc((size_t)nbufs * size)) == NULL)  {
+		munmap(br->ring, ringSize);
+		return -1;
+	}
+	br->nbufs = nbufs;
+	br->size = size;
+	br->bgid = bgid;
+	br->tail = 0;
+
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (unsigned long)br->ring;
+	reg.ring_entries = nbufs;
+	reg.bgid = bgid;
+	if (syscall(__NR_io_uring_register, ur->ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)  {
+		free(br->base);
+		munmap(br->ring, ringSize);
+		return -1;
+	}
+
+	for (i = 0 ; i < nbufs ; i++)
+		urBufRecycle(br, i);
+
+	return 0;
+}
+
+/*===============================================================
+[Function Name] : char *urBuf(UrBufRing *br, int bid)
+[Description]   :
+    - 버퍼 id의 주소 (CQE flags의 IORING_CQE_BUFFER_SHIFT 위쪽 비트)
+[Input]         :
+    UrBufRing *br;    // 버퍼 링
+    int bid;          // 버퍼 id
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : char *; 버퍼 시작 주소
+==================================================================*/
+char *urBuf(UrBufRing *br, int bid)
+{
+	return br->base + (size_t)bid * br->size;
+}
+
+/*===============================================================
+[Function Name] : void urBufRecycle(UrBufRing *br, int bid)
+[Description]   :
+    - 다 쓴 버퍼를 링 끝에 다시 넣어 커널이 쓸 수 있게 한다.
+[Input]         :
+    UrBufRing *br;    // 버퍼 링
+    int bid;          // 버퍼 id
+[Output]        : 없음
+[Calls]         : 없음
+[Given]         : 없음
+[Returns]       : 없음
+==================================================================*/
+void urBufRecycle(UrBufRing *br, int bid)
+{
+	struct io_uring_buf	*buf = &br->ring->bufs[br->tail & (br->nbufs - 1)];
+
+	buf->addr = (unsigned long)urBuf(br, bid);
+	buf->len = br->size;
+	buf->bid = bid;
+	br->tail++;
+	__atomic_store_n(&br->ring->tail, br->tail, __ATOMIC_RELEASE);
+}
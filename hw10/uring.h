@@ -0,0 +1,56 @@
+/*===============================================================
+[Program Name] : uring.h
+[Description]  :
+    - io_uring을 시스템 콜(io_uring_setup/enter/register)로 직접 쓰는
+      얇은 래퍼 선언. (liburing 없이 커널 헤더만 사용)
+    - Uring은 submission/completion ring을 mmap한 상태,
+      UrBufRing은 커널이 recv할 때 골라 쓰는 provided buffer ring.
+[특기사항]     :
+    - 함수 정의는 uring.c에 있음.
+    - 한 스레드에서만 사용한다. (SQ/CQ 모두 단일 생산자/소비자)
+==================================================================*/
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <linux/io_uring.h>
+
+typedef struct  {
+	int					ringFd;
+	unsigned			entries;
+	unsigned			sqeTail;		// 다음에 채울 SQE 위치 (urSubmit()에서 커널에 공개)
+	unsigned			toSubmit;		// 채웠지만 아직 io_uring_enter()로 넘기지 않은 SQE 수
+
+	unsigned			*sqHead, *sqTail, *sqMask, *sqArray;
+	struct io_uring_sqe	*sqes;
+	unsigned			*cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe	*cqes;
+
+	void				*sqRing, *cqRing;
+	size_t				sqRingSize, cqRingSize;
+}
+	Uring;
+
+typedef struct  {
+	struct io_uring_buf_ring	*ring;
+	char				*base;			// 버퍼 nbufs개 (bid 순서)
+	int					nbufs;			// 2의 거듭제곱
+	int					size;			// 버퍼 하나의 크기
+	int					bgid;			// 버퍼 그룹 id (SQE의 buf_group)
+	unsigned short		tail;
+}
+	UrBufRing;
+
+int		urInit(Uring *ur, unsigned entries);
+void	urExit(Uring *ur);
+unsigned urSqSpace(Uring *ur);
+struct io_uring_sqe *urGetSqe(Uring *ur);
+int		urSubmit(Uring *ur, unsigned waitNr);
+struct io_uring_cqe *urPeekCqe(Uring *ur);
+void	urCqeSeen(Uring *ur);
+
+int		urBufRingInit(Uring *ur, UrBufRing *br, int bgid, int nbufs, int size);
+char	*urBuf(UrBufRing *br, int bid);
+void	urBufRecycle(UrBufRing *br, int bid);
+
+#endif